@@ -0,0 +1,35 @@
+# Turns compiled .spv files into constexpr uint32_t arrays plus a lookup table for EmbeddedShaders.cpp
+# Usage: cmake -DOUTPUT=<EmbeddedShaderData.inl> -DSHADERS=<a.spv|b.spv|...> -P EmbedSpirv.cmake
+# The list is '|' separated because ';' does not survive add_custom_command arguments.
+
+string(REPLACE "|" ";" SHADERS "${SHADERS}")
+
+set(CONTENT "// Generated by EmbedSpirv.cmake from the compiled shaders, do not edit\n\n")
+set(TABLE "")
+
+# CMake regexes have no {n} quantifier, spell out eight words per line
+string(REPEAT "0x[0-9a-f]+," 8 WORDS_PER_LINE_PATTERN)
+
+foreach(SHADER ${SHADERS})
+    get_filename_component(SHADER_NAME ${SHADER} NAME)
+    string(MAKE_C_IDENTIFIER "${SHADER_NAME}" SHADER_IDENTIFIER)
+
+    file(READ "${SHADER}" SHADER_HEX HEX)
+    string(LENGTH "${SHADER_HEX}" SHADER_HEX_LENGTH)
+    math(EXPR SHADER_REMAINDER "${SHADER_HEX_LENGTH} % 8")
+    if(SHADER_HEX_LENGTH EQUAL 0 OR NOT SHADER_REMAINDER EQUAL 0)
+        message(FATAL_ERROR "${SHADER} is not a valid SPIR-V module")
+    endif()
+
+    # SPIR-V is a stream of little-endian words: bytes aa bb cc dd -> 0xddccbbaa
+    string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1," SHADER_WORDS "${SHADER_HEX}")
+    string(REGEX REPLACE "(${WORDS_PER_LINE_PATTERN})" "\\1\n\t" SHADER_WORDS "${SHADER_WORDS}")
+
+    string(APPEND CONTENT "alignas(4) static constexpr uint32_t ${SHADER_IDENTIFIER}[] = {\n\t${SHADER_WORDS}\n};\n\n")
+    string(APPEND TABLE "\t{ \"${SHADER_NAME}\", ${SHADER_IDENTIFIER}, std::size(${SHADER_IDENTIFIER}) },\n")
+endforeach()
+
+# Terminated by an empty entry so the table is never zero-sized
+string(APPEND CONTENT "static constexpr EmbeddedShader EMBEDDED_SHADER_TABLE[] = {\n${TABLE}\t{ nullptr, nullptr, 0 }\n};\n")
+
+file(WRITE "${OUTPUT}" "${CONTENT}")
@@ -0,0 +1,5 @@
+#version 450
+
+// Depth only: the pre-pass has no colour attachments and writes nothing from the fragment stage
+void main() {
+}
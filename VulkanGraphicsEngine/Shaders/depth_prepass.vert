@@ -0,0 +1,31 @@
+#version 450
+
+// Position-only depth pre-pass. gl_Position must come out bit-identical to shader.vert so the
+// G-buffer pass can test against this depth with VK_COMPARE_OP_EQUAL: same inputs, same
+// expression, and invariant in both shaders.
+
+// Same set 0 bindings as shader.vert, so the global descriptor set binds to both pipelines
+layout(binding = 0) uniform CameraUniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    vec3 cameraPos;
+} cameraUBO;
+
+layout(binding = 1) uniform ModelUniformBufferObject {
+    mat4 model;
+} modelUBO;
+
+layout(location = 0) in vec3 inPosition;
+
+// Unused, declared so RecordMeshDraws pushes the same block to every mesh pipeline
+layout(push_constant) uniform Push {
+    mat4 transform;
+    mat4 modelMatrix;
+} push;
+
+invariant gl_Position;
+
+void main() {
+    vec4 positionWorld = modelUBO.model  * vec4(inPosition, 1.0);
+    gl_Position = cameraUBO.proj * cameraUBO.view * positionWorld;
+}
@@ -0,0 +1,222 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Clustered forward+ shading: the material is read like shader.frag and lit right away with
+// the lights binned into this fragment's cluster by cluster_lights.comp. Same BRDF as lighting.frag.
+
+// Vertex shader outputs, see shader.vert
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) in vec3 fragNormal;
+layout(location = 3) in vec3 WorldPos;
+layout(location = 4) in vec3 fragTangent;
+layout(location = 5) flat in uint fragMaterialIndex;
+
+layout(location = 0) out vec4 outColor;
+
+const uint NO_TEXTURE = 0xFFFFFFFFu;
+
+struct Material {
+    uint albedo;
+    uint normal;
+    uint metallic;
+    uint roughness;
+    uint ao;
+};
+
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(std430, set = 1, binding = 1) readonly buffer MaterialBuffer {
+    Material materials[];
+};
+
+layout(binding = 0) uniform CameraUniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    vec3 cameraPos;
+} cameraUBO;
+
+struct PointLight{
+    vec3 position;
+    vec3 color;
+    float lumen;
+    float radius;
+};
+struct DirectionalLight{
+    vec3 direction;
+    vec3 color;
+    float lux;
+};
+
+layout(binding = 2) uniform LightUniformBufferObject
+{
+    DirectionalLight DirectionalLight;
+    uint pointLightCount;
+}LightUBO;
+
+layout(std430, binding = 3) readonly buffer PointLightBuffer
+{
+    PointLight Pointlights[];
+};
+
+// Must match CLUSTER_GRID_* and MAX_LIGHTS_PER_CLUSTER in VulkanUtils.h
+const uint CLUSTER_GRID_X = 16;
+const uint CLUSTER_GRID_Y = 9;
+const uint CLUSTER_GRID_Z = 24;
+const uint MAX_LIGHTS_PER_CLUSTER = 255;
+
+struct Cluster {
+    uint lightCount;
+    uint lightIndices[MAX_LIGHTS_PER_CLUSTER];
+};
+
+layout(std430, binding = 4) readonly buffer ClusterBuffer
+{
+    Cluster clusters[];
+};
+
+layout(binding = 5) uniform ClusterUniformBufferObject {
+    mat4 inverseProjection;
+    vec2 screenSize;
+    float zNear;
+    float zFar;
+} clusterUBO;
+
+layout(constant_id = 1) const bool ENABLE_DIRECTIONAL_LIGHT = true;
+layout(constant_id = 2) const bool ENABLE_AO = true;
+
+const float PI = 3.14159265359;
+
+// FRESNELSHLICK
+vec3 fresnelShlick(float costTheta, vec3 F0)
+{
+    return F0 + (vec3(1.0) - F0) * pow(clamp(1.0 - costTheta, 0.0, 1.0), 5.0);
+}
+
+// DISTRIBUTION GGX
+float distributionGGX(vec3 N, vec3 H, float roughness)
+{
+    float a = roughness * roughness;
+    float a2 = a * a;
+    float NdotH = max(dot(N,H),0.0);
+    float NdotH2 = NdotH * NdotH;
+
+    float num = a2;
+    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+    denom = PI * denom * denom;
+    return num / denom;
+}
+
+// GEOMETRIC SCHLICKGGX
+float GeometricSchlickGGX(float NdotV, float roughness)
+{
+    float r = roughness + 1.0;
+    float k = (r*r)/8.0;
+
+    float num = NdotV;
+    float denom = NdotV * (1.0 - k) + k;
+
+    return num / denom;
+}
+
+// GEOMETRIC SMITH
+float geometricSmith(vec3 N, vec3 V, vec3 L, float roughness)
+{
+    float NdotV = max(dot(N,V),0.0);
+    float NdotL = max(dot(N,L),0.0);
+    float ggx2 = GeometricSchlickGGX(NdotV, roughness);
+    float ggx1 = GeometricSchlickGGX(NdotL, roughness);
+
+    return ggx1 * ggx2;
+}
+
+// Cook-Torrance term of one light, radiance already attenuated
+vec3 evaluateBRDF(vec3 N, vec3 V, vec3 L, vec3 radiance, vec3 albedoColor, float metallic, float roughness)
+{
+    vec3 H = normalize(V + L);
+
+    vec3 F0 = mix(vec3(0.04), albedoColor, metallic);
+    vec3 F = fresnelShlick(max(dot(H, V), 0.0), F0);
+
+    float NDF = distributionGGX(N, H, roughness);
+    float G = geometricSmith(N, V, L, roughness);
+
+    vec3 numerator = NDF * G * F;
+    float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.001;
+    vec3 specular = numerator / denominator;
+
+    vec3 kD = (vec3(1.0) - F) * (1.0 - metallic);
+
+    float NdotL = max(dot(N, L), 0.0);
+    return (kD * albedoColor / PI + specular) * radiance * NdotL;
+}
+
+// Inverse of the depth slicing in cluster_lights.comp
+uint clusterIndexOf(vec2 fragCoord, float viewDepth)
+{
+    uvec2 tile = uvec2(clamp(fragCoord / clusterUBO.screenSize, vec2(0.0), vec2(0.9999)) * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y));
+    float slice = log(max(viewDepth, clusterUBO.zNear) / clusterUBO.zNear) / log(clusterUBO.zFar / clusterUBO.zNear);
+    uint z = min(uint(slice * float(CLUSTER_GRID_Z)), CLUSTER_GRID_Z - 1u);
+    return tile.x + tile.y * CLUSTER_GRID_X + z * CLUSTER_GRID_X * CLUSTER_GRID_Y;
+}
+
+void main() {
+    Material material = materials[fragMaterialIndex];
+
+    vec3 albedoColor = material.albedo != NO_TEXTURE ?
+        texture(textures[nonuniformEXT(material.albedo)], fragTexCoord).rgb : vec3(1.0);
+    vec3 tangentNormal = material.normal != NO_TEXTURE ?
+        texture(textures[nonuniformEXT(material.normal)], fragTexCoord).rgb * 2.0 - 1.0 : vec3(0.0, 0.0, 1.0);
+    float metallic = material.metallic != NO_TEXTURE ?
+        texture(textures[nonuniformEXT(material.metallic)], fragTexCoord).r : 0.0;
+    float roughness = material.roughness != NO_TEXTURE ?
+        texture(textures[nonuniformEXT(material.roughness)], fragTexCoord).r : 1.0;
+    float ao = ENABLE_AO && material.ao != NO_TEXTURE ?
+        texture(textures[nonuniformEXT(material.ao)], fragTexCoord).r : 1.0;
+
+    vec3 T = normalize(fragTangent);
+    vec3 N = normalize(fragNormal);
+    vec3 B = normalize(cross(N, T));
+    N = normalize(mat3(T, B, N) * tangentNormal);
+
+    // Eye position from the view matrix, so lighting does not depend on cameraPos being filled in
+    mat3 viewRotation = mat3(cameraUBO.view);
+    vec3 eyePos = -transpose(viewRotation) * cameraUBO.view[3].xyz;
+    vec3 V = normalize(eyePos - WorldPos);
+
+    float viewDepth = -(cameraUBO.view * vec4(WorldPos, 1.0)).z;
+    uint clusterIndex = clusterIndexOf(gl_FragCoord.xy, viewDepth);
+
+    vec3 Lo = vec3(0.0);
+
+    uint lightCount = clusters[clusterIndex].lightCount;
+    for (uint i = 0; i < lightCount; ++i)
+    {
+        PointLight light = Pointlights[clusters[clusterIndex].lightIndices[i]];
+        vec3 toLight = light.position - WorldPos;
+        float distance = length(toLight);
+        if (distance >= light.radius) {
+            continue;
+        }
+
+        float attenuationFactor = 1000.0;
+        if (distance > 0.0) {
+            float normalizedDistance = distance / light.radius;
+            attenuationFactor = (1.0 - normalizedDistance * normalizedDistance) / (distance * distance);
+        }
+
+        vec3 radiance = light.color * light.lumen * attenuationFactor;
+        Lo += evaluateBRDF(N, V, toLight / max(distance, 1e-5), radiance, albedoColor, metallic, roughness);
+    }
+
+    if (ENABLE_DIRECTIONAL_LIGHT)
+    {
+        vec3 L_dir = normalize(-LightUBO.DirectionalLight.direction);
+        vec3 radiance_dir = LightUBO.DirectionalLight.color * LightUBO.DirectionalLight.lux;
+        Lo += evaluateBRDF(N, V, L_dir, radiance_dir, albedoColor, metallic, roughness);
+    }
+
+    vec3 ambient = vec3(0.03) * albedoColor * ao;
+
+    outColor = vec4(ambient + Lo, 1.0);
+}
@@ -0,0 +1,157 @@
+#version 450
+
+// Shades the pixels covered by one point light's volume (light_volume.vert) and adds the result
+// to the HDR target. The depth test already dropped pixels whose surface lies behind the volume;
+// pixels in front of it, or inside its box but outside the sphere, are discarded here.
+// Ambient and the directional light come from the lighting.frag pass drawn before.
+
+layout(location = 0) flat in uint lightIndex;
+
+// G-Buffer texture inputs, same bindings as lighting.frag
+layout(binding = 0) uniform sampler2D gAlbedo;
+layout(binding = 1) uniform sampler2D gNormal;            // octahedral encoded world normal
+layout(binding = 2) uniform sampler2D gMetallicRoughness; // r metallic, g roughness, b ambient occlusion
+layout(binding = 3) uniform sampler2D gDepth;
+
+layout(location = 0) out vec4 outColor;
+
+layout(binding = 9) uniform CameraUniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    vec3 cameraPos;
+} cameraUBO;
+
+struct PointLight{
+    vec3 position;
+    vec3 color;
+    float lumen;
+    float radius;
+};
+
+layout(std430, binding = 10) readonly buffer PointLightBuffer
+{
+    PointLight Pointlights[];
+};
+
+layout(push_constant) uniform ScreenSizePush {
+    vec2 inverseScreenSize; // 1.0 / width, 1.0 / height
+    mat4 inverseViewProjection; // Inverse of cameraUBO.proj * cameraUBO.view
+} screenSizePush;
+
+const float PI = 3.14159265359;
+
+// FRESNELSHLICK
+vec3 fresnelShlick(float costTheta, vec3 F0)
+{
+    return F0 + (vec3(1.0) - F0) * pow(clamp(1.0 - costTheta, 0.0, 1.0), 5.0);
+}
+
+// DISTRIBUTION GGX
+float distributionGGX(vec3 N, vec3 H, float roughness)
+{
+    float a = roughness * roughness;
+    float a2 = a * a;
+    float NdotH = max(dot(N,H),0.0);
+    float NdotH2 = NdotH * NdotH;
+
+    float num = a2;
+    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+    denom = PI * denom * denom;
+    return num / denom;
+}
+
+// GEOMETRIC SCHLICKGGX
+float GeometricSchlickGGX(float NdotV, float roughness)
+{
+    float r = roughness + 1.0;
+    float k = (r*r)/8.0;
+
+    float num = NdotV;
+    float denom = NdotV * (1.0 - k) + k;
+
+    return num / denom;
+}
+
+// GEOMETRIC SMITH
+float geometricSmith(vec3 N, vec3 V, vec3 L, float roughness)
+{
+    float NdotV = max(dot(N,V),0.0);
+    float NdotL = max(dot(N,L),0.0);
+    float ggx2 = GeometricSchlickGGX(NdotV, roughness);
+    float ggx1 = GeometricSchlickGGX(NdotL, roughness);
+
+    return ggx1 * ggx2;
+}
+
+// Inverse of octahedralEncode in shader.frag
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// Same as reconstructWorldPosition in lighting.frag
+vec3 reconstructWorldPosition(vec2 uv, float depth, mat4 invVP) {
+    vec4 worldPos = invVP * vec4(uv * 2.0 - 1.0, depth, 1.0);
+    return worldPos.xyz / worldPos.w;
+}
+
+// Cook-Torrance term of one light, radiance already attenuated
+vec3 evaluateBRDF(vec3 N, vec3 V, vec3 L, vec3 radiance, vec3 albedoColor, float metallic, float roughness)
+{
+    vec3 H = normalize(V + L);
+
+    vec3 F0 = mix(vec3(0.04), albedoColor, metallic);
+    vec3 F = fresnelShlick(max(dot(H, V), 0.0), F0);
+
+    float NDF = distributionGGX(N, H, roughness);
+    float G = geometricSmith(N, V, L, roughness);
+
+    vec3 numerator = NDF * G * F;
+    float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.001;
+    vec3 specular = numerator / denominator;
+
+    vec3 kD = (vec3(1.0) - F) * (1.0 - metallic);
+
+    float NdotL = max(dot(N, L), 0.0);
+    return (kD * albedoColor / PI + specular) * radiance * NdotL;
+}
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy * screenSizePush.inverseScreenSize;
+    float depth = texture(gDepth, uv).r;
+    vec3 WorldPos = reconstructWorldPosition(uv, depth, screenSizePush.inverseViewProjection);
+
+    PointLight light = Pointlights[lightIndex];
+    vec3 toLight = light.position - WorldPos;
+    float distance = length(toLight);
+    if (distance >= light.radius) {
+        discard;
+    }
+
+    vec3 albedoColor = texture(gAlbedo, uv).rgb;
+    vec3 N = octahedralDecode(texture(gNormal, uv).rg);
+
+    vec4 metallicRoughness = texture(gMetallicRoughness, uv);
+    float metallic = metallicRoughness.r;
+    float roughness = metallicRoughness.g;
+
+    // Eye position from the view matrix, so lighting does not depend on cameraPos being filled in
+    mat3 viewRotation = mat3(cameraUBO.view);
+    vec3 eyePos = -transpose(viewRotation) * cameraUBO.view[3].xyz;
+    vec3 V = normalize(eyePos - WorldPos);
+
+    float attenuationFactor = 1000.0;
+    if (distance > 0.0) {
+        float normalizedDistance = distance / light.radius;
+        attenuationFactor = (1.0 - normalizedDistance * normalizedDistance) / (distance * distance);
+    }
+
+    vec3 radiance = light.color * light.lumen * attenuationFactor;
+
+    // Alpha stays as the lighting.frag pass wrote it
+    outColor = vec4(evaluateBRDF(N, V, toLight / max(distance, 1e-5), radiance, albedoColor, metallic, roughness), 0.0);
+}
@@ -0,0 +1,57 @@
+#version 450
+
+// Light-volume pass: every instance draws a low-poly sphere around one point light, generated
+// from gl_VertexIndex so no vertex buffer is bound. The sphere is built counter-clockwise seen
+// from outside; the pipeline culls front faces, so the volume still covers the screen when the
+// camera is inside it.
+
+layout(binding = 9) uniform CameraUniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    vec3 cameraPos;
+} cameraUBO;
+
+struct PointLight{
+    vec3 position;
+    vec3 color;
+    float lumen;
+    float radius;
+};
+
+layout(std430, binding = 10) readonly buffer PointLightBuffer
+{
+    PointLight Pointlights[];
+};
+
+layout(location = 0) flat out uint lightIndex;
+
+// Must match LIGHT_VOLUME_SEGMENTS and LIGHT_VOLUME_RINGS in VulkanUtils.h
+const uint SEGMENTS = 12;
+const uint RINGS = 8;
+const float PI = 3.14159265359;
+
+// The facets of the tessellated sphere cut inside the light's sphere; widest at the equator,
+// where a facet's plane lies sqrt(1 - sin^2(half segment) - sin^2(half ring)) from the centre
+const float ENCLOSING_SCALE = 1.0 / sqrt(1.0 - pow(sin(PI / float(SEGMENTS)), 2.0) - pow(sin(PI / float(2u * RINGS)), 2.0));
+
+// Two triangles per quad of the longitude/latitude grid
+const uvec2 QUAD_CORNERS[6] = uvec2[](
+    uvec2(0, 0), uvec2(1, 0), uvec2(1, 1),
+    uvec2(0, 0), uvec2(1, 1), uvec2(0, 1));
+
+void main()
+{
+    uint quad = uint(gl_VertexIndex) / 6u;
+    uvec2 corner = QUAD_CORNERS[uint(gl_VertexIndex) % 6u];
+
+    float phi = float(quad % SEGMENTS + corner.x) / float(SEGMENTS) * 2.0 * PI;
+    float theta = float(quad / SEGMENTS + corner.y) / float(RINGS) * PI;
+    vec3 direction = vec3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+
+    // Removed lights have no radius and collapse to a point, which rasterizes nothing
+    PointLight light = Pointlights[gl_InstanceIndex];
+    vec3 worldPos = light.position + direction * (light.radius * ENCLOSING_SCALE);
+
+    lightIndex = uint(gl_InstanceIndex);
+    gl_Position = cameraUBO.proj * cameraUBO.view * vec4(worldPos, 1.0);
+}
@@ -5,10 +5,9 @@ layout(location = 0) in vec2 fragTexCoord; // Fullscreen quad UVs
 
 // G-Buffer texture inputs
 layout(binding = 0) uniform sampler2D gAlbedo;
-layout(binding = 1) uniform sampler2D gAO;
-layout(binding = 2) uniform sampler2D gNormal;
-layout(binding = 3) uniform sampler2D gMetallicRoughness;
-layout(binding = 4) uniform sampler2D gDepth; // We'll sample depth to reconstruct world position
+layout(binding = 1) uniform sampler2D gNormal;            // octahedral encoded world normal
+layout(binding = 2) uniform sampler2D gMetallicRoughness; // r metallic, g roughness, b ambient occlusion
+layout(binding = 3) uniform sampler2D gDepth; // We'll sample depth to reconstruct world position
 
 // Output for the HDR color image
 layout(location = 0) out vec4 outColor;
@@ -34,17 +33,28 @@ struct DirectionalLight{
 
 layout(binding = 8 ) uniform LightUniformBufferObject
 {
-    PointLight Pointlights[4];
     DirectionalLight DirectionalLight;
-    int numlights;
+    uint pointLightCount;
 }LightUBO;
 
+// Sized at runtime, the first LightUBO.pointLightCount entries are valid
+layout(std430, binding = 10) readonly buffer PointLightBuffer
+{
+    PointLight Pointlights[];
+};
+
 // Push constants for screen size (to reconstruct world position from depth)
 layout(push_constant) uniform ScreenSizePush {
     vec2 inverseScreenSize; // 1.0 / width, 1.0 / height
     mat4 inverseViewProjection; // Inverse of cameraUBO.proj * cameraUBO.view
 } screenSizePush;
 
+// Baked per pipeline variant so disabled terms are compiled out
+layout(constant_id = 1) const bool ENABLE_DIRECTIONAL_LIGHT = true;
+layout(constant_id = 2) const bool ENABLE_AO = true;
+// Off in the light-volume path, where light_volume.frag adds the point lights afterwards
+layout(constant_id = 3) const bool ENABLE_POINT_LIGHTS = true;
+
 const float PI = 3.14159265359;
 
 // FRESNELSHLICK
@@ -90,6 +100,15 @@ float geometricSmith(vec3 N, vec3 V, vec3 L, float roughness)
     return ggx1 * ggx2;
 }
 
+// Inverse of octahedralEncode in shader.frag
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
 // Function to reconstruct world position from depth buffer and camera parameters
 vec3 reconstructWorldPosition(vec2 uv, float depth, mat4 invVP) {
     // Convert UV to normalized device coordinates (NDC)
@@ -102,13 +121,12 @@ vec3 reconstructWorldPosition(vec2 uv, float depth, mat4 invVP) {
 void main() {
     // Sample G-Buffer textures
     vec3 albedoColor = texture(gAlbedo, fragTexCoord).rgb;
-    float ao = texture(gAO, fragTexCoord).r; // AO is in the red channel
-
-    vec3 N = normalize(texture(gNormal, fragTexCoord).rgb);
+    vec3 N = octahedralDecode(texture(gNormal, fragTexCoord).rg);
 
     vec4 metallicRoughness = texture(gMetallicRoughness, fragTexCoord);
     float metallic = metallicRoughness.r;
     float roughness = metallicRoughness.g;
+    float ao = ENABLE_AO ? metallicRoughness.b : 1.0;
 
     // Reconstruct world position from depth
     float depth = texture(gDepth, fragTexCoord).r; // Depth is usually in R channel
@@ -119,14 +137,15 @@ void main() {
     vec3 Lo = vec3(0.0);
 
     // Point Lights
-    for(int i = 0; i < LightUBO.numlights; ++ i)
+    uint pointLightCount = ENABLE_POINT_LIGHTS ? LightUBO.pointLightCount : 0u;
+    for(uint i = 0; i < pointLightCount; ++ i)
     {
-        vec3 L = normalize(LightUBO.Pointlights[i].position - WorldPos);
+        vec3 L = normalize(Pointlights[i].position - WorldPos);
         vec3 H = normalize(V + L);
 
-        float distance = length(LightUBO.Pointlights[i].position - WorldPos);
+        float distance = length(Pointlights[i].position - WorldPos);
 
-        float normalizedDistance = clamp(distance / LightUBO.Pointlights[i].radius, 0.0, 1.0);
+        float normalizedDistance = clamp(distance / Pointlights[i].radius, 0.0, 1.0);
         float attenuationFactor = 1.0;
         if (distance > 0.0) {
             float invSqAttenuation = 1.0 / (distance * distance);
@@ -137,7 +156,7 @@ void main() {
             attenuationFactor = 1000.0;
         }
 
-        vec3 radiance = LightUBO.Pointlights[i].color * LightUBO.Pointlights[i].lumen * attenuationFactor;
+        vec3 radiance = Pointlights[i].color * Pointlights[i].lumen * attenuationFactor;
 
         vec3 F0_dielectric = vec3(0.04);
         vec3 F0 = mix(F0_dielectric, albedoColor, metallic);
@@ -159,27 +178,30 @@ void main() {
     }
 
     // Directional Light
-    vec3 L_dir = normalize(-LightUBO.DirectionalLight.direction); // Renamed to avoid conflict
-    vec3 H_dir = normalize(V + L_dir); // Renamed to avoid conflict
-    vec3 radiance_dir = LightUBO.DirectionalLight.color * LightUBO.DirectionalLight.lux;
+    if (ENABLE_DIRECTIONAL_LIGHT)
+    {
+        vec3 L_dir = normalize(-LightUBO.DirectionalLight.direction); // Renamed to avoid conflict
+        vec3 H_dir = normalize(V + L_dir); // Renamed to avoid conflict
+        vec3 radiance_dir = LightUBO.DirectionalLight.color * LightUBO.DirectionalLight.lux;
 
-    vec3 F0_dielectric_dir = vec3(0.04);
-    vec3 F0_dir = mix(F0_dielectric_dir, albedoColor, metallic);
-    vec3 F_dir = fresnelShlick(max(dot(H_dir, V), 0.0), F0_dir);
+        vec3 F0_dielectric_dir = vec3(0.04);
+        vec3 F0_dir = mix(F0_dielectric_dir, albedoColor, metallic);
+        vec3 F_dir = fresnelShlick(max(dot(H_dir, V), 0.0), F0_dir);
 
-    float NDF_dir = distributionGGX(N, H_dir, roughness);
-    float G_dir = geometricSmith(N, V, L_dir, roughness);
+        float NDF_dir = distributionGGX(N, H_dir, roughness);
+        float G_dir = geometricSmith(N, V, L_dir, roughness);
 
-    vec3 numerator_dir = NDF_dir * G_dir * F_dir;
-    float denominator_dir = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L_dir), 0.0) + 0.001;
-    vec3 specular_dir = numerator_dir / denominator_dir;
+        vec3 numerator_dir = NDF_dir * G_dir * F_dir;
+        float denominator_dir = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L_dir), 0.0) + 0.001;
+        vec3 specular_dir = numerator_dir / denominator_dir;
 
-    vec3 kS_dir = F_dir;
-    vec3 kD_dir = vec3(1.0) - kS_dir;
-    kD_dir *= 1.0 - metallic;
+        vec3 kS_dir = F_dir;
+        vec3 kD_dir = vec3(1.0) - kS_dir;
+        kD_dir *= 1.0 - metallic;
 
-    float NdotL_dir = max(dot(N, L_dir), 0.0);
-    Lo += (kD_dir * albedoColor / PI + specular_dir) * radiance_dir * NdotL_dir;
+        float NdotL_dir = max(dot(N, L_dir), 0.0);
+        Lo += (kD_dir * albedoColor / PI + specular_dir) * radiance_dir * NdotL_dir;
+    }
 
     // Ambient term
     vec3 ambient = vec3(0.03) * albedoColor * ao; // Use the AO from G-Buffer
@@ -1,4 +1,5 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 // Vertex shader outputs (inputs to this fragment shader)
 layout(location = 0) in vec3 fragColor; 
@@ -6,20 +7,31 @@ layout(location = 1) in vec2 fragTexCoord;
 layout(location = 2) in vec3 fragNormal;
 layout(location = 3) in vec3 WorldPos;
 layout(location = 4) in vec3 fragTangent;
+layout(location = 5) flat in uint fragMaterialIndex;
 
 // Output attachments for the G-Buffer
+// World position is not stored, the lighting pass rebuilds it from depth
 layout(location = 0) out vec4 gAlbedo;          
-layout(location = 1) out vec4 gAO;              
-layout(location = 2) out vec4 gNormal;          
-layout(location = 3) out vec4 gMetallicRoughness;
-layout(location = 4) out vec4 gWorldPos;
-
-// Texture maps (inputs for material properties)
-layout(binding = 2) uniform sampler2D albedoMap;
-layout(binding = 3) uniform sampler2D normalMap;
-layout(binding = 4) uniform sampler2D metallicMap;
-layout(binding = 5) uniform sampler2D roughnessMap;
-layout(binding = 6) uniform sampler2D aoMap;
+layout(location = 1) out vec2 gNormal;            // octahedral encoded
+layout(location = 2) out vec4 gMetallicRoughness; // r metallic, g roughness, b ambient occlusion
+
+// Bindless material textures: one array for every material, indexed through the material buffer.
+// The array is runtime-sized, the layout reserves MAX_BINDLESS_TEXTURES and only used slots are written.
+const uint NO_TEXTURE = 0xFFFFFFFFu;
+
+struct Material {
+    uint albedo;
+    uint normal;
+    uint metallic;
+    uint roughness;
+    uint ao;
+};
+
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(std430, set = 1, binding = 1) readonly buffer MaterialBuffer {
+    Material materials[];
+};
 
 layout(push_constant) uniform Push {
     mat4 transform;    
@@ -30,15 +42,29 @@ layout(binding = 1) uniform ModelUniformBufferObject { // Matches globalBinding[
     mat4 model; 
 } modelUBO;
 
+// Maps a unit vector onto the [-1, 1] square: project onto the octahedron |x|+|y|+|z| = 1
+// and fold the lower half over the diagonals
+vec2 octahedralEncode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signs;
+}
 
 void main() {
-     // Sample material properties from textures
-    vec3 albedoColor = texture(albedoMap, fragTexCoord).rgb;
-    vec3 tangentNormal = texture(normalMap, fragTexCoord).rgb * 2.0 - 1.0;  
-    float metallic = texture(metallicMap, fragTexCoord).r;
-    float roughness = texture(roughnessMap, fragTexCoord).r;
-    float ao = texture(aoMap, fragTexCoord).r;
+    Material material = materials[fragMaterialIndex];
 
+    // nonuniformEXT: draws with different materials can share a subgroup once draws are batched
+    vec3 albedoColor = material.albedo != NO_TEXTURE ?
+        texture(textures[nonuniformEXT(material.albedo)], fragTexCoord).rgb : vec3(1.0);
+    vec3 tangentNormal = material.normal != NO_TEXTURE ?
+        texture(textures[nonuniformEXT(material.normal)], fragTexCoord).rgb * 2.0 - 1.0 : vec3(0.0, 0.0, 1.0);
+    float metallic = material.metallic != NO_TEXTURE ?
+        texture(textures[nonuniformEXT(material.metallic)], fragTexCoord).r : 0.0;
+    float roughness = material.roughness != NO_TEXTURE ?
+        texture(textures[nonuniformEXT(material.roughness)], fragTexCoord).r : 1.0;
+    float ao = material.ao != NO_TEXTURE ?
+        texture(textures[nonuniformEXT(material.ao)], fragTexCoord).r : 1.0;
 
     vec3 T = normalize(fragTangent);
     vec3 N = normalize(fragNormal);
@@ -48,8 +74,6 @@ void main() {
 
     // Output to G-Buffer attachments
     gAlbedo = vec4(albedoColor, 1.0); 
-    gAO = vec4(ao, 0.0, 0.0, 1.0);   
-    gNormal = vec4(worldSpaceNormal * 0.5 + 0.5, 1.0);
-    gMetallicRoughness = vec4(metallic, roughness, 0.0, 1.0);
-    gWorldPos = vec4(WorldPos, 1.0);    
+    gNormal = octahedralEncode(worldSpaceNormal);
+    gMetallicRoughness = vec4(metallic, roughness, ao, 1.0);
 }
@@ -24,6 +24,7 @@ layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec3 fragNormal;   // World-space normal
 layout(location = 3) out vec3 WorldPos;     // World-space position
 layout(location = 4) out vec3 fragTangent;  // World-space tangent
+layout(location = 5) flat out uint fragMaterialIndex; // Bindless material, drawn as firstInstance
 
 // Push constants
 layout(push_constant) uniform Push {
@@ -31,6 +32,9 @@ layout(push_constant) uniform Push {
     mat4 modelMatrix;   // Model matrix
 } push;
 
+// Must match depth_prepass.vert exactly, the G-buffer pass tests its depth with EQUAL after a pre-pass
+invariant gl_Position;
+
 void main() {
     // Calculate world-space position
     vec4 positionWorld = modelUBO.model  * vec4(inPosition, 1.0);
@@ -53,4 +57,7 @@ void main() {
 
     // Pass color (if needed, otherwise can be removed)
     fragColor = inColor;
+
+    // Every draw is a single instance whose firstInstance is the material index
+    fragMaterialIndex = uint(gl_InstanceIndex);
 }
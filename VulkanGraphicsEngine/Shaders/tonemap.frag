@@ -7,9 +7,11 @@ layout(binding = 0) uniform sampler2D hdrTexture;
 
 layout(push_constant) uniform ToneMapPush {
     float exposure;
-    int tonemapOperator; // 0=Reinhard, 1=ACES, 2=Uncharted2
 } push;
 
+// Baked per pipeline variant: 0=Reinhard, 1=ACES, 2=Uncharted2
+layout(constant_id = 0) const int TONEMAP_OPERATOR = 1;
+
 // Reinhard tone mapping
 vec3 reinhard(vec3 color) {
     return color / (color + vec3(1.0));
@@ -51,9 +53,9 @@ void main() {
     
     // Apply tone mapping
     vec3 mapped;
-    if (push.tonemapOperator == 0) {
+    if (TONEMAP_OPERATOR == 0) {
         mapped = reinhard(hdrColor);
-    } else if (push.tonemapOperator == 1) {
+    } else if (TONEMAP_OPERATOR == 1) {
         mapped = aces(hdrColor);
     } else {
         mapped = uncharted2(hdrColor);
@@ -8,9 +8,36 @@ void VulkanDepthBuffer::CleanupDepthBuffer()
 	if(context)
 	{
 		vkDestroyImageView(context->GetDevice(), depthImageView, nullptr);
+		vkDestroyImageView(context->GetDevice(), depthResolveImageView, nullptr);
 		vmaDestroyImage(context->GetVMAAllocator(), depthImage, depthImageAllocation);
-		vmaDestroyImage(context->GetVMAAllocator(), DepthResolveImage, depthImageAllocation);
+		vmaDestroyImage(context->GetVMAAllocator(), DepthResolveImage, depthResolveImageAllocation);
 	}
+
+	depthImageView = VK_NULL_HANDLE;
+	depthResolveImageView = VK_NULL_HANDLE;
+	depthImage = VK_NULL_HANDLE;
+	DepthResolveImage = VK_NULL_HANDLE;
+	depthImageAllocation = nullptr;
+	depthResolveImageAllocation = nullptr;
+}
+
+void VulkanDepthBuffer::ReleaseDepthBuffer()
+{
+	if (context)
+	{
+		VulkanDeletionQueue& deletionQueue = context->GetDeletionQueue();
+		deletionQueue.DestroyImageView(depthImageView);
+		deletionQueue.DestroyImageView(depthResolveImageView);
+		deletionQueue.DestroyImage(depthImage, depthImageAllocation);
+		deletionQueue.DestroyImage(DepthResolveImage, depthResolveImageAllocation);
+	}
+
+	depthImageView = VK_NULL_HANDLE;
+	depthResolveImageView = VK_NULL_HANDLE;
+	depthImage = VK_NULL_HANDLE;
+	DepthResolveImage = VK_NULL_HANDLE;
+	depthImageAllocation = nullptr;
+	depthResolveImageAllocation = nullptr;
 }
 
 void VulkanDepthBuffer::CreateDepthResources(VkExtent2D swapchainExtent)
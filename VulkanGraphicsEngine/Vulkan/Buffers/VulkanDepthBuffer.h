@@ -11,6 +11,9 @@ public:
 
 	void CleanupDepthBuffer();
 
+	// Hands the depth images and views to the deletion queue instead of destroying them immediately
+	void ReleaseDepthBuffer();
+
 	void CreateDepthResources(VkExtent2D swapchainExtent);
 
 	VkImageView GetDepthImageView() { return depthImageView; }
@@ -25,7 +28,7 @@ private:
 	VkImage DepthResolveImage = VK_NULL_HANDLE;
 	VkImageView depthResolveImageView = VK_NULL_HANDLE;
 	VkImageView depthImageView = VK_NULL_HANDLE;
-	VmaAllocation depthImageAllocation;
-	VmaAllocation depthResolveImageAllocation;
+	VmaAllocation depthImageAllocation = nullptr;
+	VmaAllocation depthResolveImageAllocation = nullptr;
 };
 #endif
\ No newline at end of file
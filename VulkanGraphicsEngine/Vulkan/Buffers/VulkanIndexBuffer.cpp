@@ -7,6 +7,18 @@ void VulkanIndexBuffer::CleanupIndexBuffer()
 	{
 		vmaDestroyBuffer(context->GetVMAAllocator(), indexBuffer, indexAllocation);
 	}
+	indexBuffer = VK_NULL_HANDLE;
+	indexAllocation = nullptr;
+}
+
+void VulkanIndexBuffer::ReleaseIndexBuffer()
+{
+	if (context)
+	{
+		context->GetDeletionQueue().DestroyBuffer(indexBuffer, indexAllocation);
+	}
+	indexBuffer = VK_NULL_HANDLE;
+	indexAllocation = nullptr;
 }
 
 void VulkanIndexBuffer::CreateIndexBuffer(std::vector<uint32_t> indices)
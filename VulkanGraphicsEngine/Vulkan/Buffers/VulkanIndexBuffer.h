@@ -10,6 +10,8 @@ public:
 
 	void CreateIndexBuffer(std::vector<uint32_t> indices);
 	void CleanupIndexBuffer();
+	// Hands the buffer to the deletion queue instead of destroying it immediately
+	void ReleaseIndexBuffer();
 
 	VkBuffer GetIndexBuffer() { return indexBuffer; }
 
@@ -19,7 +21,7 @@ private:
 	VulkanContext* context;
 
 
-	VkBuffer indexBuffer;
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
 	VmaAllocation indexAllocation = nullptr;
 };
 
@@ -29,6 +29,16 @@ void VulkanUniformBuffer::CleanupUniformBuffer()
 		managedBuffer.destroy(allocator);
 	}
 	LightUBO.clear();
+
+	for (auto& managedBuffer : ClusterUBOs) {
+		managedBuffer.destroy(allocator);
+	}
+	ClusterUBOs.clear();
+
+	for (auto& managedBuffer : ClusterGridBuffers) {
+		managedBuffer.destroy(allocator);
+	}
+	ClusterGridBuffers.clear();
 	
 
 }
@@ -38,6 +48,15 @@ void VulkanUniformBuffer::InitBuffers()
 	CreatreUBO<ModelUBO>(ModelUBOs);
 	CreatreUBO<CameraUBO>(CameraUBOs);
 	CreatreUBO<SceneLightingUBO>(LightUBO);
+
+	CreatreUBO<ClusterUBO>(ClusterUBOs);
+
+	ClusterGridBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		VulkanUtils::CreateBuffer(context->GetVMAAllocator(), VkDeviceSize(CLUSTER_COUNT) * (1 + MAX_LIGHTS_PER_CLUSTER) * sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			ClusterGridBuffers[i].buffer, VMA_MEMORY_USAGE_GPU_ONLY, ClusterGridBuffers[i].allocation);
+	}
 }
 
 
@@ -77,6 +77,11 @@ public:
 	const std::vector<ManagedUBO>& GetCameraUBOs() const { return CameraUBOs; }
 	const std::vector<ManagedUBO>& GetSceneLightsUBOs() const { return LightUBO; }
 
+	const std::vector<ManagedUBO>& GetClusterUBOs() const { return ClusterUBOs; }
+	// Device-local light lists of the clustered forward path, written by cluster_lights.comp.
+	// One per frame in flight so binning never waits on the previous frame's shading.
+	const std::vector<ManagedUBO>& GetClusterGridBuffers() const { return ClusterGridBuffers; }
+
 	template<typename T>
 	void CreatreUBO(std::vector<ManagedUBO>& UBO)
 	{
@@ -103,6 +108,8 @@ private:
 	std::vector<ManagedUBO> ModelUBOs;
 	std::vector<ManagedUBO> CameraUBOs;
 	std::vector<ManagedUBO> LightUBO;
+	std::vector<ManagedUBO> ClusterUBOs;
+	std::vector<ManagedUBO> ClusterGridBuffers;
 	
 };
 
@@ -9,6 +9,18 @@ void VulkanVertexBuffer::CleanupVertexBuffer()
 	{
 		vmaDestroyBuffer(context->GetVMAAllocator(), vertexBuffer, VertexAllocation);
 	}
+	vertexBuffer = VK_NULL_HANDLE;
+	VertexAllocation = nullptr;
+}
+
+void VulkanVertexBuffer::ReleaseVertexBuffer()
+{
+	if (context)
+	{
+		context->GetDeletionQueue().DestroyBuffer(vertexBuffer, VertexAllocation);
+	}
+	vertexBuffer = VK_NULL_HANDLE;
+	VertexAllocation = nullptr;
 }
 
 
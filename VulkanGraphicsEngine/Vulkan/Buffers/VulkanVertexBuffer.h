@@ -12,6 +12,8 @@ public:
 
 	void CreateVertexBuffer(std::vector<Vertex> vertices);
 	void CleanupVertexBuffer();
+	// Hands the buffer to the deletion queue instead of destroying it immediately
+	void ReleaseVertexBuffer();
 
 
 	VkBuffer GetVertexBuffer() { return vertexBuffer; }
@@ -23,7 +25,7 @@ public:
 private:
 
 	VulkanContext* context;
-	VkBuffer vertexBuffer;
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
 
 	VmaAllocation VertexAllocation = nullptr;
 	
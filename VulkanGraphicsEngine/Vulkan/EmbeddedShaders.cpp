@@ -0,0 +1,41 @@
+#include "EmbeddedShaders.h"
+#include <iterator>
+#include <unordered_map>
+
+// Generated at build time into the binary directory
+#include "EmbeddedShaderData.inl"
+
+namespace
+{
+	const std::unordered_map<std::string_view, const EmbeddedShader*>& GetRegistry()
+	{
+		static const std::unordered_map<std::string_view, const EmbeddedShader*> registry = [] {
+			std::unordered_map<std::string_view, const EmbeddedShader*> shaders;
+			for (const EmbeddedShader& shader : EMBEDDED_SHADER_TABLE)
+			{
+				if (shader.name != nullptr) {
+					shaders.emplace(shader.name, &shader);
+				}
+			}
+			return shaders;
+			}();
+		return registry;
+	}
+}
+
+const EmbeddedShader* EmbeddedShaders::Find(std::string_view spirvPath)
+{
+	const size_t separator = spirvPath.find_last_of("/\\");
+	if (separator != std::string_view::npos) {
+		spirvPath.remove_prefix(separator + 1);
+	}
+
+	const auto& registry = GetRegistry();
+	auto it = registry.find(spirvPath);
+	return it != registry.end() ? it->second : nullptr;
+}
+
+size_t EmbeddedShaders::GetCount()
+{
+	return GetRegistry().size();
+}
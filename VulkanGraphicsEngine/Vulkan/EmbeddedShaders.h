@@ -0,0 +1,33 @@
+#ifndef EMBEDDED_SHADERS_H
+#define EMBEDDED_SHADERS_H
+
+#include "VulkanUtils.h"
+#include <string_view>
+
+// SPIR-V compiled into the binary. The build turns every Shaders/*.spv into a constexpr
+// uint32_t array (see Shaders/EmbedSpirv.cmake), so pipelines can be created without the
+// Shaders directory next to the executable and without any file I/O.
+struct EmbeddedShader
+{
+	const char* name;       // file name of the compiled shader, e.g. "lighting.frag.spv"
+	const uint32_t* code;
+	size_t wordCount;
+
+	size_t GetSizeInBytes() const { return wordCount * sizeof(uint32_t); }
+};
+
+namespace EmbeddedShaders
+{
+	//**
+	// Returns the embedded shader with this file name, or nullptr. Any directory part is ignored,
+	// so "Shaders/lighting.frag.spv" and "lighting.frag.spv" both resolve.
+	//**
+	const EmbeddedShader* Find(std::string_view spirvPath);
+
+	//**
+	// Returns the number of embedded shaders
+	//**
+	size_t GetCount();
+}
+
+#endif
@@ -0,0 +1,254 @@
+#include "FrustumCulling.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#if defined(__AVX__)
+#define FRUSTUM_CULLING_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLING_SSE
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define FRUSTUM_CULLING_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	// A plane with the box arrays of its positive vertex: the corner furthest along the normal takes
+	// max on axes where the normal is positive and min elsewhere. If that corner is behind the
+	// plane, the whole box is.
+	struct CullPlane
+	{
+		float nx, ny, nz, w;
+		const float* xs;
+		const float* ys;
+		const float* zs;
+	};
+
+	// Deterministic boxes scattered around a camera at the origin, for the benchmark
+	void FillBenchmarkBoxes(FrustumCuller& culler, uint32_t count)
+	{
+		std::mt19937 generator(1337);
+		std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> halfSize(0.5f, 4.0f);
+
+		culler.Clear();
+		culler.Reserve(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const glm::vec3 center(position(generator), position(generator), position(generator));
+			const glm::vec3 extent(halfSize(generator), halfSize(generator), halfSize(generator));
+			culler.AddBox(center - extent, center + extent);
+		}
+	}
+}
+
+void FrustumCuller::Clear()
+{
+	minX.clear(); minY.clear(); minZ.clear();
+	maxX.clear(); maxY.clear(); maxZ.clear();
+}
+
+void FrustumCuller::Reserve(size_t boxCount)
+{
+	minX.reserve(boxCount); minY.reserve(boxCount); minZ.reserve(boxCount);
+	maxX.reserve(boxCount); maxY.reserve(boxCount); maxZ.reserve(boxCount);
+}
+
+uint32_t FrustumCuller::AddBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	minX.push_back(boundsMin.x); minY.push_back(boundsMin.y); minZ.push_back(boundsMin.z);
+	maxX.push_back(boundsMax.x); maxY.push_back(boundsMax.y); maxZ.push_back(boundsMax.z);
+	return static_cast<uint32_t>(minX.size() - 1);
+}
+
+void FrustumCuller::CullScalar(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& visibleIndices) const
+{
+	visibleIndices.clear();
+
+	const uint32_t count = GetBoxCount();
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const glm::vec3 boundsMin(minX[i], minY[i], minZ[i]);
+		const glm::vec3 boundsMax(maxX[i], maxY[i], maxZ[i]);
+
+		bool visible = true;
+		for (const glm::vec4& plane : planes)
+		{
+			const glm::vec3 normal(plane);
+			const glm::vec3 positiveVertex = glm::mix(boundsMin, boundsMax, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+			if (glm::dot(normal, positiveVertex) + plane.w < 0.0f) {
+				visible = false;
+				break;
+			}
+		}
+		if (visible) {
+			visibleIndices.push_back(i);
+		}
+	}
+}
+
+void FrustumCuller::Cull(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& visibleIndices) const
+{
+	visibleIndices.clear();
+
+	std::array<CullPlane, 6> cullPlanes;
+	for (size_t p = 0; p < planes.size(); ++p)
+	{
+		const glm::vec4& plane = planes[p];
+		cullPlanes[p] = {
+			plane.x, plane.y, plane.z, plane.w,
+			plane.x >= 0.0f ? maxX.data() : minX.data(),
+			plane.y >= 0.0f ? maxY.data() : minY.data(),
+			plane.z >= 0.0f ? maxZ.data() : minZ.data(),
+		};
+	}
+
+	const uint32_t count = GetBoxCount();
+	uint32_t i = 0;
+
+	// Appends the set bits of a lane mask as box indices, lowest lane first
+	auto appendVisible = [&visibleIndices](uint32_t firstBox, uint32_t laneMask) {
+		while (laneMask != 0)
+		{
+			visibleIndices.push_back(firstBox + static_cast<uint32_t>(std::countr_zero(laneMask)));
+			laneMask &= laneMask - 1;
+		}
+		};
+
+#if defined(FRUSTUM_CULLING_AVX)
+	const __m256 zero = _mm256_setzero_ps();
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (const CullPlane& plane : cullPlanes)
+		{
+			__m256 distance = _mm256_mul_ps(_mm256_set1_ps(plane.nx), _mm256_loadu_ps(plane.xs + i));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.ny), _mm256_loadu_ps(plane.ys + i)));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.nz), _mm256_loadu_ps(plane.zs + i)));
+			distance = _mm256_add_ps(distance, _mm256_set1_ps(plane.w));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+		}
+		appendVisible(i, static_cast<uint32_t>(_mm256_movemask_ps(inside)));
+	}
+#elif defined(FRUSTUM_CULLING_SSE)
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const CullPlane& plane : cullPlanes)
+		{
+			__m128 distance = _mm_mul_ps(_mm_set1_ps(plane.nx), _mm_loadu_ps(plane.xs + i));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.ny), _mm_loadu_ps(plane.ys + i)));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.nz), _mm_loadu_ps(plane.zs + i)));
+			distance = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+		}
+		appendVisible(i, static_cast<uint32_t>(_mm_movemask_ps(inside)));
+	}
+#elif defined(FRUSTUM_CULLING_NEON)
+	const float32x4_t zero = vdupq_n_f32(0.0f);
+	const uint32_t laneBitValues[4] = { 1u, 2u, 4u, 8u };
+	const uint32x4_t laneBits = vld1q_u32(laneBitValues);
+	for (; i + 4 <= count; i += 4)
+	{
+		uint32x4_t inside = vdupq_n_u32(~0u);
+		for (const CullPlane& plane : cullPlanes)
+		{
+			float32x4_t distance = vmulq_n_f32(vld1q_f32(plane.xs + i), plane.nx);
+			distance = vmlaq_n_f32(distance, vld1q_f32(plane.ys + i), plane.ny);
+			distance = vmlaq_n_f32(distance, vld1q_f32(plane.zs + i), plane.nz);
+			distance = vaddq_f32(distance, vdupq_n_f32(plane.w));
+			inside = vandq_u32(inside, vcgeq_f32(distance, zero));
+		}
+		appendVisible(i, vaddvq_u32(vandq_u32(inside, laneBits)));
+	}
+#endif
+
+	// Boxes left over after the last full register, and the whole list in a scalar build
+	for (; i < count; ++i)
+	{
+		bool visible = true;
+		for (const CullPlane& plane : cullPlanes)
+		{
+			if (plane.nx * plane.xs[i] + plane.ny * plane.ys[i] + plane.nz * plane.zs[i] + plane.w < 0.0f) {
+				visible = false;
+				break;
+			}
+		}
+		if (visible) {
+			visibleIndices.push_back(i);
+		}
+	}
+}
+
+const char* FrustumCuller::GetSimdName()
+{
+#if defined(FRUSTUM_CULLING_AVX)
+	return "AVX x8";
+#elif defined(FRUSTUM_CULLING_SSE)
+	return "SSE2 x4";
+#elif defined(FRUSTUM_CULLING_NEON)
+	return "NEON x4";
+#else
+	return "scalar";
+#endif
+}
+
+void FrustumCuller::RunBenchmark()
+{
+	const std::array<uint32_t, 3> boxCounts = { 10000, 100000, 1000000 };
+	// Every row tests about this many boxes per variant, so small counts are not lost in timer noise
+	constexpr uint64_t boxesPerRow = 50000000;
+
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	projection[1][1] *= -1;
+	const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const std::array<glm::vec4, 6> planes = MathHelpers::ExtractFrustumPlanes(projection * view);
+
+	std::cout << "Frustum culling benchmark, kernel " << GetSimdName() << std::endl;
+	std::cout << std::setw(10) << "boxes" << std::setw(10) << "visible"
+		<< std::setw(14) << "scalar ms" << std::setw(14) << "simd ms" << std::setw(10) << "speedup" << std::endl;
+
+	FrustumCuller culler;
+	std::vector<uint32_t> scalarVisible;
+	std::vector<uint32_t> simdVisible;
+
+	for (uint32_t boxCount : boxCounts)
+	{
+		FillBenchmarkBoxes(culler, boxCount);
+		scalarVisible.reserve(boxCount);
+		simdVisible.reserve(boxCount);
+		const uint32_t iterations = static_cast<uint32_t>(std::max<uint64_t>(boxesPerRow / boxCount, 1));
+
+		// Average milliseconds of one cull of all boxes
+		auto time = [&](auto&& cull) {
+			cull();
+			const auto start = std::chrono::high_resolution_clock::now();
+			for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+			{
+				cull();
+			}
+			const std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+			return elapsed.count() / iterations;
+			};
+
+		const double scalarMs = time([&] { culler.CullScalar(planes, scalarVisible); });
+		const double simdMs = time([&] { culler.Cull(planes, simdVisible); });
+
+		if (scalarVisible != simdVisible) {
+			std::cerr << "Frustum culling mismatch at " << boxCount << " boxes: scalar " << scalarVisible.size()
+				<< " visible, simd " << simdVisible.size() << std::endl;
+		}
+
+		std::cout << std::setw(10) << boxCount << std::setw(10) << simdVisible.size()
+			<< std::setw(14) << std::fixed << std::setprecision(3) << scalarMs
+			<< std::setw(14) << simdMs
+			<< std::setw(9) << std::setprecision(2) << scalarMs / simdMs << "x" << std::defaultfloat << std::endl;
+	}
+}
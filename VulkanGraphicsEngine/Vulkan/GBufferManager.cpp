@@ -8,41 +8,45 @@ GBufferManager::~GBufferManager()
 	CleanupGBuffer();
 }
 
-void GBufferManager::Initialize(VkExtent2D swapChainExtent,uint32_t miplevels)
+namespace
 {
-	albedoFormat = VK_FORMAT_R8G8B8A8_UNORM; 
-	aoFormat = VK_FORMAT_R8_UNORM;           
-	normalFormat = VK_FORMAT_R16G16B16A16_SFLOAT; 
-	metallicRoughnessFormat = VK_FORMAT_R8G8_UNORM; 
-
-
-	VkSamplerCreateInfo samplerInfo{};
-	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-	samplerInfo.magFilter = VK_FILTER_LINEAR;
-	samplerInfo.minFilter = VK_FILTER_LINEAR;
-	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.anisotropyEnable = VK_TRUE;
-
-	VkPhysicalDeviceProperties properties{};
-	vkGetPhysicalDeviceProperties(context->GetPhysicalDevice(), &properties);
-
-	samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
-	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-	samplerInfo.unnormalizedCoordinates = VK_FALSE;
-	samplerInfo.compareEnable = VK_FALSE;
-	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-	samplerInfo.mipLodBias = 0.0f;
-	samplerInfo.minLod = 0.0f;
-	samplerInfo.maxLod = static_cast<float>(miplevels);
-
-	if (vkCreateSampler(context->GetDevice(), &samplerInfo, nullptr, &gBufferSampler) != VK_SUCCESS)
+	// Bytes one pixel of the G-buffer pass moves: each target is written once per sample, resolved
+	// to a single-sample image and read back once by the lighting pass
+	uint32_t GBufferBytesPerPixel(const std::vector<VkFormat>& formats, VkSampleCountFlagBits samples)
 	{
-		throw std::runtime_error("failed to create texture sampler!");
+		uint32_t bytes = 0;
+		for (VkFormat format : formats)
+		{
+			bytes += VulkanUtils::GetFormatSize(format) * (static_cast<uint32_t>(samples) + 2);
+		}
+		return bytes;
 	}
+}
 
+void GBufferManager::Initialize(VkExtent2D swapChainExtent, const GBufferConfig& config)
+{
+	const VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+	albedoFormat = VulkanUtils::FindSupportedFormat(context->GetPhysicalDevice(), { config.albedoFormat }, VK_IMAGE_TILING_OPTIMAL, requiredFeatures);
+	normalFormat = VulkanUtils::FindSupportedFormat(context->GetPhysicalDevice(), { config.normalFormat }, VK_IMAGE_TILING_OPTIMAL, requiredFeatures);
+	metallicRoughnessFormat = VulkanUtils::FindSupportedFormat(context->GetPhysicalDevice(), { config.metallicRoughnessFormat }, VK_IMAGE_TILING_OPTIMAL, requiredFeatures);
+
+	// Albedo, AO, normal, metallic/roughness and world position targets this layout replaces
+	const std::vector<VkFormat> previousFormats = { VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8_UNORM,
+		VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R8G8_UNORM, VK_FORMAT_R32G32B32A32_SFLOAT };
+	const std::vector<VkFormat> currentFormats = { albedoFormat, normalFormat, metallicRoughnessFormat };
+
+	const VkSampleCountFlagBits samples = context->GetMsaaSamples();
+	const uint32_t previousBytes = GBufferBytesPerPixel(previousFormats, samples);
+	const uint32_t currentBytes = GBufferBytesPerPixel(currentFormats, samples);
+	const double pixelsInMegabytes = static_cast<double>(swapChainExtent.width) * swapChainExtent.height / (1024.0 * 1024.0);
+	std::cout << "G-buffer: " << currentBytes << " bytes/pixel at " << samples << "x MSAA (was " << previousBytes
+		<< "), " << currentBytes * pixelsInMegabytes << " MB per frame at " << swapChainExtent.width << "x" << swapChainExtent.height
+		<< " (was " << previousBytes * pixelsInMegabytes << " MB)" << std::endl;
+
+	// Same description as the material textures, so both share one sampler; the views limit the mips
+	SamplerDesc samplerDesc{};
+	samplerDesc.maxAnisotropy = SamplerDesc::MAX_ANISOTROPY;
+	gBufferSampler = context->GetSamplerCache().GetOrCreateSampler(samplerDesc);
 }
 
 
@@ -53,10 +57,6 @@ void GBufferManager::CreateGBufferResources(VkExtent2D extent)
 		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, albedoImage, 1, context->GetMsaaSamples(), albedoAllocation);
 	albedoImageView = Image::CreateImageView(context->GetDevice(), albedoImage, albedoFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 
-	Image::CreateImage(context->GetVMAAllocator(), extent.width, extent.height, aoFormat, VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, aoImage, 1, context->GetMsaaSamples(), aoAllocation);
-	aoImageView = Image::CreateImageView(context->GetDevice(), aoImage, aoFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-
 	Image::CreateImage(context->GetVMAAllocator(), extent.width, extent.height, normalFormat, VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, normalImage, 1, context->GetMsaaSamples(), normalAllocation);
 	normalImageView = Image::CreateImageView(context->GetDevice(), normalImage, normalFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
@@ -69,10 +69,6 @@ void GBufferManager::CreateGBufferResources(VkExtent2D extent)
 		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,AlbedoImageResolve,1,VK_SAMPLE_COUNT_1_BIT,albedoImageResolveAllocation );
 	albedoImageResolveView = Image::CreateImageView(context->GetDevice(), AlbedoImageResolve, albedoFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 
-	Image::CreateImage(context->GetVMAAllocator(), extent.width, extent.height, aoFormat, VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, aoImageResolve, 1, VK_SAMPLE_COUNT_1_BIT, aoImageResolveAllocation);
-	aoImageResolveView = Image::CreateImageView(context->GetDevice(), aoImageResolve, aoFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-
 	Image::CreateImage(context->GetVMAAllocator(), extent.width, extent.height, normalFormat, VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, normalImageResolve, 1, VK_SAMPLE_COUNT_1_BIT, normalImageResolveAllocation);
 	normalImageResolveView = Image::CreateImageView(context->GetDevice(), normalImageResolve, normalFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
@@ -81,23 +77,38 @@ void GBufferManager::CreateGBufferResources(VkExtent2D extent)
 		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, metallicRoughnessImageResolve, 1, VK_SAMPLE_COUNT_1_BIT, metallicRoughnessImageResolveAllocation);
 	metallicRoughnessImageResolveView = Image::CreateImageView(context->GetDevice(), metallicRoughnessImageResolve, metallicRoughnessFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 
-	Image::CreateImage(context->GetVMAAllocator(), extent.width, extent.height, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, gWorldPosImage, 1, context->GetMsaaSamples(), gWorldPosImageAllocation);
-	gWorldPosImageView = Image::CreateImageView(context->GetDevice(), gWorldPosImage, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-
-	Image::CreateImage(context->GetVMAAllocator(), extent.width, extent.height, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, gWorldPosResolveImage, 1, VK_SAMPLE_COUNT_1_BIT, gWorldPosImageResolveAllocation);
-	gWorldPosResolveImageView = Image::CreateImageView(context->GetDevice(), gWorldPosResolveImage, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+}
 
+void GBufferManager::ReleaseGBufferResources()
+{
+	VulkanDeletionQueue& deletionQueue = context->GetDeletionQueue();
+
+	auto release = [&](VkImage& image, VmaAllocation& allocation, VkImageView& view, VkImageLayout& layout) {
+		if (view != VK_NULL_HANDLE) {
+			deletionQueue.DestroyImageView(view);
+		}
+		if (image != VK_NULL_HANDLE && allocation != VK_NULL_HANDLE) {
+			deletionQueue.DestroyImage(image, allocation);
+		}
+		image = VK_NULL_HANDLE;
+		allocation = VK_NULL_HANDLE;
+		view = VK_NULL_HANDLE;
+		layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		};
+
+	release(albedoImage, albedoAllocation, albedoImageView, albedoImageLayout);
+	release(normalImage, normalAllocation, normalImageView, normalImageLayout);
+	release(metallicRoughnessImage, metallicRoughnessAllocation, metallicRoughnessImageView, metallicRoughnessImageLayout);
+
+	release(AlbedoImageResolve, albedoImageResolveAllocation, albedoImageResolveView, albedoImageResolveLayout);
+	release(normalImageResolve, normalImageResolveAllocation, normalImageResolveView, normalImageResolveLayout);
+	release(metallicRoughnessImageResolve, metallicRoughnessImageResolveAllocation, metallicRoughnessImageResolveView, metallicRoughnessImageResolveLayout);
 }
 
 void GBufferManager::CleanupGBuffer()
 {
-	// Destroy the sampler first
-	if (gBufferSampler != VK_NULL_HANDLE) {
-		vkDestroySampler(context->GetDevice(), gBufferSampler, nullptr);
-		gBufferSampler = VK_NULL_HANDLE; // Set to null to prevent double-free
-	}
+	// The sampler belongs to the context's sampler cache
+	gBufferSampler = VK_NULL_HANDLE;
 
 	// Destroy image views and images with VMA
 	if (metallicRoughnessImageView != VK_NULL_HANDLE) {
@@ -120,16 +131,6 @@ void GBufferManager::CleanupGBuffer()
 		normalAllocation = VK_NULL_HANDLE;
 	}
 
-	if (aoImageView != VK_NULL_HANDLE) {
-		vkDestroyImageView(context->GetDevice(), aoImageView, nullptr);
-		aoImageView = VK_NULL_HANDLE;
-	}
-	if (aoImage != VK_NULL_HANDLE && aoAllocation != VK_NULL_HANDLE) {
-		vmaDestroyImage(context->GetVMAAllocator(), aoImage, aoAllocation);
-		aoImage = VK_NULL_HANDLE;
-		aoAllocation = VK_NULL_HANDLE;
-	}
-
 	if (albedoImageView != VK_NULL_HANDLE) {
 		vkDestroyImageView(context->GetDevice(), albedoImageView, nullptr);
 		albedoImageView = VK_NULL_HANDLE;
@@ -139,10 +140,4 @@ void GBufferManager::CleanupGBuffer()
 		albedoImage = VK_NULL_HANDLE;
 		albedoAllocation = VK_NULL_HANDLE;
 	}
-
-	vkDestroyImageView(context->GetDevice(), gWorldPosImageView, nullptr);
-	vmaDestroyImage(context->GetVMAAllocator(), gWorldPosImage, gWorldPosImageAllocation);
-
-	vkDestroyImageView(context->GetDevice(), gWorldPosResolveImageView, nullptr);
-	vmaDestroyImage(context->GetVMAAllocator(), gWorldPosResolveImage, gWorldPosImageResolveAllocation);
 }
\ No newline at end of file
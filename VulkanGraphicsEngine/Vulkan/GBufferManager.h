@@ -3,72 +3,75 @@
 #include <vector>
 #include "VulkanContext.h" 
 
+// Formats of the G-buffer targets. Every target is an MSAA attachment plus a single-sample
+// resolve that the lighting pass samples; world position is rebuilt from depth, not stored.
+//   albedo:            rgb albedo
+//   normal:            octahedral world normal in [-1, 1], so any two-channel signed/float format
+//   metallicRoughness: r metallic, g roughness, b ambient occlusion
+struct GBufferConfig
+{
+	VkFormat albedoFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	VkFormat normalFormat = VK_FORMAT_R16G16_SFLOAT;
+	VkFormat metallicRoughnessFormat = VK_FORMAT_R8G8B8A8_UNORM;
+};
+
 class GBufferManager {
 public:
     // Constructor now takes VmaAllocator
     GBufferManager(VulkanContext* context);
     ~GBufferManager();
 
-    void Initialize(VkExtent2D swapChainExtent, uint32_t miplevels);
+	//**
+	// Validates the formats of config against the device and prints the memory traffic of
+	// one frame's G-buffer at swapChainExtent next to the previous five-target layout.
+	//**
+	void Initialize(VkExtent2D swapChainExtent, const GBufferConfig& config = {});
     void CreateGBufferResources(VkExtent2D extent);
     void CleanupGBuffer();
 
+	//**
+	// Hands every attachment to the deletion queue (frames in flight may still use them) and
+	// resets the tracked layouts, so CreateGBufferResources can be called again after a resize.
+	// The sampler and formats are kept.
+	//**
+	void ReleaseGBufferResources();
+
     // Getters for G-Buffer image views and formats
     VkImageView GetAlbedoImageView() const { return albedoImageView; }
-    VkImageView GetAOImageView() const { return aoImageView; } 
     VkImageView GetNormalImageView() const { return normalImageView; }
     VkImageView GetMetallicRoughnessImageView() const { return metallicRoughnessImageView; }
 
     VkImage GetAlbedoImage() const { return albedoImage; }
-    VkImage GetAOImage() const { return aoImage; } 
     VkImage GetNormalImage() const { return normalImage; }
     VkImage GetMetallicRoughnessImage() const { return metallicRoughnessImage; }
 
 	VkImage GetAlbedoImageResolve() const { return AlbedoImageResolve; }
-	VkImage GetAOImageResolve() const { return aoImageResolve; }
 	VkImage GetNormalImageResolve() const { return normalImageResolve; }
 	VkImage GetMetallicRoughnessImageResolve() const { return metallicRoughnessImageResolve; }
 
     VkFormat GetAlbedoImageFormat() const { return albedoFormat; }
-    VkFormat GetAOImageFormat() const { return aoFormat; } 
     VkFormat GetNormalImageFormat() const { return normalFormat; }
     VkFormat GetMetallicRoughnessImageFormat() const { return metallicRoughnessFormat; }
 
 	VkImageView GetAlbedoImageResolveView() const { return albedoImageResolveView; }
-	VkImageView GetAOImageResolveView() const { return aoImageResolveView; }
 	VkImageView GetNormalImageResolveView() const { return normalImageResolveView; }
 	VkImageView GetMetallicRoughnessImageResolveView() const { return metallicRoughnessImageResolveView; }
 
-	VkImageView GetGWorldPosImageView() const { return gWorldPosImageView; }
-	VkImageView GetGWorldPosResolveImageView() const { return gWorldPosResolveImageView; }
-	VkImage GetGWorldPosImage() const { return gWorldPosImage; }
-	VkImage GetGWorldPosResolveImage() const { return gWorldPosResolveImage; }
-
     VkSampler GetGBufferSampler() const { return gBufferSampler; }
 
 	VkImageLayout GetAlbedoImageLayout() const { return albedoImageLayout; }
-	VkImageLayout GetAOImageLayout() const { return aoImageLayout; }
 	VkImageLayout GetNormalImageLayout() const { return normalImageLayout; }
 	VkImageLayout GetMetallicRoughnessImageLayout() const { return metallicRoughnessImageLayout; }
 
-	VkImageLayout GetGWorldPosImageLayout() const { return gWorldPosImageLayout; }
-	VkImageLayout GetGWorldPosResolveImageLayout() const { return gWorldPosResolveImageLayout; }
-
 	VkImageLayout GetAlbedoImageResolveLayout() const { return albedoImageResolveLayout; }
-	VkImageLayout GetAOImageResolveLayout() const { return aoImageResolveLayout; }
 	VkImageLayout GetNormalImageResolveLayout() const { return normalImageResolveLayout; }
 	VkImageLayout GetMetallicRoughnessImageResolveLayout() const { return metallicRoughnessImageResolveLayout; }
 
-	void SetGWorldPosImageLayout(VkImageLayout layout) { gWorldPosImageLayout = layout; }
-	void SetGWorldPosResolveImageLayout(VkImageLayout layout) { gWorldPosResolveImageLayout = layout; }
-
 	void SetAlbedoImageLayout(VkImageLayout layout) { albedoImageLayout = layout; }
-	void SetAOImageLayout(VkImageLayout layout) { aoImageLayout = layout; }
 	void SetNormalImageLayout(VkImageLayout layout) { normalImageLayout = layout; }
 	void SetMetallicRoughnessImageLayout(VkImageLayout layout) { metallicRoughnessImageLayout = layout; }
 
 	void SetAlbedoImageResolveLayout(VkImageLayout layout) { albedoImageResolveLayout = layout; }
-	void SetAOImageResolveLayout(VkImageLayout layout) { aoImageResolveLayout = layout; }
 	void SetNormalImageResolveLayout(VkImageLayout layout) { normalImageResolveLayout = layout; }
 	void SetMetallicRoughnessImageResolveLayout(VkImageLayout layout) { metallicRoughnessImageResolveLayout = layout; }
 
@@ -76,15 +79,10 @@ private:
     VulkanContext* context;
   
 	VkImageLayout albedoImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	VkImageLayout aoImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	VkImageLayout normalImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	VkImageLayout metallicRoughnessImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
-	VkImageLayout gWorldPosImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	VkImageLayout gWorldPosResolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-
 	VkImageLayout albedoImageResolveLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	VkImageLayout aoImageResolveLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	VkImageLayout normalImageResolveLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	VkImageLayout metallicRoughnessImageResolveLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     
@@ -97,14 +95,6 @@ private:
 	VmaAllocation albedoImageResolveAllocation;
 	VkImageView albedoImageResolveView;
   
-    VkImage aoImage;
-    VmaAllocation aoAllocation;
-    VkImageView aoImageView;
-    VkFormat aoFormat;
-	VkImage aoImageResolve;
-	VmaAllocation aoImageResolveAllocation;
-	VkImageView aoImageResolveView;
-
     VkImage normalImage;
     VmaAllocation normalAllocation;
     VkImageView normalImageView;
@@ -121,12 +111,5 @@ private:
 	VmaAllocation metallicRoughnessImageResolveAllocation;
 	VkImageView metallicRoughnessImageResolveView;
 
-    VkImage gWorldPosImage;
-	VkImage gWorldPosResolveImage;
-	VmaAllocation gWorldPosImageAllocation;
-	VkImageView gWorldPosImageView;
-	VkImageView gWorldPosResolveImageView;
-	VmaAllocation gWorldPosImageResolveAllocation;
-
     VkSampler gBufferSampler;
 };
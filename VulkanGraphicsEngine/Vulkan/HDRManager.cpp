@@ -17,13 +17,41 @@ HDRManager::~HDRManager() {
 
 void HDRManager::Initialize() {
     CreateHDRResources();
+    CreateHDRSampler();
+}
+
+void HDRManager::RecreateHDRResources() {
+    ReleaseHDRResources();
+    CreateHDRResources();
+}
+
+void HDRManager::ReleaseHDRResources() {
+    // Frames in flight may still render to or sample these
+    VulkanDeletionQueue& deletionQueue = context->GetDeletionQueue();
+    if (hdrResolveImageView != VK_NULL_HANDLE) {
+        deletionQueue.DestroyImageView(hdrResolveImageView);
+    }
+    if (hdrResolveImage != VK_NULL_HANDLE && hdrResolveImageMemory != VK_NULL_HANDLE) {
+        deletionQueue.DestroyImage(hdrResolveImage, hdrResolveImageMemory);
+    }
+    if (hdrMsaaView != VK_NULL_HANDLE) {
+        deletionQueue.DestroyImageView(hdrMsaaView);
+    }
+    if (hdrMsaaImage != VK_NULL_HANDLE && hdrMsaaImageMemory != VK_NULL_HANDLE) {
+        deletionQueue.DestroyImage(hdrMsaaImage, hdrMsaaImageMemory);
+    }
+
+    hdrResolveImageView = VK_NULL_HANDLE;
+    hdrResolveImage = VK_NULL_HANDLE;
+    hdrResolveImageMemory = VK_NULL_HANDLE;
+    hdrMsaaView = VK_NULL_HANDLE;
+    hdrMsaaImage = VK_NULL_HANDLE;
+    hdrMsaaImageMemory = VK_NULL_HANDLE;
 }
 
 void HDRManager::Cleanup() {
-	if (hdrSampler != VK_NULL_HANDLE) {
-		vkDestroySampler(context->GetDevice(), hdrSampler, nullptr);
-		hdrSampler = VK_NULL_HANDLE;
-	}
+	// The sampler belongs to the context's sampler cache
+	hdrSampler = VK_NULL_HANDLE;
 
 	if (hdrResolveImageView != VK_NULL_HANDLE) {
 		vkDestroyImageView(context->GetDevice(), hdrResolveImageView, nullptr);
@@ -53,8 +81,9 @@ void HDRManager::CreateHDRResources() {
     VkSampleCountFlagBits msaaSamples = context->GetMsaaSamples(); 
 
 
+	// Storage: the tiled compute lighting path writes the resolved HDR image directly
 	Image::CreateImage(context->GetVMAAllocator(), extent.width, extent.height, VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
 		hdrResolveImage, 1, VK_SAMPLE_COUNT_1_BIT, hdrResolveImageMemory);
 
 	Image::CreateImage(context->GetVMAAllocator(), extent.width, extent.height, VK_FORMAT_R32G32B32A32_SFLOAT,
@@ -65,25 +94,11 @@ void HDRManager::CreateHDRResources() {
 		VK_IMAGE_ASPECT_COLOR_BIT, 1);
 
     hdrMsaaView = Image::CreateImageView(context->GetDevice(), hdrMsaaImage, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+}
 
-    // Create sampler for HDR texture
-    VkSamplerCreateInfo samplerInfo{};
-    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerInfo.magFilter = VK_FILTER_LINEAR;
-    samplerInfo.minFilter = VK_FILTER_LINEAR;
-    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-    samplerInfo.anisotropyEnable = VK_FALSE;
-    samplerInfo.maxAnisotropy = 1.0f;
-    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-    samplerInfo.unnormalizedCoordinates = VK_FALSE;
-    samplerInfo.compareEnable = VK_FALSE;
-    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-
-    if (vkCreateSampler(context->GetDevice(), &samplerInfo, nullptr, &hdrSampler) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create HDR sampler!");
-    }
+void HDRManager::CreateHDRSampler() {
+    // Sampled 1:1 by the full-screen tonemap pass
+    SamplerDesc samplerDesc{};
+    samplerDesc.SetAddressMode(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+    hdrSampler = context->GetSamplerCache().GetOrCreateSampler(samplerDesc);
 }
- 
\ No newline at end of file
@@ -27,6 +27,12 @@ public:
     void Initialize();
     void Cleanup();
 
+    //**
+    // Recreates the HDR targets at the current swapchain extent, the old ones go through the
+    // deletion queue. The sampler is kept.
+    //**
+    void RecreateHDRResources();
+
 
     // Getters for rendering
     VkImage GetHDRMsaa() const { return hdrMsaaImage; }
@@ -51,7 +57,9 @@ private:
 	VkImageView hdrResolveImageView = VK_NULL_HANDLE;
     VkSampler hdrSampler = VK_NULL_HANDLE;
 
-    void CreateHDRResources();;
+    void CreateHDRResources();
+    void CreateHDRSampler();
+    void ReleaseHDRResources();
 };
 
 
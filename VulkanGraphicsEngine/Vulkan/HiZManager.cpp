@@ -0,0 +1,128 @@
+#include "HiZManager.h"
+#include "VulkanContext.h"
+#include "VulkanSamplerCache.h"
+#include "Image.h"
+#include <algorithm>
+
+void HiZManager::Initialize(VkExtent2D depthExtent)
+{
+	SamplerDesc samplerDesc{};
+	samplerDesc.SetFilter(VK_FILTER_NEAREST, VK_SAMPLER_MIPMAP_MODE_NEAREST)
+		.SetAddressMode(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+	sampler = context->GetSamplerCache().GetOrCreateSampler(samplerDesc);
+
+	CreateHiZResources(depthExtent);
+}
+
+void HiZManager::RecreateHiZResources(VkExtent2D depthExtent)
+{
+	ReleaseHiZResources();
+	CreateHiZResources(depthExtent);
+}
+
+VkExtent2D HiZManager::GetLevelExtent(uint32_t level) const
+{
+	return { std::max(1u, baseExtent.width >> level), std::max(1u, baseExtent.height >> level) };
+}
+
+void HiZManager::CreateHiZResources(VkExtent2D extent)
+{
+	depthExtent = extent;
+	baseExtent = { std::max(1u, extent.width / 2), std::max(1u, extent.height / 2) };
+
+	uint32_t levelCount = 1;
+	while ((std::max(baseExtent.width, baseExtent.height) >> levelCount) > 0)
+	{
+		++levelCount;
+	}
+
+	Image::CreateImage(context->GetVMAAllocator(), baseExtent.width, baseExtent.height, FORMAT, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, image, levelCount, VK_SAMPLE_COUNT_1_BIT, allocation);
+
+	imageView = Image::CreateImageView(context->GetDevice(), image, FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, levelCount);
+	levelViews.resize(levelCount);
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		levelViews[level] = Image::CreateImageView(context->GetDevice(), image, FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, 1, level);
+	}
+
+	// Never leaves GENERAL; the early culling pass of the first frame binds it before any build
+	Image::TransitionImageLayout(context->GetDevice(), context->GetCommandPool(), context->GetGraphicsQueue(),
+		image, FORMAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, levelCount);
+}
+
+void HiZManager::ReleaseHiZResources()
+{
+	VulkanDeletionQueue& deletionQueue = context->GetDeletionQueue();
+	for (VkImageView levelView : levelViews)
+	{
+		deletionQueue.DestroyImageView(levelView);
+	}
+	if (imageView != VK_NULL_HANDLE) {
+		deletionQueue.DestroyImageView(imageView);
+	}
+	if (image != VK_NULL_HANDLE) {
+		deletionQueue.DestroyImage(image, allocation);
+	}
+
+	levelViews.clear();
+	imageView = VK_NULL_HANDLE;
+	image = VK_NULL_HANDLE;
+	allocation = VK_NULL_HANDLE;
+}
+
+void HiZManager::CleanupHiZ()
+{
+	// The sampler belongs to the context's sampler cache
+	sampler = VK_NULL_HANDLE;
+
+	for (VkImageView levelView : levelViews)
+	{
+		vkDestroyImageView(context->GetDevice(), levelView, nullptr);
+	}
+	if (imageView != VK_NULL_HANDLE) {
+		vkDestroyImageView(context->GetDevice(), imageView, nullptr);
+	}
+	if (image != VK_NULL_HANDLE) {
+		vmaDestroyImage(context->GetVMAAllocator(), image, allocation);
+	}
+
+	levelViews.clear();
+	imageView = VK_NULL_HANDLE;
+	image = VK_NULL_HANDLE;
+	allocation = VK_NULL_HANDLE;
+}
+
+void HiZManager::RecordBeginBuild(VkCommandBuffer commandBuffer)
+{
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, GetLevelCount(), 0, 1 };
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void HiZManager::RecordLevelBarrier(VkCommandBuffer commandBuffer, uint32_t level)
+{
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
@@ -0,0 +1,71 @@
+#ifndef HIZ_MANAGER_H
+#define HIZ_MANAGER_H
+
+#include "VulkanUtils.h"
+
+class VulkanContext;
+
+// Hierarchical-Z pyramid of the single-sample depth resolve for occlusion culling. Level 0 is
+// half the depth resolution and every level halves the previous one down to 1x1; a texel stores
+// the min (r) and max (g) depth of the depth pixels below it. The resolve keeps the farthest
+// sample when the device supports VK_RESOLVE_MODE_MAX_BIT; otherwise it is sample zero, and a
+// pixel on an MSAA silhouette may report a nearer depth than its other samples, so an object
+// seen only through such edge samples can be culled for a frame. The image stays in
+// VK_IMAGE_LAYOUT_GENERAL: hiz_build.comp writes a level through its own view while the previous
+// level is sampled, and the culling pass samples all levels through GetImageView.
+class HiZManager final
+{
+public:
+	explicit HiZManager(VulkanContext* context) : context(context) {}
+	~HiZManager() = default;
+
+	HiZManager(const HiZManager&) = delete;
+	HiZManager& operator=(const HiZManager&) = delete;
+
+	void Initialize(VkExtent2D depthExtent);
+
+	//**
+	// Hands the pyramid to the deletion queue (frames in flight may still sample it) and creates
+	// one for the new depth extent. The sampler is kept.
+	//**
+	void RecreateHiZResources(VkExtent2D depthExtent);
+
+	void CleanupHiZ();
+
+	//**
+	// Orders the previous frame's reads of the pyramid before this frame's build writes it.
+	// Record before the first level is built.
+	//**
+	void RecordBeginBuild(VkCommandBuffer commandBuffer);
+
+	//**
+	// Makes a level written by the build visible to the next level's build and to the culling pass
+	//**
+	void RecordLevelBarrier(VkCommandBuffer commandBuffer, uint32_t level);
+
+	VkImageView GetImageView() const { return imageView; }
+	VkImageView GetLevelView(uint32_t level) const { return levelViews[level]; }
+	uint32_t GetLevelCount() const { return static_cast<uint32_t>(levelViews.size()); }
+	VkExtent2D GetLevelExtent(uint32_t level) const;
+	VkExtent2D GetDepthExtent() const { return depthExtent; }
+	// Nearest, clamped: the shaders only use texelFetch
+	VkSampler GetSampler() const { return sampler; }
+
+	static constexpr VkFormat FORMAT = VK_FORMAT_R32G32_SFLOAT;
+
+private:
+	void CreateHiZResources(VkExtent2D depthExtent);
+	void ReleaseHiZResources();
+
+	VulkanContext* context;
+
+	VkImage image = VK_NULL_HANDLE;
+	VmaAllocation allocation = VK_NULL_HANDLE;
+	VkImageView imageView = VK_NULL_HANDLE;
+	std::vector<VkImageView> levelViews;
+	VkExtent2D depthExtent{};
+	VkExtent2D baseExtent{};
+	VkSampler sampler = VK_NULL_HANDLE;
+};
+
+#endif
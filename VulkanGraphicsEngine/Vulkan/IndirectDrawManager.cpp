@@ -0,0 +1,199 @@
+#include "IndirectDrawManager.h"
+#include "VulkanContext.h"
+#include "Scene.h"
+
+void IndirectDrawManager::BuildScene(const std::vector<Mesh*>& meshes)
+{
+	if (objectBuffer != VK_NULL_HANDLE) {
+		throw std::runtime_error("Indirect draw scene already built. Call CleanupScene first.");
+	}
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<GpuObjectData> objects;
+
+	for (const Mesh* mesh : meshes)
+	{
+		if (mesh->indices.empty()) {
+			continue;
+		}
+
+		GpuObjectData object{};
+		object.indexCount = static_cast<uint32_t>(mesh->indices.size());
+		object.firstIndex = static_cast<uint32_t>(indices.size());
+		object.vertexOffset = static_cast<int32_t>(vertices.size());
+		object.materialIndex = mesh->materialIndex;
+		object.boundsMin = glm::vec4(mesh->boundsMin, 0.0f);
+		object.boundsMax = glm::vec4(mesh->boundsMax, 0.0f);
+
+		objects.push_back(object);
+		vertices.insert(vertices.end(), mesh->vertices.begin(), mesh->vertices.end());
+		indices.insert(indices.end(), mesh->indices.begin(), mesh->indices.end());
+	}
+
+	objectCount = static_cast<uint32_t>(objects.size());
+	if (objectCount == 0) {
+		return;
+	}
+
+	UploadBuffer(vertices.data(), vertices.size() * sizeof(Vertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer, vertexAllocation);
+	UploadBuffer(indices.data(), indices.size() * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer, indexAllocation);
+	UploadBuffer(objects.data(), objects.size() * sizeof(GpuObjectData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, objectBuffer, objectAllocation);
+
+	// Nothing was visible before the first frame: its early occlusion phase draws nothing
+	const std::vector<uint32_t> visibility(objectCount, 0u);
+	UploadBuffer(visibility.data(), visibility.size() * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, visibilityBuffer, visibilityAllocation);
+
+	// Written by the culling pass, read as indirect arguments; one set per list and frame in flight
+	for (FrameDraws& frame : frames)
+	{
+		for (DrawList& list : frame.lists)
+		{
+			VulkanUtils::CreateBuffer(context->GetVMAAllocator(), VkDeviceSize(objectCount) * sizeof(VkDrawIndexedIndirectCommand),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				list.drawCommandBuffer, VMA_MEMORY_USAGE_GPU_ONLY, list.drawCommandAllocation);
+			VulkanUtils::CreateBuffer(context->GetVMAAllocator(), sizeof(uint32_t),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				list.drawCountBuffer, VMA_MEMORY_USAGE_GPU_ONLY, list.drawCountAllocation);
+		}
+	}
+
+	std::cout << "Indirect draw scene: " << objectCount << " objects, " << vertices.size() << " vertices, "
+		<< indices.size() << " indices" << std::endl;
+}
+
+void IndirectDrawManager::UploadBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VmaAllocation& allocation)
+{
+	VmaAllocator allocator = context->GetVMAAllocator();
+
+	VkBuffer stagingBuffer;
+	VmaAllocation stagingAllocation{};
+	VulkanUtils::CreateBuffer(allocator, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, stagingBuffer, VMA_MEMORY_USAGE_CPU_ONLY, stagingAllocation);
+
+	void* mapped;
+	if (vmaMapMemory(allocator, stagingAllocation, &mapped) != VK_SUCCESS) {
+		vmaDestroyBuffer(allocator, stagingBuffer, stagingAllocation);
+		throw std::runtime_error("failed to map indirect draw staging buffer memory!");
+	}
+	memcpy(mapped, data, static_cast<size_t>(size));
+	vmaUnmapMemory(allocator, stagingAllocation);
+
+	VulkanUtils::CreateBuffer(allocator, size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, buffer, VMA_MEMORY_USAGE_GPU_ONLY, allocation);
+	VulkanUtils::CopyBuffer(context->GetDevice(), stagingBuffer, buffer, size, context->GetGraphicsQueue(), context->GetCommandPool());
+
+	vmaDestroyBuffer(allocator, stagingBuffer, stagingAllocation);
+}
+
+void IndirectDrawManager::RecordResetDrawCount(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	if (objectCount == 0) {
+		return;
+	}
+
+	// The fence of this frame slot was waited on, so last use of the counts is done
+	for (const DrawList& list : frames[frameIndex].lists)
+	{
+		vkCmdFillBuffer(commandBuffer, list.drawCountBuffer, 0, sizeof(uint32_t), 0);
+		VulkanUtils::RecordBufferBarrier(commandBuffer, list.drawCountBuffer, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+	}
+}
+
+void IndirectDrawManager::RecordCullingBarrier(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t drawList)
+{
+	if (objectCount == 0) {
+		return;
+	}
+
+	const DrawList& list = frames[frameIndex].lists[drawList];
+	VulkanUtils::RecordBufferBarrier(commandBuffer, list.drawCommandBuffer, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+	VulkanUtils::RecordBufferBarrier(commandBuffer, list.drawCountBuffer, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+}
+
+void IndirectDrawManager::RecordVisibilityBarrier(VkCommandBuffer commandBuffer)
+{
+	if (objectCount == 0) {
+		return;
+	}
+
+	VulkanUtils::RecordBufferBarrier(commandBuffer, visibilityBuffer, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+}
+
+void IndirectDrawManager::BindGeometry(VkCommandBuffer commandBuffer)
+{
+	if (objectCount == 0) {
+		return;
+	}
+
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+void IndirectDrawManager::RecordDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t drawList)
+{
+	if (objectCount == 0) {
+		return;
+	}
+
+	const DrawList& list = frames[frameIndex].lists[drawList];
+	vkCmdDrawIndexedIndirectCount(commandBuffer, list.drawCommandBuffer, 0, list.drawCountBuffer, 0,
+		objectCount, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void IndirectDrawManager::ReleaseScene()
+{
+	VulkanDeletionQueue& deletionQueue = context->GetDeletionQueue();
+
+	auto release = [&](VkBuffer& buffer, VmaAllocation& allocation) {
+		if (buffer != VK_NULL_HANDLE) {
+			deletionQueue.DestroyBuffer(buffer, allocation);
+		}
+		buffer = VK_NULL_HANDLE;
+		allocation = VK_NULL_HANDLE;
+		};
+
+	for (FrameDraws& frame : frames)
+	{
+		for (DrawList& list : frame.lists)
+		{
+			release(list.drawCommandBuffer, list.drawCommandAllocation);
+			release(list.drawCountBuffer, list.drawCountAllocation);
+		}
+	}
+	release(vertexBuffer, vertexAllocation);
+	release(indexBuffer, indexAllocation);
+	release(objectBuffer, objectAllocation);
+	release(visibilityBuffer, visibilityAllocation);
+	objectCount = 0;
+}
+
+void IndirectDrawManager::CleanupScene()
+{
+	VmaAllocator allocator = context->GetVMAAllocator();
+
+	auto destroy = [&](VkBuffer& buffer, VmaAllocation& allocation) {
+		if (buffer != VK_NULL_HANDLE) {
+			vmaDestroyBuffer(allocator, buffer, allocation);
+		}
+		buffer = VK_NULL_HANDLE;
+		allocation = VK_NULL_HANDLE;
+		};
+
+	for (FrameDraws& frame : frames)
+	{
+		for (DrawList& list : frame.lists)
+		{
+			destroy(list.drawCommandBuffer, list.drawCommandAllocation);
+			destroy(list.drawCountBuffer, list.drawCountAllocation);
+		}
+	}
+	destroy(vertexBuffer, vertexAllocation);
+	destroy(indexBuffer, indexAllocation);
+	destroy(objectBuffer, objectAllocation);
+	destroy(visibilityBuffer, visibilityAllocation);
+	objectCount = 0;
+}
@@ -0,0 +1,104 @@
+#ifndef INDIRECT_DRAW_MANAGER_H
+#define INDIRECT_DRAW_MANAGER_H
+
+#include "VulkanUtils.h"
+
+class VulkanContext;
+struct Mesh;
+
+// Scene data for GPU-driven drawing. Every mesh is copied once into one merged vertex and index
+// buffer, with a GpuObjectData record (bounds and draw arguments) per mesh. Each frame a compute
+// pass culls the records into this frame's draw command buffer and count, which a single
+// vkCmdDrawIndexedIndirectCount consumes, so the CPU cost of drawing no longer depends on the
+// number of objects. Every frame has INDIRECT_DRAW_LIST_COUNT such lists, one per occlusion
+// culling phase, and a visibility flag per object carries the late phase's result to the next frame.
+class IndirectDrawManager final
+{
+public:
+	explicit IndirectDrawManager(VulkanContext* context) : context(context) {}
+	~IndirectDrawManager() = default;
+
+	IndirectDrawManager(const IndirectDrawManager&) = delete;
+	IndirectDrawManager& operator=(const IndirectDrawManager&) = delete;
+
+	//**
+	// Uploads the merged geometry and object records of the meshes. Meshes without indices are skipped.
+	// Bounds are taken as world space: every mesh is drawn with the identity model matrix.
+	//**
+	void BuildScene(const std::vector<Mesh*>& meshes);
+
+	//**
+	// Zeroes the draw counts of all of this frame's lists and makes them visible to the culling
+	// dispatches. Record outside a rendering instance, before the first culling dispatch.
+	//**
+	void RecordResetDrawCount(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	//**
+	// Makes the culling results of one list visible to the indirect draws. Record after the
+	// dispatch that filled it.
+	//**
+	void RecordCullingBarrier(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t drawList = 0);
+
+	//**
+	// Orders earlier culling dispatches' accesses to the visibility flags before the next one
+	//**
+	void RecordVisibilityBarrier(VkCommandBuffer commandBuffer);
+
+	void BindGeometry(VkCommandBuffer commandBuffer);
+
+	//**
+	// Draws the objects culled into one of this frame's lists; the geometry must be bound
+	//**
+	void RecordDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t drawList = 0);
+
+	uint32_t GetObjectCount() const { return objectCount; }
+	VkBuffer GetObjectBuffer() const { return objectBuffer; }
+	// One uint per object, nonzero when the last late occlusion phase found it visible; starts all zero
+	VkBuffer GetVisibilityBuffer() const { return visibilityBuffer; }
+	VkBuffer GetDrawCommandBuffer(uint32_t frameIndex, uint32_t drawList = 0) const { return frames[frameIndex].lists[drawList].drawCommandBuffer; }
+	VkBuffer GetDrawCountBuffer(uint32_t frameIndex, uint32_t drawList = 0) const { return frames[frameIndex].lists[drawList].drawCountBuffer; }
+
+	//**
+	// Hands every scene buffer to the deletion queue (frames in flight may still cull and draw from
+	// them) and empties the scene, so BuildScene can run again, e.g. after a mesh was unloaded
+	//**
+	void ReleaseScene();
+
+	void CleanupScene();
+
+private:
+	struct DrawList
+	{
+		VkBuffer drawCommandBuffer = VK_NULL_HANDLE;
+		VmaAllocation drawCommandAllocation = VK_NULL_HANDLE;
+		VkBuffer drawCountBuffer = VK_NULL_HANDLE;
+		VmaAllocation drawCountAllocation = VK_NULL_HANDLE;
+	};
+
+	struct FrameDraws
+	{
+		std::array<DrawList, INDIRECT_DRAW_LIST_COUNT> lists;
+	};
+
+	//**
+	// Creates a device-local buffer with the given contents through a temporary staging buffer
+	//**
+	void UploadBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VmaAllocation& allocation);
+
+	VulkanContext* context;
+
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
+	VmaAllocation vertexAllocation = VK_NULL_HANDLE;
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	VmaAllocation indexAllocation = VK_NULL_HANDLE;
+	VkBuffer objectBuffer = VK_NULL_HANDLE;
+	VmaAllocation objectAllocation = VK_NULL_HANDLE;
+	// Shared by all frames in flight: frames run in submission order, each reads what the previous wrote
+	VkBuffer visibilityBuffer = VK_NULL_HANDLE;
+	VmaAllocation visibilityAllocation = VK_NULL_HANDLE;
+	uint32_t objectCount = 0;
+
+	std::array<FrameDraws, MAX_FRAMES_IN_FLIGHT> frames;
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include "LightManager.h"
+#include "VulkanContext.h"
+#include <algorithm>
+#include <functional>
+
+void LightManager::Initialize(uint32_t initialCapacity)
+{
+	if (lightBuffer != VK_NULL_HANDLE) {
+		throw std::runtime_error("Light manager already initialized. Call CleanupLights first.");
+	}
+	GrowLightBuffer(std::max(1u, initialCapacity));
+}
+
+LightHandle LightManager::AddLight(const PointLight& light)
+{
+	LightHandle handle;
+	if (!freeSlots.empty()) {
+		// Lowest free slot first, so the range the shaders walk stays compact
+		std::pop_heap(freeSlots.begin(), freeSlots.end(), std::greater<LightHandle>());
+		handle = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else {
+		handle = static_cast<LightHandle>(lights.size());
+		lights.emplace_back();
+		slotAlive.push_back(false);
+		slotDirty.push_back(false);
+	}
+
+	lights[handle] = light;
+	slotAlive[handle] = true;
+	slotCount = std::max(slotCount, handle + 1);
+	MarkDirty(handle);
+	return handle;
+}
+
+void LightManager::UpdateLight(LightHandle handle, const PointLight& light)
+{
+	CheckHandle(handle);
+	lights[handle] = light;
+	MarkDirty(handle);
+}
+
+void LightManager::RemoveLight(LightHandle handle)
+{
+	CheckHandle(handle);
+
+	// A zero radius and intensity is culled by every lighting path
+	lights[handle] = PointLight{};
+	slotAlive[handle] = false;
+	MarkDirty(handle);
+
+	freeSlots.push_back(handle);
+	std::push_heap(freeSlots.begin(), freeSlots.end(), std::greater<LightHandle>());
+
+	while (slotCount > 0 && !slotAlive[slotCount - 1]) {
+		--slotCount;
+	}
+}
+
+void LightManager::Clear()
+{
+	// Nothing past slotCount is read, so the old slots do not need to be uploaded
+	lights.clear();
+	slotAlive.clear();
+	slotDirty.clear();
+	dirtySlots.clear();
+	freeSlots.clear();
+	slotCount = 0;
+}
+
+const PointLight& LightManager::GetLight(LightHandle handle) const
+{
+	CheckHandle(handle);
+	return lights[handle];
+}
+
+void LightManager::CheckHandle(LightHandle handle) const
+{
+	if (handle >= lights.size() || !slotAlive[handle]) {
+		throw std::runtime_error("Invalid light handle " + std::to_string(handle) + "!");
+	}
+}
+
+void LightManager::MarkDirty(LightHandle handle)
+{
+	if (!slotDirty[handle]) {
+		slotDirty[handle] = true;
+		dirtySlots.push_back(handle);
+	}
+}
+
+void LightManager::GrowLightBuffer(uint32_t newCapacity)
+{
+	if (lightBuffer != VK_NULL_HANDLE) {
+		// Frames in flight may still read the old buffer
+		context->GetDeletionQueue().DestroyBuffer(lightBuffer, lightAllocation);
+	}
+
+	VulkanUtils::CreateBuffer(context->GetVMAAllocator(), VkDeviceSize(newCapacity) * sizeof(PointLight),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		lightBuffer, VMA_MEMORY_USAGE_GPU_ONLY, lightAllocation);
+	capacity = newCapacity;
+	bufferIsNew = true;
+
+	for (LightHandle handle = 0; handle < lights.size(); ++handle)
+	{
+		MarkDirty(handle);
+	}
+}
+
+void LightManager::EnsureStagingSize(StagingBuffer& staging, VkDeviceSize size)
+{
+	if (staging.size >= size) {
+		return;
+	}
+
+	if (staging.buffer != VK_NULL_HANDLE) {
+		vmaUnmapMemory(context->GetVMAAllocator(), staging.allocation);
+		context->GetDeletionQueue().DestroyBuffer(staging.buffer, staging.allocation);
+	}
+
+	// Rounded up so a slowly growing scene does not reallocate every frame
+	VkDeviceSize newSize = std::max<VkDeviceSize>(size, staging.size * 2);
+	VulkanUtils::CreateBuffer(context->GetVMAAllocator(), newSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		staging.buffer, VMA_MEMORY_USAGE_CPU_ONLY, staging.allocation);
+
+	if (vmaMapMemory(context->GetVMAAllocator(), staging.allocation, &staging.mappedMemory) != VK_SUCCESS) {
+		staging.mappedMemory = nullptr;
+		throw std::runtime_error("failed to map light staging buffer memory!");
+	}
+	staging.size = newSize;
+}
+
+void LightManager::RecordUpload(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	lastUploadSize = 0;
+
+	if (lights.size() > capacity) {
+		GrowLightBuffer(std::max(static_cast<uint32_t>(lights.size()), capacity * 2));
+	}
+	if (dirtySlots.empty()) {
+		return;
+	}
+
+	StagingBuffer& staging = stagingBuffers[frameIndex % MAX_FRAMES_IN_FLIGHT];
+	EnsureStagingSize(staging, VkDeviceSize(dirtySlots.size()) * sizeof(PointLight));
+
+	// Consecutive dirty slots become one copy region
+	std::sort(dirtySlots.begin(), dirtySlots.end());
+	std::vector<VkBufferCopy> regions;
+	char* stagingData = static_cast<char*>(staging.mappedMemory);
+	VkDeviceSize stagingOffset = 0;
+
+	for (size_t first = 0; first < dirtySlots.size();)
+	{
+		size_t last = first;
+		while (last + 1 < dirtySlots.size() && dirtySlots[last + 1] == dirtySlots[last] + 1) {
+			++last;
+		}
+
+		const LightHandle firstSlot = dirtySlots[first];
+		const VkDeviceSize size = VkDeviceSize(last - first + 1) * sizeof(PointLight);
+		memcpy(stagingData + stagingOffset, &lights[firstSlot], size);
+		regions.push_back({ stagingOffset, VkDeviceSize(firstSlot) * sizeof(PointLight), size });
+
+		stagingOffset += size;
+		first = last + 1;
+	}
+
+	for (LightHandle handle : dirtySlots)
+	{
+		slotDirty[handle] = false;
+	}
+	dirtySlots.clear();
+
+	// Earlier frames may still be shading with the slots about to be overwritten; light_volume.vert
+	// also reads the buffer to place its spheres
+	const VkPipelineStageFlags readerStages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	if (!bufferIsNew) {
+		VulkanUtils::RecordBufferBarrier(commandBuffer, lightBuffer, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+			readerStages, VK_PIPELINE_STAGE_TRANSFER_BIT);
+	}
+
+	vkCmdCopyBuffer(commandBuffer, staging.buffer, lightBuffer, static_cast<uint32_t>(regions.size()), regions.data());
+
+	VulkanUtils::RecordBufferBarrier(commandBuffer, lightBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, readerStages);
+
+	bufferIsNew = false;
+	lastUploadSize = stagingOffset;
+}
+
+void LightManager::CleanupLights()
+{
+	VmaAllocator allocator = context->GetVMAAllocator();
+
+	for (StagingBuffer& staging : stagingBuffers)
+	{
+		if (staging.buffer != VK_NULL_HANDLE) {
+			vmaUnmapMemory(allocator, staging.allocation);
+			vmaDestroyBuffer(allocator, staging.buffer, staging.allocation);
+		}
+		staging = StagingBuffer{};
+	}
+
+	if (lightBuffer != VK_NULL_HANDLE) {
+		vmaDestroyBuffer(allocator, lightBuffer, lightAllocation);
+		lightBuffer = VK_NULL_HANDLE;
+		lightAllocation = VK_NULL_HANDLE;
+	}
+	capacity = 0;
+
+	Clear();
+}
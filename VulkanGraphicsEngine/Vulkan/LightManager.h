@@ -0,0 +1,100 @@
+#ifndef LIGHT_MANAGER_H
+#define LIGHT_MANAGER_H
+
+#include "VulkanUtils.h"
+
+class VulkanContext;
+
+// Slot of a point light in the light buffer, stable until the light is removed
+using LightHandle = uint32_t;
+const LightHandle INVALID_LIGHT_HANDLE = UINT32_MAX;
+
+// Owns the point lights and their device-local storage buffer (std430 array of PointLight).
+// Lights live in slots that are recycled through a free list; only slots that changed since
+// the last upload are copied, through a per-frame staging buffer, so a static scene uploads
+// nothing. Removed slots stay in the buffer as lights without radius or intensity until reused.
+class LightManager final
+{
+public:
+	explicit LightManager(VulkanContext* context) : context(context) {}
+	~LightManager() = default;
+
+	LightManager(const LightManager&) = delete;
+	LightManager& operator=(const LightManager&) = delete;
+
+	//**
+	// Creates the light buffer with room for initialCapacity lights; it grows on demand
+	//**
+	void Initialize(uint32_t initialCapacity = 64);
+
+	LightHandle AddLight(const PointLight& light);
+	void UpdateLight(LightHandle handle, const PointLight& light);
+	void RemoveLight(LightHandle handle);
+
+	//**
+	// Removes every light; the slots are uploaded as empty on the next RecordUpload
+	//**
+	void Clear();
+
+	const PointLight& GetLight(LightHandle handle) const;
+
+	//**
+	// Number of slots the shaders have to walk: one past the highest live slot
+	//**
+	uint32_t GetLightCount() const { return slotCount; }
+
+	//**
+	// Copies the dirty slots into the light buffer. Record before any pass that reads the lights,
+	// outside a rendering instance, after this frame slot's fence was waited on.
+	//**
+	void RecordUpload(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	VkBuffer GetLightBuffer() const { return lightBuffer; }
+
+	//**
+	// Bytes copied by the last RecordUpload, 0 when nothing changed
+	//**
+	VkDeviceSize GetLastUploadSize() const { return lastUploadSize; }
+
+	void CleanupLights();
+
+private:
+	struct StagingBuffer
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VmaAllocation allocation = VK_NULL_HANDLE;
+		void* mappedMemory = nullptr;
+		VkDeviceSize size = 0;
+	};
+
+	void MarkDirty(LightHandle handle);
+	void CheckHandle(LightHandle handle) const;
+
+	//**
+	// Replaces the light buffer with one of at least the given capacity; every slot is re-uploaded
+	//**
+	void GrowLightBuffer(uint32_t capacity);
+	void EnsureStagingSize(StagingBuffer& staging, VkDeviceSize size);
+
+	VulkanContext* context;
+
+	// CPU copy of every slot, the source of all uploads
+	std::vector<PointLight> lights;
+	std::vector<bool> slotAlive;
+	std::vector<LightHandle> freeSlots;
+	uint32_t slotCount = 0;
+
+	std::vector<LightHandle> dirtySlots;
+	std::vector<bool> slotDirty;
+
+	VkBuffer lightBuffer = VK_NULL_HANDLE;
+	VmaAllocation lightAllocation = VK_NULL_HANDLE;
+	uint32_t capacity = 0;
+	// Set when the buffer was replaced, its first upload has no earlier reads to wait for
+	bool bufferIsNew = true;
+
+	std::array<StagingBuffer, MAX_FRAMES_IN_FLIGHT> stagingBuffers;
+	VkDeviceSize lastUploadSize = 0;
+};
+
+#endif
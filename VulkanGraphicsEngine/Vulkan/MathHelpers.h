@@ -1,5 +1,6 @@
 #ifndef MATHHELPERS_H
 #define MATHHELPERS_H
+#include <array>
 #include <string>
 #include <vector>
 
@@ -45,6 +46,27 @@ namespace MathHelpers
 		return glm::perspective(fov, aspectRatio, nearPlane, farPlane);
 	}
 
+	// Planes of the clip volume of viewProjection as (inward normal, distance), normalized so
+	// dot(plane.xyz, p) + plane.w is the signed distance of p. Order: left, right, bottom, top,
+	// near, far. The near plane is z >= 0 of Vulkan clip space.
+	inline static std::array<glm::vec4, 6> ExtractFrustumPlanes(const glm::mat4& viewProjection)
+	{
+		const glm::mat4 rows = glm::transpose(viewProjection);
+		std::array<glm::vec4, 6> planes = {
+			rows[3] + rows[0],
+			rows[3] - rows[0],
+			rows[3] + rows[1],
+			rows[3] - rows[1],
+			rows[2],
+			rows[3] - rows[2],
+		};
+		for (glm::vec4& plane : planes)
+		{
+			plane /= glm::length(glm::vec3(plane));
+		}
+		return planes;
+	}
+
 
 }
 
@@ -0,0 +1,93 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <array>
+
+namespace
+{
+	constexpr uint32_t RADIX_BITS = 8;
+	constexpr uint32_t RADIX_BUCKETS = 1u << RADIX_BITS;
+	constexpr uint32_t RADIX_DIGITS = 64 / RADIX_BITS;
+
+	constexpr uint64_t FieldMask(uint32_t bits)
+	{
+		return (uint64_t(1) << bits) - 1;
+	}
+
+	uint32_t GetDigit(uint64_t sortKey, uint32_t digit)
+	{
+		return static_cast<uint32_t>(sortKey >> (digit * RADIX_BITS)) & (RADIX_BUCKETS - 1);
+	}
+}
+
+uint64_t RenderQueue::MakeSortKey(DrawPass pass, uint32_t pipeline, uint32_t material, float viewDepth, float farPlane)
+{
+	// Written so a NaN depth lands at 0 instead of reaching the integer conversion
+	const float normalizedDepth = (viewDepth > 0.0f && farPlane > 0.0f) ? std::min(viewDepth / farPlane, 1.0f) : 0.0f;
+	// Scaled in double: in float 1.0f * 0xFFFFFF rounds up to 2^24, which would spill into the material field
+	const uint64_t depth = static_cast<uint64_t>(static_cast<double>(normalizedDepth) * static_cast<double>(FieldMask(DEPTH_BITS))) &
+		FieldMask(DEPTH_BITS);
+
+	return ((static_cast<uint64_t>(pass) & FieldMask(PASS_BITS)) << (PIPELINE_BITS + MATERIAL_BITS + DEPTH_BITS)) |
+		((static_cast<uint64_t>(pipeline) & FieldMask(PIPELINE_BITS)) << (MATERIAL_BITS + DEPTH_BITS)) |
+		((static_cast<uint64_t>(material) & FieldMask(MATERIAL_BITS)) << DEPTH_BITS) |
+		depth;
+}
+
+void RenderQueue::Reserve(size_t itemCount)
+{
+	items.reserve(itemCount);
+	scratch.reserve(itemCount);
+}
+
+void RenderQueue::Sort()
+{
+	const size_t count = items.size();
+	if (count < 2) {
+		return;
+	}
+
+	// One read of the keys builds the histograms of every digit
+	std::array<std::array<uint32_t, RADIX_BUCKETS>, RADIX_DIGITS> histograms{};
+	for (const RenderQueueItem& item : items)
+	{
+		for (uint32_t digit = 0; digit < RADIX_DIGITS; ++digit)
+		{
+			++histograms[digit][GetDigit(item.sortKey, digit)];
+		}
+	}
+
+	scratch.resize(count);
+	for (uint32_t digit = 0; digit < RADIX_DIGITS; ++digit)
+	{
+		std::array<uint32_t, RADIX_BUCKETS>& histogram = histograms[digit];
+
+		// Every key has the same value in this digit, scattering would not move anything
+		if (histogram[GetDigit(items[0].sortKey, digit)] == count) {
+			continue;
+		}
+
+		// Bucket counts become the first output slot of each bucket
+		uint32_t offset = 0;
+		for (uint32_t& bucket : histogram)
+		{
+			const uint32_t bucketCount = bucket;
+			bucket = offset;
+			offset += bucketCount;
+		}
+
+		for (const RenderQueueItem& item : items)
+		{
+			scratch[histogram[GetDigit(item.sortKey, digit)]++] = item;
+		}
+		items.swap(scratch);
+	}
+}
+
+std::pair<size_t, size_t> RenderQueue::GetPassRange(DrawPass pass) const
+{
+	const auto first = std::partition_point(items.begin(), items.end(),
+		[pass](const RenderQueueItem& item) { return GetPass(item.sortKey) < pass; });
+	const auto last = std::partition_point(first, items.end(),
+		[pass](const RenderQueueItem& item) { return GetPass(item.sortKey) == pass; });
+	return { static_cast<size_t>(first - items.begin()), static_cast<size_t>(last - items.begin()) };
+}
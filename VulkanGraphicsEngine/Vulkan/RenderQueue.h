@@ -0,0 +1,74 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Passes that draw scene meshes; the most significant field of a sort key
+enum DrawPass : uint32_t
+{
+	DRAW_PASS_DEPTH_PREPASS = 0,
+	DRAW_PASS_GBUFFER = 1,
+	DRAW_PASS_FORWARD = 2,
+};
+
+struct RenderQueueItem
+{
+	uint64_t sortKey;
+	uint32_t meshIndex;	// into the renderer's mesh list
+};
+
+// Per-frame list of mesh draws ordered by a packed 64-bit key, most significant field first:
+//   [63:60] pass      DrawPass
+//   [59:48] pipeline  pipeline variant within the pass
+//   [47:24] material  material state bound per draw, 0 while materials are bindless
+//   [23:0]  depth     view depth quantised over [0, far plane], front to back
+// Sorting groups the draws of a pass by pipeline and material, so consecutive draws share state,
+// and orders each group front to back for early-Z rejection. A field that binds nothing should
+// stay 0, or it splits the front-to-back order into groups for no saved state change. Sort is an LSD radix sort over 8-bit
+// digits that skips the digits every key shares, such as the pass and pipeline bits of most frames.
+class RenderQueue final
+{
+public:
+	static constexpr uint32_t PASS_BITS = 4;
+	static constexpr uint32_t PIPELINE_BITS = 12;
+	static constexpr uint32_t MATERIAL_BITS = 24;
+	static constexpr uint32_t DEPTH_BITS = 24;
+	static_assert(PASS_BITS + PIPELINE_BITS + MATERIAL_BITS + DEPTH_BITS == 64, "Sort key fields must fill 64 bits");
+
+	RenderQueue() = default;
+	~RenderQueue() = default;
+
+	//**
+	// Packs a sort key. Pipeline and material are masked to their field widths; viewDepth is
+	// clamped to [0, farPlane], so everything behind the camera sorts first.
+	//**
+	static uint64_t MakeSortKey(DrawPass pass, uint32_t pipeline, uint32_t material, float viewDepth, float farPlane);
+
+	static DrawPass GetPass(uint64_t sortKey) { return static_cast<DrawPass>(sortKey >> (64 - PASS_BITS)); }
+
+	void Clear() { items.clear(); }
+	void Reserve(size_t itemCount);
+	void Push(uint64_t sortKey, uint32_t meshIndex) { items.push_back({ sortKey, meshIndex }); }
+
+	//**
+	// Sorts the items by key, ascending. Stable: items with equal keys keep their push order.
+	//**
+	void Sort();
+
+	//**
+	// Returns [first, last) of the items of one pass; only valid after Sort
+	//**
+	std::pair<size_t, size_t> GetPassRange(DrawPass pass) const;
+
+	const std::vector<RenderQueueItem>& GetItems() const { return items; }
+
+private:
+	std::vector<RenderQueueItem> items;
+	// Other half of the radix sort's ping-pong, kept so sorting does not allocate every frame
+	std::vector<RenderQueueItem> scratch;
+};
+
+#endif
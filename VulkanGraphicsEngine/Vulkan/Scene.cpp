@@ -94,6 +94,7 @@ void ModelLoader::LoadModel(const std::string& path, std::vector<Mesh*>& meshes,
                 newMesh->indices.push_back(face.mIndices[k]);
             }
         }
+        newMesh->ComputeBounds();
 
         // --- Load PBR Materials ---
         aiMaterial* material = scene->mMaterials[assimpMesh->mMaterialIndex];
@@ -184,6 +185,21 @@ void Mesh::CreateBuffers()
     indexBuffer->CreateIndexBuffer(indices);
 }
 
+void Mesh::ComputeBounds()
+{
+    if (vertices.empty()) {
+        boundsMin = boundsMax = glm::vec3(0.0f);
+        return;
+    }
+
+    boundsMin = boundsMax = vertices[0].pos;
+    for (const Vertex& vertex : vertices)
+    {
+        boundsMin = glm::min(boundsMin, vertex.pos);
+        boundsMax = glm::max(boundsMax, vertex.pos);
+    }
+}
+
 void Mesh::SetTexture(TextureType type, std::unique_ptr<VulkanTexture> texture) {
     if (type >= TextureType::ALBEDO && type <= TextureType::AO) {
         textures[type] = std::move(texture);
@@ -207,6 +223,20 @@ void Mesh::CleanUpMesh()
     textures.clear(); 
 }
 
+void Mesh::ReleaseMesh()
+{
+    indexBuffer->ReleaseIndexBuffer();
+    vertexBuffer->ReleaseVertexBuffer();
+
+    for (auto& [type, texturePtr] : textures)
+    {
+        if (texturePtr) {
+            texturePtr->ReleaseTexture();
+        }
+    }
+    textures.clear();
+}
+
 const VulkanTexture& Mesh::GetTexture(TextureType type) const {
     auto it = textures.find(type);
     if (it != textures.end()) {
@@ -218,6 +248,18 @@ const VulkanTexture& Mesh::GetTexture(TextureType type) const {
     }
 }
 
+MaterialTextures Mesh::GetMaterialTextures() const {
+    MaterialTextures materialTextures{};
+    for (const auto& [type, texturePtr] : textures)
+    {
+        const size_t slot = static_cast<size_t>(type);
+        if (texturePtr && slot < MATERIAL_TEXTURE_COUNT) {
+            materialTextures[slot] = texturePtr.get();
+        }
+    }
+    return materialTextures;
+}
+
 Mesh::~Mesh()
 {
 	delete vertexBuffer;
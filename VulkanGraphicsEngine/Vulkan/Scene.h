@@ -4,10 +4,12 @@
 #include <vector>
 
 #include "VulkanTexture.h"
+#include "VulkanBindlessTextures.h"
 #include "glm/vec2.hpp"
 #include "glm/vec3.hpp"
 #include "VulkanUtils.h"
 #include "VulkanContext.h"
+#include "MathHelpers.h"
 #include <map>
 class VulkanVertexBuffer;
 class VulkanIndexBuffer;
@@ -107,7 +109,8 @@ struct Mesh
     Mesh(Mesh&& other) noexcept
         : vertices(std::move(other.vertices)), indices(std::move(other.indices)),
         textures(std::move(other.textures)), context(other.context),
-        vertexBuffer(other.vertexBuffer), indexBuffer(other.indexBuffer)
+        vertexBuffer(other.vertexBuffer), indexBuffer(other.indexBuffer),
+        materialIndex(other.materialIndex), boundsMin(other.boundsMin), boundsMax(other.boundsMax)
     {
         other.vertexBuffer = nullptr;
         other.indexBuffer = nullptr;
@@ -122,6 +125,9 @@ struct Mesh
             context = other.context;
             vertexBuffer = other.vertexBuffer;
             indexBuffer = other.indexBuffer;
+            materialIndex = other.materialIndex;
+            boundsMin = other.boundsMin;
+            boundsMax = other.boundsMax;
             other.vertices.clear();
             other.indices.clear();
             other.vertexBuffer = nullptr;
@@ -137,13 +143,23 @@ struct Mesh
 	VulkanContext* context;
 	VulkanVertexBuffer* vertexBuffer;			// mesh buffers
 	VulkanIndexBuffer* indexBuffer;				// mesh buffers
+    uint32_t materialIndex = 0;                 // slot in the bindless material buffer, passed as firstInstance
+    glm::vec3 boundsMin{ 0.0f };                // world-space AABB, see ComputeBounds
+    glm::vec3 boundsMax{ 0.0f };
 
 	void CreateBuffers();
+    // Fits boundsMin/boundsMax around the vertices. Meshes are drawn with the identity model
+    // matrix, so the box is in world space. Call again whenever the vertices change.
+    void ComputeBounds();
     void SetTexture(TextureType type, std::unique_ptr<VulkanTexture> texture);
     const VulkanTexture& GetTexture(TextureType type) const;
     const VulkanTexture& GetDefaultTexture(TextureType type) const;
+    // Textures per TextureType for the bindless material, nullptr where the mesh has none
+    MaterialTextures GetMaterialTextures() const;
 	void Bind(VkCommandBuffer commandBuffer,VkDeviceSize offsets);
 	void CleanUpMesh();
+	// Deferred variant of CleanUpMesh: buffers and textures go through the deletion queue
+	void ReleaseMesh();
 };
 class ModelLoader {
 public:
@@ -291,9 +307,10 @@ namespace Scene
             calculateProjectionMatrix(); 
         }
 
-        static bool IsOutsideFrustum(const glm::vec3& point, const glm::vec3& frustumCenter, float frustumRadius)
+        // Culling planes of the current view and projection, see MathHelpers::ExtractFrustumPlanes
+        std::array<glm::vec4, 6> GetFrustumPlanes() const
         {
-            return glm::distance(point, frustumCenter) > frustumRadius;
+            return MathHelpers::ExtractFrustumPlanes(projectionMatrix * viewMatrix);
         }
 
     private:
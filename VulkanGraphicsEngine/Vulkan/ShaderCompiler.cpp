@@ -0,0 +1,276 @@
+#include "ShaderCompiler.h"
+#include "EmbeddedShaders.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifdef VGE_RUNTIME_SHADER_COMPILER
+#include <shaderc/shaderc.hpp>
+#endif
+
+#ifndef SHADER_SOURCE_DIR
+#define SHADER_SOURCE_DIR "Shaders"
+#endif
+
+namespace
+{
+	// Bump when compile options change so stale cache entries are not reused
+	constexpr uint32_t SHADER_CACHE_VERSION = 1;
+	const char* SHADER_CACHE_DIR = "shader_cache";
+	constexpr auto WATCH_INTERVAL = std::chrono::milliseconds(250);
+
+	uint64_t HashSource(const std::string& source)
+	{
+		uint64_t hash = 14695981039346656037ull ^ SHADER_CACHE_VERSION;
+		for (unsigned char c : source)
+		{
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool ReadSource(const std::filesystem::path& path, std::string& source)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			return false;
+		}
+		std::ostringstream contents;
+		contents << file.rdbuf();
+		source = contents.str();
+		return true;
+	}
+
+	// Copies the embedded words of a shader, or reads the build-time .spv when it is not embedded
+	std::vector<char> LoadBuiltinSpirv(const std::string& spirvPath)
+	{
+		if (const EmbeddedShader* embedded = EmbeddedShaders::Find(spirvPath)) {
+			const char* bytes = reinterpret_cast<const char*>(embedded->code);
+			return std::vector<char>(bytes, bytes + embedded->GetSizeInBytes());
+		}
+		return VulkanUtils::ReadFile(spirvPath);
+	}
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+	CleanupShaderCompiler();
+}
+
+void ShaderCompiler::Initialize()
+{
+	if constexpr (!IsHotReloadEnabled()) {
+		return;
+	}
+
+	std::error_code ec;
+	std::filesystem::create_directories(SHADER_CACHE_DIR, ec);
+
+	stopRequested = false;
+	watcher = std::thread(&ShaderCompiler::WatchLoop, this);
+	std::cout << "Shader hot reload enabled, watching " << SHADER_SOURCE_DIR << std::endl;
+}
+
+std::filesystem::path ShaderCompiler::GetSourcePath(const std::string& spirvPath)
+{
+	std::filesystem::path fileName = std::filesystem::path(spirvPath).filename();
+	if (fileName.extension() == ".spv") {
+		fileName.replace_extension();
+	}
+	return std::filesystem::path(SHADER_SOURCE_DIR) / fileName;
+}
+
+std::vector<char> ShaderCompiler::LoadSpirv(const std::string& spirvPath)
+{
+	if constexpr (!IsHotReloadEnabled()) {
+		return LoadBuiltinSpirv(spirvPath);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = watchedShaders.find(spirvPath);
+		if (it != watchedShaders.end()) {
+			return it->second.spirv;
+		}
+	}
+
+	WatchedShader watched{};
+	watched.sourcePath = GetSourcePath(spirvPath);
+
+	std::string source;
+	std::error_code ec;
+	watched.lastWriteTime = std::filesystem::last_write_time(watched.sourcePath, ec);
+	if (ec || !ReadSource(watched.sourcePath, source)) {
+		// No source to watch, use what glslc produced at build time
+		return LoadBuiltinSpirv(spirvPath);
+	}
+
+	watched.sourceHash = HashSource(source);
+	try {
+		watched.spirv = CompileCached(watched.sourcePath, source, watched.sourceHash);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << "\nFalling back to " << spirvPath << std::endl;
+		watched.spirv = LoadBuiltinSpirv(spirvPath);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	// Another worker may have loaded the same shader meanwhile, either copy is fine
+	auto [it, inserted] = watchedShaders.try_emplace(spirvPath, std::move(watched));
+	return it->second.spirv;
+}
+
+std::vector<char> ShaderCompiler::CompileCached(const std::filesystem::path& sourcePath, const std::string& source, uint64_t sourceHash)
+{
+	std::ostringstream cacheName;
+	cacheName << sourcePath.filename().string() << "." << std::hex << std::setw(16) << std::setfill('0') << sourceHash << ".spv";
+	const std::filesystem::path cachePath = std::filesystem::path(SHADER_CACHE_DIR) / cacheName.str();
+
+	std::error_code ec;
+	if (std::filesystem::exists(cachePath, ec)) {
+		return VulkanUtils::ReadFile(cachePath.string());
+	}
+
+#ifdef VGE_RUNTIME_SHADER_COMPILER
+	const std::string extension = sourcePath.extension().string();
+	shaderc_shader_kind kind;
+	if (extension == ".vert") {
+		kind = shaderc_vertex_shader;
+	}
+	else if (extension == ".frag") {
+		kind = shaderc_fragment_shader;
+	}
+	else if (extension == ".comp") {
+		kind = shaderc_compute_shader;
+	}
+	else {
+		throw std::runtime_error("Unknown shader stage for " + sourcePath.string());
+	}
+
+	// Same settings as the glslc build step, so runtime and build-time SPIR-V reflect identically
+	shaderc::Compiler compiler;
+	shaderc::CompileOptions options;
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
+
+	const auto start = std::chrono::steady_clock::now();
+	shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source, kind, sourcePath.string().c_str(), options);
+	if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+		throw std::runtime_error("Failed to compile " + sourcePath.string() + ":\n" + result.GetErrorMessage());
+	}
+
+	const size_t byteCount = (result.cend() - result.cbegin()) * sizeof(uint32_t);
+	std::vector<char> spirv(byteCount);
+	std::memcpy(spirv.data(), result.cbegin(), byteCount);
+
+	const double compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Compiled " << sourcePath.filename().string() << " in " << compileMs << " ms" << std::endl;
+
+	// Write to a temporary name first, a concurrent reader must never see a partial file
+	const std::filesystem::path tempPath = cachePath.string() + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		file.write(spirv.data(), static_cast<std::streamsize>(spirv.size()));
+	}
+	std::filesystem::rename(tempPath, cachePath, ec);
+	if (ec) {
+		std::filesystem::remove(tempPath, ec);
+	}
+
+	return spirv;
+#else
+	throw std::runtime_error("Runtime shader compilation is disabled, cannot compile " + sourcePath.string());
+#endif
+}
+
+std::vector<std::string> ShaderCompiler::TakeChangedShaders()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<std::string> changed;
+	changed.swap(changedShaders);
+	return changed;
+}
+
+void ShaderCompiler::WatchLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!stopCondition.wait_for(lock, WATCH_INTERVAL, [this] { return stopRequested; }))
+	{
+		// Snapshot the sources so compiles run without holding the lock
+		std::vector<std::pair<std::string, WatchedShader>> candidates;
+		for (const auto& [spirvPath, watched] : watchedShaders)
+		{
+			std::error_code ec;
+			auto writeTime = std::filesystem::last_write_time(watched.sourcePath, ec);
+			if (!ec && writeTime != watched.lastWriteTime) {
+				WatchedShader candidate{};
+				candidate.sourcePath = watched.sourcePath;
+				candidate.lastWriteTime = writeTime;
+				candidate.sourceHash = watched.sourceHash;
+				candidates.emplace_back(spirvPath, std::move(candidate));
+			}
+		}
+
+		if (candidates.empty()) {
+			continue;
+		}
+
+		lock.unlock();
+		std::vector<std::pair<std::string, WatchedShader>> recompiled;
+		std::vector<std::pair<std::string, std::filesystem::file_time_type>> touched;
+		for (auto& [spirvPath, candidate] : candidates)
+		{
+			std::string source;
+			if (!ReadSource(candidate.sourcePath, source)) {
+				continue;
+			}
+
+			const uint64_t sourceHash = HashSource(source);
+			if (sourceHash == candidate.sourceHash) {
+				// Saved without edits
+				touched.emplace_back(spirvPath, candidate.lastWriteTime);
+				continue;
+			}
+
+			try {
+				candidate.spirv = CompileCached(candidate.sourcePath, source, sourceHash);
+				candidate.sourceHash = sourceHash;
+				recompiled.emplace_back(spirvPath, std::move(candidate));
+			}
+			catch (const std::exception& e) {
+				// Keep the running pipeline; the next save triggers another attempt
+				std::cerr << e.what() << std::endl;
+				touched.emplace_back(spirvPath, candidate.lastWriteTime);
+			}
+		}
+		lock.lock();
+
+		for (const auto& [spirvPath, writeTime] : touched)
+		{
+			watchedShaders[spirvPath].lastWriteTime = writeTime;
+		}
+		for (auto& [spirvPath, candidate] : recompiled)
+		{
+			watchedShaders[spirvPath] = std::move(candidate);
+			if (std::find(changedShaders.begin(), changedShaders.end(), spirvPath) == changedShaders.end()) {
+				changedShaders.push_back(spirvPath);
+			}
+		}
+	}
+}
+
+void ShaderCompiler::CleanupShaderCompiler()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopRequested = true;
+	}
+	stopCondition.notify_all();
+
+	if (watcher.joinable()) {
+		watcher.join();
+	}
+}
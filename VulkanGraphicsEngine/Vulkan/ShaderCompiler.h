@@ -0,0 +1,96 @@
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include "VulkanUtils.h"
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Hands out SPIR-V for the ".spv" paths pipelines are described with.
+// When the engine is built with VGE_RUNTIME_SHADER_COMPILER the GLSL source next to each
+// .spv (in SHADER_SOURCE_DIR) is compiled in-process with shaderc instead. The results are
+// cached on disk by source hash, so unchanged shaders never recompile between runs. A watcher
+// thread polls the sources that were loaded and recompiles them when they change; the renderer
+// picks those up between frames through VulkanPipeline::ReloadChangedShaders.
+// Without the define the SPIR-V embedded into the binary is used (see EmbeddedShaders.h), and the
+// .spv files produced by glslc are only read for shaders that are not embedded.
+class ShaderCompiler final
+{
+public:
+	ShaderCompiler() = default;
+	~ShaderCompiler();
+
+	ShaderCompiler(const ShaderCompiler&) = delete;
+	ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+	//**
+	// Starts the source watcher when runtime compilation is enabled
+	//**
+	void Initialize();
+
+	//**
+	// Returns the SPIR-V for a build-time .spv path, e.g. "Shaders/lighting.frag.spv".
+	// Safe to call from the pipeline build worker threads.
+	//**
+	std::vector<char> LoadSpirv(const std::string& spirvPath);
+
+	//**
+	// Returns the .spv paths whose source recompiled successfully since the last call
+	//**
+	std::vector<std::string> TakeChangedShaders();
+
+	//**
+	// Returns true when shaders are compiled at runtime and watched for changes
+	//**
+	static constexpr bool IsHotReloadEnabled()
+	{
+#ifdef VGE_RUNTIME_SHADER_COMPILER
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	//**
+	// Stops the watcher thread
+	//**
+	void CleanupShaderCompiler();
+
+private:
+	struct WatchedShader
+	{
+		std::filesystem::path sourcePath;
+		std::filesystem::file_time_type lastWriteTime;
+		uint64_t sourceHash = 0;
+		std::vector<char> spirv; // last successful compile
+	};
+
+	//**
+	// Maps "Shaders/x.frag.spv" to "<SHADER_SOURCE_DIR>/x.frag"
+	//**
+	static std::filesystem::path GetSourcePath(const std::string& spirvPath);
+
+	//**
+	// Compiles GLSL source, or returns the cached SPIR-V for this source hash. Throws on compile errors.
+	//**
+	std::vector<char> CompileCached(const std::filesystem::path& sourcePath, const std::string& source, uint64_t sourceHash);
+
+	//**
+	// Polls the watched sources until CleanupShaderCompiler is called
+	//**
+	void WatchLoop();
+
+	std::mutex mutex;
+	std::unordered_map<std::string, WatchedShader> watchedShaders; // keyed by .spv path
+	std::vector<std::string> changedShaders;
+
+	std::thread watcher;
+	std::condition_variable stopCondition;
+	bool stopRequested = false;
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include "ShaderReflection.h"
+#include <spirv_reflect.h>
+#include <algorithm>
+#include <string>
+
+// SPIRV-Reflect enums mirror the Vulkan values, so plain casts are enough below
+void ShaderReflection::AddStage(const std::vector<char>& spirvCode)
+{
+	SpvReflectShaderModule module{};
+	if (spvReflectCreateShaderModule(spirvCode.size(), spirvCode.data(), &module) != SPV_REFLECT_RESULT_SUCCESS) {
+		throw std::runtime_error("failed to reflect SPIR-V module!");
+	}
+
+	// Make sure the module is released even if a conflict below throws
+	struct ModuleGuard
+	{
+		SpvReflectShaderModule* module;
+		~ModuleGuard() { spvReflectDestroyShaderModule(module); }
+	} guard{ &module };
+
+	const VkShaderStageFlagBits stage = static_cast<VkShaderStageFlagBits>(module.shader_stage);
+	stages |= stage;
+
+	// --- Descriptor sets ---
+	uint32_t setCount = 0;
+	spvReflectEnumerateDescriptorSets(&module, &setCount, nullptr);
+	std::vector<SpvReflectDescriptorSet*> sets(setCount);
+	spvReflectEnumerateDescriptorSets(&module, &setCount, sets.data());
+
+	for (const SpvReflectDescriptorSet* set : sets)
+	{
+		std::vector<VkDescriptorSetLayoutBinding>& bindings = descriptorSets[set->set];
+
+		for (uint32_t i = 0; i < set->binding_count; ++i)
+		{
+			const SpvReflectDescriptorBinding* reflected = set->bindings[i];
+
+			VkDescriptorSetLayoutBinding binding{};
+			binding.binding = reflected->binding;
+			binding.descriptorType = static_cast<VkDescriptorType>(reflected->descriptor_type);
+			binding.descriptorCount = 1;
+			for (uint32_t dim = 0; dim < reflected->array.dims_count; ++dim)
+			{
+				binding.descriptorCount *= reflected->array.dims[dim];
+			}
+			binding.stageFlags = stage;
+			binding.pImmutableSamplers = nullptr;
+
+			// Runtime arrays have no size in SPIR-V, the layout reserves the bindless maximum
+			const bool runtimeArray = binding.descriptorCount == 0 ||
+				(reflected->type_description != nullptr && reflected->type_description->op == SpvOpTypeRuntimeArray);
+			if (runtimeArray) {
+				binding.descriptorCount = MAX_BINDLESS_TEXTURES;
+				runtimeArrays.emplace(set->set, binding.binding);
+			}
+
+			auto existing = std::find_if(bindings.begin(), bindings.end(),
+				[&](const VkDescriptorSetLayoutBinding& b) { return b.binding == binding.binding; });
+
+			if (existing == bindings.end()) {
+				bindings.push_back(binding);
+				continue;
+			}
+
+			if (existing->descriptorType != binding.descriptorType || existing->descriptorCount != binding.descriptorCount) {
+				throw std::runtime_error("Shader stages disagree on set " + std::to_string(set->set) +
+					" binding " + std::to_string(binding.binding) + "!");
+			}
+			existing->stageFlags |= stage;
+		}
+
+		std::sort(bindings.begin(), bindings.end(),
+			[](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+	}
+
+	// --- Push constants ---
+	uint32_t blockCount = 0;
+	spvReflectEnumeratePushConstantBlocks(&module, &blockCount, nullptr);
+	std::vector<SpvReflectBlockVariable*> blocks(blockCount);
+	spvReflectEnumeratePushConstantBlocks(&module, &blockCount, blocks.data());
+
+	for (const SpvReflectBlockVariable* block : blocks)
+	{
+		pushConstantStages |= stage;
+		pushConstantBegin = std::min(pushConstantBegin, block->offset);
+		pushConstantEnd = std::max(pushConstantEnd, block->offset + block->size);
+	}
+
+	// --- Vertex inputs ---
+	if (stage == VK_SHADER_STAGE_VERTEX_BIT)
+	{
+		uint32_t inputCount = 0;
+		spvReflectEnumerateInputVariables(&module, &inputCount, nullptr);
+		std::vector<SpvReflectInterfaceVariable*> inputs(inputCount);
+		spvReflectEnumerateInputVariables(&module, &inputCount, inputs.data());
+
+		vertexInputs.clear();
+		for (const SpvReflectInterfaceVariable* input : inputs)
+		{
+			if (input->decoration_flags & SPV_REFLECT_DECORATION_BUILT_IN) {
+				continue;
+			}
+			vertexInputs.push_back({ input->location, static_cast<VkFormat>(input->format) });
+		}
+
+		std::sort(vertexInputs.begin(), vertexInputs.end(),
+			[](const ShaderVertexInput& a, const ShaderVertexInput& b) { return a.location < b.location; });
+	}
+}
+
+std::vector<VkDescriptorBindingFlags> ShaderReflection::GetBindingFlags(uint32_t set) const
+{
+	auto it = descriptorSets.find(set);
+	if (it == descriptorSets.end() || GetSetLayoutFlags(set) == 0) {
+		return {};
+	}
+
+	std::vector<VkDescriptorBindingFlags> flags;
+	flags.reserve(it->second.size());
+	for (const VkDescriptorSetLayoutBinding& binding : it->second)
+	{
+		flags.push_back(runtimeArrays.count({ set, binding.binding }) ?
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT : 0);
+	}
+	return flags;
+}
+
+VkDescriptorSetLayoutCreateFlags ShaderReflection::GetSetLayoutFlags(uint32_t set) const
+{
+	auto it = runtimeArrays.lower_bound({ set, 0 });
+	const bool hasRuntimeArray = it != runtimeArrays.end() && it->first == set;
+	return hasRuntimeArray ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT : 0;
+}
+
+std::vector<VkPushConstantRange> ShaderReflection::GetPushConstantRanges() const
+{
+	if (pushConstantStages == 0 || pushConstantEnd <= pushConstantBegin) {
+		return {};
+	}
+
+	VkPushConstantRange range{};
+	range.stageFlags = pushConstantStages;
+	range.offset = pushConstantBegin;
+	range.size = pushConstantEnd - pushConstantBegin;
+	return { range };
+}
@@ -0,0 +1,77 @@
+#ifndef SHADER_REFLECTION_H
+#define SHADER_REFLECTION_H
+
+#include "VulkanUtils.h"
+#include <map>
+#include <set>
+
+struct ShaderVertexInput
+{
+	uint32_t location;
+	VkFormat format;
+};
+
+// Collects descriptor bindings, push-constant blocks and vertex inputs from SPIR-V.
+// Stages are added one after another; bindings used by several stages get their stage
+// flags combined and conflicting declarations (same set/binding, different type or count) throw.
+// Runtime-sized arrays (`uniform sampler2D textures[]`) become bindless bindings of
+// MAX_BINDLESS_TEXTURES descriptors that are partially bound and updatable after bind.
+class ShaderReflection final
+{
+public:
+	ShaderReflection() = default;
+	~ShaderReflection() = default;
+
+	//**
+	// Reflects one shader stage and merges it into what was collected so far
+	//**
+	void AddStage(const std::vector<char>& spirvCode);
+
+	//**
+	// Returns the bindings per set index, sorted by binding number
+	//**
+	const std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>>& GetDescriptorSets() const { return descriptorSets; }
+
+	//**
+	// Returns the descriptor binding flags of a set, parallel to its bindings.
+	// Empty when the set has no runtime-sized arrays.
+	//**
+	std::vector<VkDescriptorBindingFlags> GetBindingFlags(uint32_t set) const;
+
+	//**
+	// Returns the layout create flags a set needs (update-after-bind pool for bindless sets)
+	//**
+	VkDescriptorSetLayoutCreateFlags GetSetLayoutFlags(uint32_t set) const;
+
+	//**
+	// Returns the number of set layouts the pipeline layout needs (highest set index + 1)
+	//**
+	uint32_t GetSetLayoutCount() const { return descriptorSets.empty() ? 0 : descriptorSets.rbegin()->first + 1; }
+
+	//**
+	// Returns a single range spanning all push-constant blocks, with the stages that declare one
+	//**
+	std::vector<VkPushConstantRange> GetPushConstantRanges() const;
+
+	//**
+	// Returns the user-defined inputs of the vertex stage, built-ins are skipped
+	//**
+	const std::vector<ShaderVertexInput>& GetVertexInputs() const { return vertexInputs; }
+
+	//**
+	// Returns the combined stages of everything added so far
+	//**
+	VkShaderStageFlags GetStages() const { return stages; }
+
+private:
+	std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> descriptorSets;
+	std::vector<ShaderVertexInput> vertexInputs;
+	std::set<std::pair<uint32_t, uint32_t>> runtimeArrays; // (set, binding)
+
+	VkShaderStageFlags stages = 0;
+	VkShaderStageFlags pushConstantStages = 0;
+	uint32_t pushConstantBegin = UINT32_MAX;
+	uint32_t pushConstantEnd = 0;
+};
+
+#endif
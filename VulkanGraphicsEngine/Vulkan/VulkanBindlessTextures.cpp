@@ -0,0 +1,207 @@
+#include "VulkanBindlessTextures.h"
+#include "VulkanContext.h"
+#include "VulkanTexture.h"
+
+namespace
+{
+	constexpr uint32_t TEXTURE_BINDING = 0;
+	constexpr uint32_t MATERIAL_BINDING = 1;
+}
+
+void VulkanBindlessTextures::Initialize(VkDescriptorSetLayout layout)
+{
+	if (descriptorPool != VK_NULL_HANDLE) {
+		throw std::runtime_error("Bindless textures already initialized. Call CleanupBindlessTextures first.");
+	}
+	if (layout == VK_NULL_HANDLE) {
+		throw std::runtime_error("Cannot initialize bindless textures with a null layout!");
+	}
+
+	std::vector<VkDescriptorPoolSize> poolSizes = {
+		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_BINDLESS_TEXTURES},
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1},
+	};
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = 1;
+
+	if (vkCreateDescriptorPool(context->GetDevice(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create bindless descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	if (vkAllocateDescriptorSets(context->GetDevice(), &allocInfo, &descriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate bindless descriptor set!");
+	}
+
+	// One buffer for all frames: a material is only written while no frame can reference its slot
+	const VkDeviceSize bufferSize = sizeof(MaterialData) * MAX_MATERIALS;
+	VulkanUtils::CreateBuffer(context->GetVMAAllocator(), bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		materialBuffer, VMA_MEMORY_USAGE_CPU_TO_GPU, materialAllocation);
+
+	void* mapped = nullptr;
+	if (vmaMapMemory(context->GetVMAAllocator(), materialAllocation, &mapped) != VK_SUCCESS) {
+		throw std::runtime_error("failed to map material buffer memory!");
+	}
+	mappedMaterials = static_cast<MaterialData*>(mapped);
+	materials.resize(MAX_MATERIALS);
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = materialBuffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = bufferSize;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = descriptorSet;
+	write.dstBinding = MATERIAL_BINDING;
+	write.dstArrayElement = 0;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.descriptorCount = 1;
+	write.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(context->GetDevice(), 1, &write, 0, nullptr);
+}
+
+uint32_t VulkanBindlessTextures::AcquireTexture(const VulkanTexture& texture)
+{
+	auto it = textureSlots.find(&texture);
+	if (it != textureSlots.end()) {
+		++it->second.materialCount;
+		return it->second.index;
+	}
+
+	uint32_t index;
+	if (!freeTextureSlots.empty()) {
+		index = freeTextureSlots.back();
+		freeTextureSlots.pop_back();
+	}
+	else if (nextTextureSlot < MAX_BINDLESS_TEXTURES) {
+		index = nextTextureSlot++;
+	}
+	else {
+		throw std::runtime_error("Bindless texture array is full, raise MAX_BINDLESS_TEXTURES!");
+	}
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.sampler = texture.GetTextureSampler();
+	imageInfo.imageView = texture.GetTextureImageView();
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	// Update-after-bind: the slot is unused, so this is legal while the set is bound in frames in flight
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = descriptorSet;
+	write.dstBinding = TEXTURE_BINDING;
+	write.dstArrayElement = index;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.descriptorCount = 1;
+	write.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(context->GetDevice(), 1, &write, 0, nullptr);
+
+	textureSlots.emplace(&texture, TextureSlot{ index, 1 });
+	return index;
+}
+
+void VulkanBindlessTextures::ReleaseTexture(const VulkanTexture* texture)
+{
+	auto it = textureSlots.find(texture);
+	if (it == textureSlots.end() || --it->second.materialCount > 0) {
+		return;
+	}
+
+	// Frames in flight may still sample the old descriptor, hand the slot back once they retired
+	const uint32_t index = it->second.index;
+	textureSlots.erase(it);
+	context->GetDeletionQueue().Push([this, index]() { freeTextureSlots.push_back(index); });
+}
+
+uint32_t VulkanBindlessTextures::AddMaterial(const MaterialTextures& textures)
+{
+	if (mappedMaterials == nullptr) {
+		throw std::runtime_error("Bindless textures have not been initialized!");
+	}
+
+	uint32_t materialIndex;
+	if (!freeMaterialSlots.empty()) {
+		materialIndex = freeMaterialSlots.back();
+		freeMaterialSlots.pop_back();
+	}
+	else if (nextMaterialSlot < MAX_MATERIALS) {
+		materialIndex = nextMaterialSlot++;
+	}
+	else {
+		throw std::runtime_error("Material buffer is full, raise MAX_MATERIALS!");
+	}
+
+	std::array<uint32_t, MATERIAL_TEXTURE_COUNT> indices;
+	for (size_t i = 0; i < MATERIAL_TEXTURE_COUNT; ++i)
+	{
+		indices[i] = textures[i] != nullptr ? AcquireTexture(*textures[i]) : NO_TEXTURE;
+	}
+
+	MaterialData material{};
+	material.albedo = indices[static_cast<size_t>(TextureType::ALBEDO)];
+	material.normal = indices[static_cast<size_t>(TextureType::NORMAL)];
+	material.metallic = indices[static_cast<size_t>(TextureType::METALLIC)];
+	material.roughness = indices[static_cast<size_t>(TextureType::ROUGHNESS)];
+	material.ao = indices[static_cast<size_t>(TextureType::AO)];
+
+	mappedMaterials[materialIndex] = material;
+	materials[materialIndex] = textures;
+	return materialIndex;
+}
+
+void VulkanBindlessTextures::RemoveMaterial(uint32_t materialIndex)
+{
+	if (materialIndex >= nextMaterialSlot) {
+		return;
+	}
+
+	for (const VulkanTexture* texture : materials[materialIndex])
+	{
+		if (texture != nullptr) {
+			ReleaseTexture(texture);
+		}
+	}
+	materials[materialIndex] = {};
+
+	context->GetDeletionQueue().Push([this, materialIndex]() { freeMaterialSlots.push_back(materialIndex); });
+}
+
+void VulkanBindlessTextures::CleanupBindlessTextures()
+{
+	if (mappedMaterials != nullptr) {
+		vmaUnmapMemory(context->GetVMAAllocator(), materialAllocation);
+		mappedMaterials = nullptr;
+	}
+	if (materialBuffer != VK_NULL_HANDLE) {
+		vmaDestroyBuffer(context->GetVMAAllocator(), materialBuffer, materialAllocation);
+		materialBuffer = VK_NULL_HANDLE;
+		materialAllocation = VK_NULL_HANDLE;
+	}
+
+	// Destroying the pool frees the set
+	if (descriptorPool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(context->GetDevice(), descriptorPool, nullptr);
+		descriptorPool = VK_NULL_HANDLE;
+		descriptorSet = VK_NULL_HANDLE;
+	}
+
+	textureSlots.clear();
+	freeTextureSlots.clear();
+	nextTextureSlot = 0;
+	materials.clear();
+	freeMaterialSlots.clear();
+	nextMaterialSlot = 0;
+}
@@ -0,0 +1,83 @@
+#ifndef VULKAN_BINDLESS_TEXTURES_H
+#define VULKAN_BINDLESS_TEXTURES_H
+
+#include "VulkanUtils.h"
+#include <unordered_map>
+
+class VulkanContext;
+class VulkanTexture;
+
+// Texture kinds a material references, indexed by TextureType (ALBEDO..AO)
+constexpr size_t MATERIAL_TEXTURE_COUNT = static_cast<size_t>(TextureType::AO) + 1;
+using MaterialTextures = std::array<const VulkanTexture*, MATERIAL_TEXTURE_COUNT>;
+
+// Owns the bindless descriptor set (set BINDLESS_SET): every material texture sits in one
+// partially bound, update-after-bind array and a storage buffer maps material indices to
+// texture indices. The set is bound once per frame and serves every draw; a draw only
+// passes its material index. Textures are shared between materials and their slots are
+// recycled through the deletion queue once the frames that may sample them have retired.
+class VulkanBindlessTextures final
+{
+public:
+	explicit VulkanBindlessTextures(VulkanContext* context) : context(context) {}
+	~VulkanBindlessTextures() = default;
+
+	VulkanBindlessTextures(const VulkanBindlessTextures&) = delete;
+	VulkanBindlessTextures& operator=(const VulkanBindlessTextures&) = delete;
+
+	//**
+	// Creates the update-after-bind pool, the descriptor set and the material buffer.
+	// layout is the pipeline's reflected layout for BINDLESS_SET.
+	//**
+	void Initialize(VkDescriptorSetLayout layout);
+
+	//**
+	// Adds a material and returns its index. Textures not yet in the array are added;
+	// null entries are stored as NO_TEXTURE and the shader uses a constant instead.
+	//**
+	uint32_t AddMaterial(const MaterialTextures& textures);
+
+	//**
+	// Removes a material. Textures no other material uses leave the array, their slots
+	// are reused only after the in-flight frames have retired.
+	//**
+	void RemoveMaterial(uint32_t materialIndex);
+
+	VkDescriptorSet GetDescriptorSet() const { return descriptorSet; }
+
+	//**
+	// Returns how many textures are currently in the array
+	//**
+	size_t GetTextureCount() const { return textureSlots.size(); }
+
+	void CleanupBindlessTextures();
+
+private:
+	struct TextureSlot
+	{
+		uint32_t index;
+		uint32_t materialCount; // materials referencing this texture
+	};
+
+	uint32_t AcquireTexture(const VulkanTexture& texture);
+	void ReleaseTexture(const VulkanTexture* texture);
+
+	VulkanContext* context;
+
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+	VkBuffer materialBuffer = VK_NULL_HANDLE;
+	VmaAllocation materialAllocation = VK_NULL_HANDLE;
+	MaterialData* mappedMaterials = nullptr;
+
+	std::unordered_map<const VulkanTexture*, TextureSlot> textureSlots;
+	std::vector<uint32_t> freeTextureSlots;
+	uint32_t nextTextureSlot = 0;
+
+	std::vector<MaterialTextures> materials; // textures per material index, to drop references on removal
+	std::vector<uint32_t> freeMaterialSlots;
+	uint32_t nextMaterialSlot = 0;
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "VulkanContext.h"
 
+#include <algorithm>
+#include <cstring>
 #include <set>
 
 
@@ -9,9 +11,12 @@ VulkanContext::VulkanContext(GLFWwindow* window)
 	CreateSurface(window);
 	SetupDebugMessenger();
 	PickPhysicalDevice();
+	QueryOptionalFeatures();
 	CreateLogicalDevice();
 	CreateVMAAllocator();
 	CreateCommandPool();
+	pipelineCache.Initialize();
+	shaderCompiler.Initialize();
 }
 
 void VulkanContext::CreateSurface(GLFWwindow* window)
@@ -154,30 +159,118 @@ void VulkanContext::PickPhysicalDevice()
 	for (const auto& device : devices) {
 		if (IsDeviceSuitable(device, surface)) {
 			physicalDevice = device;
-			msaaSamples = GetMaxUsableSampleCount();
 			break;
 		}
 	}
 
-	if (physicalDevice == VK_NULL_HANDLE) {
+	if (!physicalDevice.has_value()) {
 		throw std::runtime_error("failed to find a suitable GPU!");
 	}
-	
-
 
+	// Queried once here; everything else reads the limits through GetDeviceProperties
 	VkPhysicalDeviceProperties2 deviceProperties2{};
 	deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
-	VkPhysicalDeviceProperties& deviceProperties = deviceProperties2.properties;
-
 
 	VkPhysicalDeviceMaintenance4Properties maintenance4Properties{};
 	maintenance4Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MAINTENANCE_4_PROPERTIES;
 	deviceProperties2.pNext = &maintenance4Properties;
 
 	vkGetPhysicalDeviceProperties2(physicalDevice.value(), &deviceProperties2);
+	deviceProperties = deviceProperties2.properties;
+	maxBufferSize = maintenance4Properties.maxBufferSize;
+
+	msaaSamples = GetMaxUsableSampleCount();
 }
 
 
+void VulkanContext::QueryOptionalFeatures()
+{
+	enabledDeviceExtensions = deviceExtensions;
+
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice.value(), nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice.value(), nullptr, &extensionCount, availableExtensions.data());
+
+	auto hasExtension = [&](const char* name) {
+		return std::any_of(availableExtensions.begin(), availableExtensions.end(),
+			[&](const VkExtensionProperties& ext) { return strcmp(ext.extensionName, name) == 0; });
+		};
+
+	if (hasExtension(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) && hasExtension(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME))
+	{
+		VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT gplFeatures{};
+		gplFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &gplFeatures;
+		vkGetPhysicalDeviceFeatures2(physicalDevice.value(), &features2);
+
+		if (gplFeatures.graphicsPipelineLibrary)
+		{
+			VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT gplProperties{};
+			gplProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+			VkPhysicalDeviceProperties2 properties2{};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			properties2.pNext = &gplProperties;
+			vkGetPhysicalDeviceProperties2(physicalDevice.value(), &properties2);
+
+			optionalFeatures.graphicsPipelineLibrary = true;
+			optionalFeatures.graphicsPipelineLibraryFastLinking = gplProperties.graphicsPipelineLibraryFastLinking == VK_TRUE;
+			enabledDeviceExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+			enabledDeviceExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+		}
+	}
+
+	if (hasExtension(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME))
+	{
+		VkPhysicalDevicePushDescriptorPropertiesKHR pushDescriptorProperties{};
+		pushDescriptorProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR;
+		VkPhysicalDeviceProperties2 properties2{};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties2.pNext = &pushDescriptorProperties;
+		vkGetPhysicalDeviceProperties2(physicalDevice.value(), &properties2);
+
+		optionalFeatures.pushDescriptor = true;
+		optionalFeatures.maxPushDescriptors = pushDescriptorProperties.maxPushDescriptors;
+		enabledDeviceExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+	}
+
+	{
+		VkPhysicalDeviceVulkan12Features supportedFeatures12{};
+		supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &supportedFeatures12;
+		vkGetPhysicalDeviceFeatures2(physicalDevice.value(), &features2);
+
+		VkPhysicalDeviceDepthStencilResolveProperties depthResolveProperties{};
+		depthResolveProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DEPTH_STENCIL_RESOLVE_PROPERTIES;
+		VkPhysicalDeviceProperties2 properties2{};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties2.pNext = &depthResolveProperties;
+		vkGetPhysicalDeviceProperties2(physicalDevice.value(), &properties2);
+
+		// Core since 1.2, but still optional features
+		optionalFeatures.drawIndirectCount = supportedFeatures12.drawIndirectCount &&
+			features2.features.multiDrawIndirect && features2.features.drawIndirectFirstInstance;
+		optionalFeatures.occlusionCulling = optionalFeatures.drawIndirectCount &&
+			features2.features.shaderStorageImageExtendedFormats;
+		optionalFeatures.depthResolveMax = (depthResolveProperties.supportedDepthResolveModes & VK_RESOLVE_MODE_MAX_BIT) != 0;
+	}
+
+	std::cout << "Graphics pipeline library: " << (optionalFeatures.graphicsPipelineLibrary ?
+		(optionalFeatures.graphicsPipelineLibraryFastLinking ? "enabled (fast linking)" : "enabled") : "not supported, using monolithic pipelines") << std::endl;
+	std::cout << "Push descriptors: " << (optionalFeatures.pushDescriptor ?
+		"enabled (max " + std::to_string(optionalFeatures.maxPushDescriptors) + " per set)" : std::string("not supported, using per-frame descriptor sets")) << std::endl;
+	std::cout << "Draw indirect count: " << (optionalFeatures.drawIndirectCount ?
+		"enabled, GPU-driven culling" : "not supported, drawing meshes from the CPU") << std::endl;
+	std::cout << "Occlusion culling: " << (optionalFeatures.occlusionCulling ?
+		"enabled, two-phase Hi-Z" : "not supported, frustum culling only") << std::endl;
+	std::cout << "Depth resolve: " << (optionalFeatures.depthResolveMax ?
+		"max" : "sample zero, Hi-Z is approximate at MSAA edges") << std::endl;
+}
+
 void VulkanContext::CreateLogicalDevice()
 {
 
@@ -203,8 +296,21 @@ void VulkanContext::CreateLogicalDevice()
 	features13.maintenance4 = VK_TRUE;
 	features13.pNext = nullptr;
 
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT gplFeatures{};
+	gplFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	gplFeatures.graphicsPipelineLibrary = VK_TRUE;
+	if (optionalFeatures.graphicsPipelineLibrary) {
+		features13.pNext = &gplFeatures;
+	}
+
 	VkPhysicalDeviceVulkan12Features features12{};
 	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	features12.descriptorIndexing = VK_TRUE;
+	features12.runtimeDescriptorArray = VK_TRUE;
+	features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	features12.descriptorBindingPartiallyBound = VK_TRUE;
+	features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	features12.drawIndirectCount = optionalFeatures.drawIndirectCount ? VK_TRUE : VK_FALSE;
 	features12.pNext = &features13;
 
 	VkPhysicalDeviceVulkan11Features features11{};
@@ -216,6 +322,9 @@ void VulkanContext::CreateLogicalDevice()
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 	deviceFeatures.sampleRateShading = VK_TRUE;
 	deviceFeatures.sampleRateShading = VK_TRUE;
+	deviceFeatures.multiDrawIndirect = optionalFeatures.drawIndirectCount ? VK_TRUE : VK_FALSE;
+	deviceFeatures.drawIndirectFirstInstance = optionalFeatures.drawIndirectCount ? VK_TRUE : VK_FALSE;
+	deviceFeatures.shaderStorageImageExtendedFormats = optionalFeatures.occlusionCulling ? VK_TRUE : VK_FALSE;
 
 	VkPhysicalDeviceFeatures2 features2{};
 	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
@@ -232,8 +341,8 @@ void VulkanContext::CreateLogicalDevice()
 	createInfo.pEnabledFeatures = VK_NULL_HANDLE;
 	createInfo.pNext = &features2;
 
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledDeviceExtensions.size());
+	createInfo.ppEnabledExtensionNames = enabledDeviceExtensions.data();
 
 	if (enableValidationLayers) {
 		createInfo.enabledLayerCount = static_cast<uint32_t>(VALIDATION_LAYERS.size());
@@ -262,6 +371,15 @@ void VulkanContext::CreateLogicalDevice()
 
 	vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue.value());
 	vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue.value());
+
+	if (optionalFeatures.pushDescriptor) {
+		cmdPushDescriptorSetWithTemplate = reinterpret_cast<PFN_vkCmdPushDescriptorSetWithTemplateKHR>(
+			vkGetDeviceProcAddr(device, "vkCmdPushDescriptorSetWithTemplateKHR"));
+		if (cmdPushDescriptorSetWithTemplate == nullptr) {
+			std::cerr << "vkCmdPushDescriptorSetWithTemplateKHR not found, falling back to per-frame descriptor sets" << std::endl;
+			optionalFeatures.pushDescriptor = false;
+		}
+	}
 }
 
 bool VulkanContext::IsDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface)
@@ -282,7 +400,21 @@ bool VulkanContext::IsDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surfa
 	VkPhysicalDeviceFeatures supportedFeatures;
 	vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-	return indices.IsComplete() && extensionSupported && swapchainAdequate && supportedFeatures.samplerAnisotropy;
+	// Bindless material textures need descriptor indexing (core in 1.2, but the features are optional)
+	VkPhysicalDeviceVulkan12Features supportedFeatures12{};
+	supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 supportedFeatures2{};
+	supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supportedFeatures2.pNext = &supportedFeatures12;
+	vkGetPhysicalDeviceFeatures2(device, &supportedFeatures2);
+
+	bool descriptorIndexingSupported = supportedFeatures12.descriptorIndexing &&
+		supportedFeatures12.runtimeDescriptorArray &&
+		supportedFeatures12.shaderSampledImageArrayNonUniformIndexing &&
+		supportedFeatures12.descriptorBindingPartiallyBound &&
+		supportedFeatures12.descriptorBindingSampledImageUpdateAfterBind;
+
+	return indices.IsComplete() && extensionSupported && swapchainAdequate && supportedFeatures.samplerAnisotropy && descriptorIndexingSupported;
 
 
 
@@ -349,6 +481,11 @@ void VulkanContext::CreateCommandPool()
 
 void VulkanContext::CleanupContext()
 {
+	shaderCompiler.CleanupShaderCompiler();
+	deletionQueue.FlushAll();
+	pipelineCache.CleanupPipelineCache();
+	descriptorSetLayoutCache.CleanupLayouts();
+	samplerCache.CleanupSamplers();
 	vkDestroyCommandPool(device, commandPool.value(), nullptr);
 	vkDestroySurfaceKHR(instance, surface, nullptr);
 	DestroyDebugUtilsMessengerEXT(nullptr);
@@ -373,11 +510,8 @@ void VulkanContext::SetupDebugMessenger()
 
 VkSampleCountFlagBits VulkanContext::GetMaxUsableSampleCount()
 {
-	VkPhysicalDeviceProperties physicalDeviceProperties;
-	vkGetPhysicalDeviceProperties(physicalDevice.value(), &physicalDeviceProperties);
-
-	VkSampleCountFlags counts = physicalDeviceProperties.limits.framebufferColorSampleCounts &
-		physicalDeviceProperties.limits.framebufferDepthSampleCounts;
+	VkSampleCountFlags counts = deviceProperties.limits.framebufferColorSampleCounts &
+		deviceProperties.limits.framebufferDepthSampleCounts;
 
 	for (VkSampleCountFlagBits bit = VK_SAMPLE_COUNT_64_BIT; bit > 0; bit = (VkSampleCountFlagBits)(bit >> 1)) {
 		if (counts & bit) {
@@ -4,6 +4,11 @@
 
 
 #include "VulkanUtils.h"
+#include "VulkanDeletionQueue.h"
+#include "VulkanPipelineCache.h"
+#include "VulkanDescriptorSetLayoutCache.h"
+#include "VulkanSamplerCache.h"
+#include "ShaderCompiler.h"
 #include <optional>
 // TODO:
 // need to be able to add extensions easily -> look at slides for example
@@ -16,6 +21,27 @@ const std::vector<const char*> deviceExtensions = {
     //VK_KHR_MAINTENANCE2_EXTENSION_NAME,
 };
 
+// Extensions/features that are used when the device has them, with a fallback otherwise
+struct OptionalDeviceFeatures
+{
+    // VK_EXT_graphics_pipeline_library: pipelines are linked from separately compiled parts
+    bool graphicsPipelineLibrary = false;
+    // The driver reports that linking without link-time optimization is fast
+    bool graphicsPipelineLibraryFastLinking = false;
+    // VK_KHR_push_descriptor: per-pass descriptors are pushed into the command buffer instead of allocated
+    bool pushDescriptor = false;
+    uint32_t maxPushDescriptors = 0;
+    // drawIndirectCount, multiDrawIndirect and drawIndirectFirstInstance: culled draw lists are
+    // built on the GPU and drawn with vkCmdDrawIndexedIndirectCount
+    bool drawIndirectCount = false;
+    // drawIndirectCount plus shaderStorageImageExtendedFormats (the rg32f Hi-Z pyramid): two-phase
+    // occlusion culling against the previous frame's visible set
+    bool occlusionCulling = false;
+    // supportedDepthResolveModes has VK_RESOLVE_MODE_MAX_BIT: the depth resolve keeps the farthest
+    // sample, so the Hi-Z pyramid built from it stays conservative at MSAA silhouettes
+    bool depthResolveMax = false;
+};
+
 // Class responsible for managing the overall Vulkan context
 class VulkanContext final
 {
@@ -50,12 +76,36 @@ public:
     // Returns the command pool
     VkCommandPool GetCommandPool() const { return commandPool.value(); }      // Use optional
 
+    // Returns the properties and limits of the physical device, queried once when it is picked
+    const VkPhysicalDeviceProperties& GetDeviceProperties() const { return deviceProperties; }
+
     // Returns the maximum buffer size supported by the device
     VkDeviceSize GetMaxBufferSize() const { return maxBufferSize; }
 
     // Returns the number of MSAA samples
     VkSampleCountFlagBits GetMsaaSamples() const { return msaaSamples; }
 
+    // Returns which optional extensions were found and enabled on the device
+    const OptionalDeviceFeatures& GetOptionalFeatures() const { return optionalFeatures; }
+
+    // Returns vkCmdPushDescriptorSetWithTemplateKHR, or nullptr without VK_KHR_push_descriptor
+    PFN_vkCmdPushDescriptorSetWithTemplateKHR GetCmdPushDescriptorSetWithTemplate() const { return cmdPushDescriptorSetWithTemplate; }
+
+    // Returns the queue used to defer destruction of resources until the GPU is done with them
+    VulkanDeletionQueue& GetDeletionQueue() { return deletionQueue; }
+
+    // Returns the engine-wide pipeline cache shared by every VulkanPipeline
+    VulkanPipelineCache& GetPipelineCache() { return pipelineCache; }
+
+    // Returns the cache that deduplicates descriptor set layouts across pipelines
+    VulkanDescriptorSetLayoutCache& GetDescriptorSetLayoutCache() { return descriptorSetLayoutCache; }
+
+    // Returns the cache that shares identical samplers between textures and render targets
+    VulkanSamplerCache& GetSamplerCache() { return samplerCache; }
+
+    // Returns the service that loads (and, if enabled, compiles and watches) shader SPIR-V
+    ShaderCompiler& GetShaderCompiler() { return shaderCompiler; }
+
     // Cleans up all Vulkan resources managed by the context
     void CleanupContext();
 
@@ -87,6 +137,9 @@ private:
     // Picks the best-suited physical device
     void PickPhysicalDevice();
 
+    // Detects optional extensions on the picked device and adds them to the enabled extension list
+    void QueryOptionalFeatures();
+
     // Creates the Vulkan logical device
     void CreateLogicalDevice();
 
@@ -129,13 +182,38 @@ private:
     // Vulkan command pool handle
     std::optional<VkCommandPool> commandPool = std::nullopt;         
 
+    // Properties of the picked physical device
+    VkPhysicalDeviceProperties deviceProperties{};
+
     // Maximum buffer size supported by the device
-    VkDeviceSize maxBufferSize;
+    VkDeviceSize maxBufferSize = 0;
 
     // MSAA sample count
     VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
 
+    // Required deviceExtensions plus the optional ones the device supports
+    std::vector<const char*> enabledDeviceExtensions;
+    OptionalDeviceFeatures optionalFeatures;
+
+    // Extension entry points, loaded after device creation
+    PFN_vkCmdPushDescriptorSetWithTemplateKHR cmdPushDescriptorSetWithTemplate = nullptr;
+
     // VMA allocator handle
     VmaAllocator VMA_ALLOCATOR;
+
+    // Resources waiting for their last frame to retire before being destroyed
+    VulkanDeletionQueue deletionQueue{ this };
+
+    // Pipeline cache persisted per device between runs
+    VulkanPipelineCache pipelineCache{ this };
+
+    // Descriptor set layouts shared between pipelines
+    VulkanDescriptorSetLayoutCache descriptorSetLayoutCache{ this };
+
+    // Samplers shared by description
+    VulkanSamplerCache samplerCache{ this };
+
+    // SPIR-V loading, runtime compilation and shader hot reload
+    ShaderCompiler shaderCompiler;
 };
 #endif
\ No newline at end of file
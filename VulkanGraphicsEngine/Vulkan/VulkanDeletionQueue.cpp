@@ -0,0 +1,127 @@
+#include "VulkanDeletionQueue.h"
+#include "VulkanContext.h"
+#include <algorithm>
+#include <iterator>
+
+void VulkanDeletionQueue::BeginFrame(uint64_t frameNumber)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	currentFrame = frameNumber;
+}
+
+void VulkanDeletionQueue::Flush(uint64_t completedFrameCount)
+{
+	std::vector<PendingDeletion> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto firstPending = std::stable_partition(pending.begin(), pending.end(),
+			[completedFrameCount](const PendingDeletion& entry) { return entry.lastUsedFrame < completedFrameCount; });
+
+		ready.assign(std::make_move_iterator(pending.begin()), std::make_move_iterator(firstPending));
+		pending.erase(pending.begin(), firstPending);
+	}
+
+	// Run the deleters outside the lock so they are free to enqueue follow-up work
+	for (auto& entry : ready)
+	{
+		entry.deleter();
+	}
+}
+
+void VulkanDeletionQueue::FlushAll()
+{
+	std::vector<PendingDeletion> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ready.swap(pending);
+	}
+
+	for (auto& entry : ready)
+	{
+		entry.deleter();
+	}
+}
+
+void VulkanDeletionQueue::Push(std::function<void()>&& deleter)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pending.push_back({ currentFrame, std::move(deleter) });
+}
+
+void VulkanDeletionQueue::Push(uint64_t lastUsedFrame, std::function<void()>&& deleter)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pending.push_back({ lastUsedFrame, std::move(deleter) });
+}
+
+void VulkanDeletionQueue::DestroyBuffer(VkBuffer buffer, VmaAllocation allocation)
+{
+	if (buffer == VK_NULL_HANDLE) return;
+
+	VmaAllocator allocator = context->GetVMAAllocator();
+	Push([allocator, buffer, allocation]() { vmaDestroyBuffer(allocator, buffer, allocation); });
+}
+
+void VulkanDeletionQueue::DestroyImage(VkImage image, VmaAllocation allocation)
+{
+	if (image == VK_NULL_HANDLE) return;
+
+	VmaAllocator allocator = context->GetVMAAllocator();
+	Push([allocator, image, allocation]() { vmaDestroyImage(allocator, image, allocation); });
+}
+
+void VulkanDeletionQueue::DestroyImageView(VkImageView imageView)
+{
+	if (imageView == VK_NULL_HANDLE) return;
+
+	VkDevice device = context->GetDevice();
+	Push([device, imageView]() { vkDestroyImageView(device, imageView, nullptr); });
+}
+
+void VulkanDeletionQueue::DestroySampler(VkSampler sampler)
+{
+	if (sampler == VK_NULL_HANDLE) return;
+
+	VkDevice device = context->GetDevice();
+	Push([device, sampler]() { vkDestroySampler(device, sampler, nullptr); });
+}
+
+void VulkanDeletionQueue::DestroyPipeline(VkPipeline pipeline)
+{
+	if (pipeline == VK_NULL_HANDLE) return;
+
+	VkDevice device = context->GetDevice();
+	Push([device, pipeline]() { vkDestroyPipeline(device, pipeline, nullptr); });
+}
+
+void VulkanDeletionQueue::DestroyPipelineLayout(VkPipelineLayout pipelineLayout)
+{
+	if (pipelineLayout == VK_NULL_HANDLE) return;
+
+	VkDevice device = context->GetDevice();
+	Push([device, pipelineLayout]() { vkDestroyPipelineLayout(device, pipelineLayout, nullptr); });
+}
+
+void VulkanDeletionQueue::DestroySwapchain(VkSwapchainKHR swapchain)
+{
+	if (swapchain == VK_NULL_HANDLE) return;
+
+	VkDevice device = context->GetDevice();
+	Push([device, swapchain]() { vkDestroySwapchainKHR(device, swapchain, nullptr); });
+}
+
+void VulkanDeletionQueue::FreeDescriptorSets(VkDescriptorPool pool, const std::vector<VkDescriptorSet>& sets)
+{
+	if (pool == VK_NULL_HANDLE || sets.empty()) return;
+
+	// The pool must have been created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+	VkDevice device = context->GetDevice();
+	Push([device, pool, sets]() { vkFreeDescriptorSets(device, pool, static_cast<uint32_t>(sets.size()), sets.data()); });
+}
+
+size_t VulkanDeletionQueue::GetPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pending.size();
+}
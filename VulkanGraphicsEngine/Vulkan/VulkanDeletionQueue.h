@@ -0,0 +1,74 @@
+#ifndef VULKAN_DELETION_QUEUE_H
+#define VULKAN_DELETION_QUEUE_H
+
+#include "VulkanUtils.h"
+#include <functional>
+#include <mutex>
+#include <vector>
+
+class VulkanContext;
+
+// Defers destruction of GPU objects until the last frame that used them has retired.
+// Every enqueued object is tagged with a frame number; the renderer reports how many
+// frames have completed on the GPU (their in-flight fence signalled) and everything
+// tagged with an older frame is destroyed. This lets meshes, textures and swapchain
+// resources be released at runtime without a vkDeviceWaitIdle.
+class VulkanDeletionQueue final
+{
+public:
+	explicit VulkanDeletionQueue(VulkanContext* context) : context(context) {}
+	~VulkanDeletionQueue() = default;
+
+	VulkanDeletionQueue(const VulkanDeletionQueue&) = delete;
+	VulkanDeletionQueue& operator=(const VulkanDeletionQueue&) = delete;
+
+	//**
+	// Sets the frame number that is currently being recorded. Objects enqueued without an
+	// explicit frame are assumed to be used up to and including this frame.
+	//**
+	void BeginFrame(uint64_t frameNumber);
+
+	uint64_t GetCurrentFrame() const { return currentFrame; }
+
+	//**
+	// Destroys every object whose last use is older than completedFrameCount,
+	// i.e. frames [0, completedFrameCount) have finished executing on the GPU.
+	//**
+	void Flush(uint64_t completedFrameCount);
+
+	//**
+	// Destroys everything regardless of frame. Only call once the device is idle.
+	//**
+	void FlushAll();
+
+	// --- Generic enqueue ---
+	void Push(std::function<void()>&& deleter);
+	void Push(uint64_t lastUsedFrame, std::function<void()>&& deleter);
+
+	// --- Typed helpers, tagged with the current frame ---
+	void DestroyBuffer(VkBuffer buffer, VmaAllocation allocation);
+	void DestroyImage(VkImage image, VmaAllocation allocation);
+	void DestroyImageView(VkImageView imageView);
+	void DestroySampler(VkSampler sampler);
+	void DestroyPipeline(VkPipeline pipeline);
+	void DestroyPipelineLayout(VkPipelineLayout pipelineLayout);
+	void DestroySwapchain(VkSwapchainKHR swapchain);
+	void FreeDescriptorSets(VkDescriptorPool pool, const std::vector<VkDescriptorSet>& sets);
+
+	size_t GetPendingCount() const;
+
+private:
+	struct PendingDeletion
+	{
+		uint64_t lastUsedFrame;
+		std::function<void()> deleter;
+	};
+
+	VulkanContext* context;
+
+	mutable std::mutex mutex;
+	std::vector<PendingDeletion> pending;
+	uint64_t currentFrame = 0;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanContext.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Pools grow by half each time, up to this many sets
+	constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+}
+
+void VulkanDescriptorAllocator::Initialize(uint32_t initialSets, const std::vector<DescriptorPoolSizeRatio>& poolRatios,
+	VkDescriptorPoolCreateFlags poolFlags)
+{
+	if (initialSets == 0 || poolRatios.empty()) {
+		throw std::runtime_error("Invalid pool sizes or set count for descriptor allocator.");
+	}
+
+	ratios = poolRatios;
+	flags = poolFlags;
+	setsPerPool = initialSets;
+}
+
+VkDescriptorPool VulkanDescriptorAllocator::CreatePool(uint32_t setCount)
+{
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	poolSizes.reserve(ratios.size());
+	for (const DescriptorPoolSizeRatio& ratio : ratios)
+	{
+		const uint32_t count = std::max(1u, static_cast<uint32_t>(std::ceil(ratio.ratio * setCount)));
+		poolSizes.push_back({ ratio.type, count });
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = flags;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = setCount;
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	if (vkCreateDescriptorPool(context->GetDevice(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor pool!");
+	}
+	return pool;
+}
+
+VkDescriptorPool VulkanDescriptorAllocator::GetPool()
+{
+	if (!readyPools.empty()) {
+		VkDescriptorPool pool = readyPools.back();
+		readyPools.pop_back();
+		return pool;
+	}
+
+	if (setsPerPool == 0) {
+		throw std::runtime_error("Descriptor allocator has not been initialized!");
+	}
+
+	VkDescriptorPool pool = CreatePool(setsPerPool);
+	setsPerPool = std::min(MAX_SETS_PER_POOL, setsPerPool + setsPerPool / 2);
+	return pool;
+}
+
+VkDescriptorSet VulkanDescriptorAllocator::Allocate(VkDescriptorSetLayout layout, const void* pNext)
+{
+	if (layout == VK_NULL_HANDLE) {
+		throw std::runtime_error("Cannot allocate descriptor sets with a null layout!");
+	}
+
+	if (currentPool == VK_NULL_HANDLE) {
+		currentPool = GetPool();
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.pNext = pNext;
+	allocInfo.descriptorPool = currentPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	VkResult result = vkAllocateDescriptorSets(context->GetDevice(), &allocInfo, &set);
+
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+		// Retire the pool until the next reset and retry once with a fresh one
+		fullPools.push_back(currentPool);
+		currentPool = GetPool();
+		allocInfo.descriptorPool = currentPool;
+		result = vkAllocateDescriptorSets(context->GetDevice(), &allocInfo, &set);
+	}
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate descriptor set! A fresh pool cannot hold this layout, check the pool ratios.");
+	}
+	return set;
+}
+
+void VulkanDescriptorAllocator::ResetPools()
+{
+	if (currentPool != VK_NULL_HANDLE) {
+		readyPools.push_back(currentPool);
+		currentPool = VK_NULL_HANDLE;
+	}
+	readyPools.insert(readyPools.end(), fullPools.begin(), fullPools.end());
+	fullPools.clear();
+
+	for (VkDescriptorPool pool : readyPools)
+	{
+		vkResetDescriptorPool(context->GetDevice(), pool, 0);
+	}
+}
+
+void VulkanDescriptorAllocator::CleanupPools()
+{
+	if (currentPool != VK_NULL_HANDLE) {
+		readyPools.push_back(currentPool);
+		currentPool = VK_NULL_HANDLE;
+	}
+	readyPools.insert(readyPools.end(), fullPools.begin(), fullPools.end());
+	fullPools.clear();
+
+	for (VkDescriptorPool pool : readyPools)
+	{
+		vkDestroyDescriptorPool(context->GetDevice(), pool, nullptr);
+	}
+	readyPools.clear();
+}
@@ -0,0 +1,69 @@
+#ifndef VULKAN_DESCRIPTOR_ALLOCATOR_H
+#define VULKAN_DESCRIPTOR_ALLOCATOR_H
+
+#include "VulkanUtils.h"
+
+class VulkanContext;
+
+// Descriptors reserved per set in every pool, e.g. { UNIFORM_BUFFER, 2.0f } means a pool
+// for 100 sets holds 200 uniform buffer descriptors
+struct DescriptorPoolSizeRatio
+{
+	VkDescriptorType type;
+	float ratio;
+};
+
+// Growable descriptor allocator: sets come from the current pool until it reports
+// VK_ERROR_OUT_OF_POOL_MEMORY / VK_ERROR_FRAGMENTED_POOL, then a new (larger) pool is chained
+// in and the allocation is retried. Nobody has to size pools by hand, and ResetPools
+// recycles every pool in bulk, which is how per-frame transient sets are released.
+class VulkanDescriptorAllocator final
+{
+public:
+	explicit VulkanDescriptorAllocator(VulkanContext* context) : context(context) {}
+	~VulkanDescriptorAllocator() = default;
+
+	VulkanDescriptorAllocator(const VulkanDescriptorAllocator&) = delete;
+	VulkanDescriptorAllocator& operator=(const VulkanDescriptorAllocator&) = delete;
+
+	//**
+	// Sets the pool shape. The first pool holds initialSets sets, each further pool 1.5x more.
+	//**
+	void Initialize(uint32_t initialSets, const std::vector<DescriptorPoolSizeRatio>& poolRatios,
+		VkDescriptorPoolCreateFlags poolFlags = 0);
+
+	//**
+	// Allocates one set, chaining a new pool when the current one is exhausted.
+	// pNext is passed to VkDescriptorSetAllocateInfo (variable descriptor counts).
+	//**
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout, const void* pNext = nullptr);
+
+	//**
+	// Resets every pool; all sets allocated from this allocator become invalid.
+	// Only call once the GPU no longer uses any of them.
+	//**
+	void ResetPools();
+
+	//**
+	// Returns how many pools have been created so far
+	//**
+	size_t GetPoolCount() const { return readyPools.size() + fullPools.size() + (currentPool != VK_NULL_HANDLE ? 1 : 0); }
+
+	void CleanupPools();
+
+private:
+	VkDescriptorPool GetPool();
+	VkDescriptorPool CreatePool(uint32_t setCount);
+
+	VulkanContext* context;
+
+	std::vector<DescriptorPoolSizeRatio> ratios;
+	VkDescriptorPoolCreateFlags flags = 0;
+	uint32_t setsPerPool = 0;
+
+	VkDescriptorPool currentPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorPool> readyPools; // have room left (or were reset)
+	std::vector<VkDescriptorPool> fullPools;  // ran out, wait for ResetPools
+};
+
+#endif
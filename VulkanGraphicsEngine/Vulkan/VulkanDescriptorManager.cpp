@@ -3,34 +3,55 @@
 #include "Scene.h"
 #include "VulkanContext.h"
 
-VulkanDescriptorManager::VulkanDescriptorManager(VulkanContext* ctx) : context(ctx) {
+namespace
+{
+    // Rough descriptor mix of the engine's sets; the allocator chains another pool if a type runs out
+    const std::vector<DescriptorPoolSizeRatio> POOL_RATIOS = {
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f},
+    };
+
+    constexpr uint32_t PERSISTENT_SETS_PER_POOL = 16;
+    constexpr uint32_t TRANSIENT_SETS_PER_POOL = 64;
+}
+
+VulkanDescriptorManager::VulkanDescriptorManager(VulkanContext* ctx) : context(ctx), persistentAllocator(ctx) {
     if (!context) {
         throw std::runtime_error("VulkanContext cannot be null for VulkanDescriptorManager");
     }
 }
 
-void VulkanDescriptorManager::CreateDescriptorPool(
-    const std::vector<VkDescriptorPoolSize>& poolSizes,
-    uint32_t maxSets,
-    VkDescriptorPoolCreateFlags flags)
+void VulkanDescriptorManager::Initialize()
 {
-    if (descriptorPool != VK_NULL_HANDLE) {
-        throw std::runtime_error("Descriptor pool already created. Call CleanupPool first.");
-    }
-    if (poolSizes.empty() || maxSets == 0) {
-        throw std::runtime_error("Invalid pool sizes or max sets for descriptor pool creation.");
+    persistentAllocator.Initialize(PERSISTENT_SETS_PER_POOL, POOL_RATIOS);
+
+    frameAllocators.clear();
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+    {
+        frameAllocators.push_back(std::make_unique<VulkanDescriptorAllocator>(context));
+        frameAllocators.back()->Initialize(TRANSIENT_SETS_PER_POOL, POOL_RATIOS);
     }
+}
 
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.flags = flags;
-    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = maxSets;
+void VulkanDescriptorManager::BeginFrame(uint32_t frameIndex)
+{
+    if (frameIndex >= frameAllocators.size()) {
+        throw std::runtime_error("Descriptor manager has not been initialized for this frame index!");
+    }
+    currentFrame = frameIndex;
+    frameAllocators[currentFrame]->ResetPools();
+}
 
-    if (vkCreateDescriptorPool(context->GetDevice(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create descriptor pool!");
+size_t VulkanDescriptorManager::GetPoolCount() const
+{
+    size_t count = persistentAllocator.GetPoolCount();
+    for (const auto& allocator : frameAllocators)
+    {
+        count += allocator->GetPoolCount();
     }
+    return count;
 }
 
 VkDescriptorSetLayout VulkanDescriptorManager::CreateDescriptorSetLayout(
@@ -54,135 +75,195 @@ VkDescriptorSetLayout VulkanDescriptorManager::CreateDescriptorSetLayout(
     return layout; // Return the handle
 }
 
+VkDescriptorSetLayout VulkanDescriptorManager::GetOrCreateDescriptorSetLayout(
+    const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+    VkDescriptorSetLayoutCreateFlags flags,
+    const std::vector<VkDescriptorBindingFlags>& bindingFlags)
+{
+    return context->GetDescriptorSetLayoutCache().GetOrCreateLayout(bindings, flags, bindingFlags);
+}
 
-std::vector<VkDescriptorSet> VulkanDescriptorManager::AllocateAndWriteDescriptorSets(
-    VkDescriptorSetLayout layout,
-    uint32_t setCount,
-    std::function<std::pair<std::vector<DescriptorBufferBinding>, std::vector<DescriptorImageBinding>>(uint32_t setIndex)> getBindingsForSet)
+bool VulkanDescriptorManager::TemplateKey::operator==(const TemplateKey& other) const
 {
-    if (descriptorPool == VK_NULL_HANDLE) {
-        throw std::runtime_error("Descriptor pool has not been created!");
+    if (layout != other.layout || type != other.type || pipelineLayout != other.pipelineLayout ||
+        set != other.set || bindPoint != other.bindPoint || entries.size() != other.entries.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const DescriptorTemplateEntry& a = entries[i];
+        const DescriptorTemplateEntry& b = other.entries[i];
+        if (a.binding != b.binding || a.type != b.type || a.offset != b.offset ||
+            a.count != b.count || a.arrayElement != b.arrayElement || a.stride != b.stride) {
+            return false;
+        }
     }
+    return true;
+}
+
+size_t VulkanDescriptorManager::TemplateKeyHash::operator()(const TemplateKey& key) const
+{
+    size_t seed = std::hash<VkDescriptorSetLayout>{}(key.layout);
+    VulkanUtils::HashCombine(seed, static_cast<size_t>(key.type));
+    VulkanUtils::HashCombine(seed, std::hash<VkPipelineLayout>{}(key.pipelineLayout));
+    VulkanUtils::HashCombine(seed, key.set);
+    VulkanUtils::HashCombine(seed, static_cast<size_t>(key.bindPoint));
+    for (const DescriptorTemplateEntry& entry : key.entries) {
+        VulkanUtils::HashCombine(seed, entry.binding);
+        VulkanUtils::HashCombine(seed, static_cast<size_t>(entry.type));
+        VulkanUtils::HashCombine(seed, entry.offset);
+        VulkanUtils::HashCombine(seed, entry.count);
+        VulkanUtils::HashCombine(seed, entry.arrayElement);
+        VulkanUtils::HashCombine(seed, entry.stride);
+    }
+    return seed;
+}
+
+VkDescriptorUpdateTemplate VulkanDescriptorManager::GetOrCreateUpdateTemplate(
+    VkDescriptorSetLayout layout,
+    const std::vector<DescriptorTemplateEntry>& entries)
+{
     if (layout == VK_NULL_HANDLE) {
-        throw std::runtime_error("Cannot allocate descriptor sets with a null layout!");
+        throw std::runtime_error("Cannot create a descriptor update template without a layout!");
     }
-    if (setCount == 0) {
-        return {}; 
+
+    TemplateKey key{};
+    key.layout = layout;
+    key.type = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    key.entries = entries;
+    return GetOrCreateTemplate(key);
+}
+
+VkDescriptorUpdateTemplate VulkanDescriptorManager::GetOrCreatePushDescriptorTemplate(
+    VkDescriptorSetLayout layout,
+    VkPipelineLayout pipelineLayout,
+    uint32_t set,
+    const std::vector<DescriptorTemplateEntry>& entries,
+    VkPipelineBindPoint bindPoint)
+{
+    if (!context->GetOptionalFeatures().pushDescriptor) {
+        throw std::runtime_error("Push descriptor templates require VK_KHR_push_descriptor!");
     }
-    if (!getBindingsForSet) {
-        throw std::runtime_error("Binding provider callback is null!");
+    if (layout == VK_NULL_HANDLE || pipelineLayout == VK_NULL_HANDLE) {
+        throw std::runtime_error("Cannot create a push descriptor template without a set and pipeline layout!");
     }
 
-    // 1. Allocate Descriptor Sets
-    std::vector<VkDescriptorSetLayout> layouts(setCount, layout);
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = setCount;
-    allocInfo.pSetLayouts = layouts.data();
+    TemplateKey key{};
+    key.layout = layout;
+    key.type = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR;
+    key.pipelineLayout = pipelineLayout;
+    key.set = set;
+    key.bindPoint = bindPoint;
+    key.entries = entries;
+    return GetOrCreateTemplate(key);
+}
 
-    std::vector<VkDescriptorSet> allocatedSets(setCount);
-    VkResult result = vkAllocateDescriptorSets(context->GetDevice(), &allocInfo, allocatedSets.data());
-    if (result != VK_SUCCESS) {
-        // Provide more context on pool exhaustion if possible
-        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
-            throw std::runtime_error("Failed to allocate descriptor sets! Pool may be out of memory or too fragmented.");
-        }
-        else {
-            throw std::runtime_error("Failed to allocate descriptor sets! Vulkan error.");
-        }
+VkDescriptorUpdateTemplate VulkanDescriptorManager::GetOrCreateTemplate(const TemplateKey& key)
+{
+    auto it = updateTemplates.find(key);
+    if (it != updateTemplates.end()) {
+        return it->second;
     }
 
-    // 2. Update each Descriptor Set
-    // Use vectors that grow, easier than fixed arrays if binding count varies slightly per set
-    std::vector<VkWriteDescriptorSet> descriptorWrites;
-    std::vector<VkDescriptorBufferInfo> tempBufferInfos; // Must persist until vkUpdateDescriptorSets
-    std::vector<VkDescriptorImageInfo> tempImageInfos;   // Must persist until vkUpdateDescriptorSets
+    VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+    templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    templateInfo.templateType = key.type;
+    if (key.type == VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR) {
+        // descriptorSetLayout is ignored for push templates, the set is identified through the pipeline layout
+        templateInfo.pipelineBindPoint = key.bindPoint;
+        templateInfo.pipelineLayout = key.pipelineLayout;
+        templateInfo.set = key.set;
+    }
+    else {
+        templateInfo.descriptorSetLayout = key.layout;
+    }
 
-    for (uint32_t i = 0; i < setCount; ++i) {
-        // Clear previous iteration's data (or reuse if possible and careful)
-        descriptorWrites.clear();
-        tempBufferInfos.clear();
-        tempImageInfos.clear();
-
-        // Get the specific bindings for this set index from the caller
-		auto [bufferBindings, imageBindings] = getBindingsForSet(i);  // CRASHES HERE
-
-        // Reserve space roughly (optional optimization)
-        descriptorWrites.reserve(bufferBindings.size() + imageBindings.size());
-        tempBufferInfos.reserve(bufferBindings.size());
-        tempImageInfos.reserve(imageBindings.size());
-
-        // Prepare writes for buffers
-        for (const auto& bindingInfo : bufferBindings) {
-            if (bindingInfo.buffer == VK_NULL_HANDLE) {
-                fprintf(stderr, "Warning: Skipping null buffer for binding %u in descriptor set %u\n", bindingInfo.binding, i);
-                continue; // Skip null resources
-            }
-            // Create the info struct and store it
-            tempBufferInfos.push_back({
-                .buffer = bindingInfo.buffer,
-                .offset = bindingInfo.offset,
-                .range = bindingInfo.range
-                });
-
-            // Create the write operation pointing to the *stored* info
-            VkWriteDescriptorSet write{};
-            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            write.dstSet = allocatedSets[i];
-            write.dstBinding = bindingInfo.binding;
-            write.dstArrayElement = 0; // Assuming not an array of UBOs here
-            write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; // Or DYNAMIC etc.
-            write.descriptorCount = 1;
-            write.pBufferInfo = &tempBufferInfos.back(); // Point to the persistent info
-            descriptorWrites.push_back(write);
-        }
+    VkDescriptorUpdateTemplate updateTemplate = CreateUpdateTemplate(templateInfo, key.entries);
+    updateTemplates.emplace(key, updateTemplate);
+    return updateTemplate;
+}
 
-        // Prepare writes for images
-        for (const auto& bindingInfo : imageBindings) {
-            // Check for valid image view AND sampler for combined sampler type
-            if (bindingInfo.imageView == VK_NULL_HANDLE || bindingInfo.sampler == VK_NULL_HANDLE) {
-                fprintf(stderr, "Warning: Skipping null image view or sampler for binding %u, arrayElement %u in descriptor set %u\n", bindingInfo.binding, bindingInfo.arrayElement, i);
-                continue; // Skip null resources
-            }
-            // Create the info struct and store it
-            tempImageInfos.push_back({
-                 .sampler = bindingInfo.sampler, // Order matters for {} initialization
-                 .imageView = bindingInfo.imageView,
-                 .imageLayout = bindingInfo.imageLayout
-                });
-
-            // Create the write operation pointing to the *stored* info
-            VkWriteDescriptorSet write{};
-            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            write.dstSet = allocatedSets[i];
-            write.dstBinding = bindingInfo.binding;
-            write.dstArrayElement = bindingInfo.arrayElement;
-            write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            write.descriptorCount = 1; // Assuming 1 descriptor per binding here
-            write.pImageInfo = &tempImageInfos.back(); // Point to the persistent info
-            descriptorWrites.push_back(write);
-        }
+VkDescriptorUpdateTemplate VulkanDescriptorManager::CreateUpdateTemplate(
+    VkDescriptorUpdateTemplateCreateInfo& templateInfo,
+    const std::vector<DescriptorTemplateEntry>& entries)
+{
+    if (entries.empty()) {
+        throw std::runtime_error("Cannot create a descriptor update template without entries!");
+    }
 
-        // Update the descriptor set for index 'i' if there's anything to write
-        if (!descriptorWrites.empty()) {
-            vkUpdateDescriptorSets(context->GetDevice(),
-                static_cast<uint32_t>(descriptorWrites.size()),
-                descriptorWrites.data(),
-                0, nullptr);
-        }
+    std::vector<VkDescriptorUpdateTemplateEntry> templateEntries;
+    templateEntries.reserve(entries.size());
+    for (const DescriptorTemplateEntry& entry : entries) {
+        const bool isImage = entry.type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+            entry.type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || entry.type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        const size_t infoSize = isImage ? sizeof(VkDescriptorImageInfo) : sizeof(VkDescriptorBufferInfo);
+
+        VkDescriptorUpdateTemplateEntry templateEntry{};
+        templateEntry.dstBinding = entry.binding;
+        templateEntry.dstArrayElement = entry.arrayElement;
+        templateEntry.descriptorCount = entry.count;
+        templateEntry.descriptorType = entry.type;
+        templateEntry.offset = entry.offset;
+        templateEntry.stride = entry.stride != 0 ? entry.stride : infoSize;
+        templateEntries.push_back(templateEntry);
     }
 
-    return allocatedSets; // Return the newly created and updated sets
+    templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(templateEntries.size());
+    templateInfo.pDescriptorUpdateEntries = templateEntries.data();
+
+    VkDescriptorUpdateTemplate updateTemplate = VK_NULL_HANDLE;
+    if (vkCreateDescriptorUpdateTemplate(context->GetDevice(), &templateInfo, nullptr, &updateTemplate) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor update template!");
+    }
+    return updateTemplate;
 }
 
-void VulkanDescriptorManager::CleanupPool() {
-    if (context && descriptorPool != VK_NULL_HANDLE) {
-        vkDestroyDescriptorPool(context->GetDevice(), descriptorPool, nullptr);
-        descriptorPool = VK_NULL_HANDLE; // Mark as destroyed
+std::vector<VkDescriptorSet> VulkanDescriptorManager::AllocateDescriptorSets(VkDescriptorSetLayout layout, uint32_t setCount)
+{
+    std::vector<VkDescriptorSet> allocatedSets(setCount);
+    for (uint32_t i = 0; i < setCount; ++i) {
+        allocatedSets[i] = persistentAllocator.Allocate(layout);
+    }
+    return allocatedSets;
+}
+
+VkDescriptorSet VulkanDescriptorManager::AllocateTransientDescriptorSet(VkDescriptorSetLayout layout)
+{
+    if (frameAllocators.empty()) {
+        throw std::runtime_error("Descriptor manager has not been initialized!");
     }
+    return frameAllocators[currentFrame]->Allocate(layout);
 }
 
+void VulkanDescriptorManager::UpdateDescriptorSet(VkDescriptorSet set, VkDescriptorUpdateTemplate updateTemplate, const void* data)
+{
+    if (set == VK_NULL_HANDLE || updateTemplate == VK_NULL_HANDLE || data == nullptr) {
+        throw std::runtime_error("Cannot update a descriptor set without a set, template or data!");
+    }
+    vkUpdateDescriptorSetWithTemplate(context->GetDevice(), set, updateTemplate, data);
+}
 
+void VulkanDescriptorManager::PushDescriptorSet(VkCommandBuffer commandBuffer, VkDescriptorUpdateTemplate updateTemplate,
+    VkPipelineLayout pipelineLayout, uint32_t set, const void* data)
+{
+    PFN_vkCmdPushDescriptorSetWithTemplateKHR pushDescriptorSetWithTemplate = context->GetCmdPushDescriptorSetWithTemplate();
+    if (pushDescriptorSetWithTemplate == nullptr) {
+        throw std::runtime_error("Push descriptors are not supported on this device!");
+    }
+    if (updateTemplate == VK_NULL_HANDLE || data == nullptr) {
+        throw std::runtime_error("Cannot push a descriptor set without a template or data!");
+    }
+    pushDescriptorSetWithTemplate(commandBuffer, updateTemplate, pipelineLayout, set, data);
+}
 
+void VulkanDescriptorManager::CleanupPool() {
+    for (auto& [key, updateTemplate] : updateTemplates) {
+        vkDestroyDescriptorUpdateTemplate(context->GetDevice(), updateTemplate, nullptr);
+    }
+    updateTemplates.clear();
 
+    persistentAllocator.CleanupPools();
+    for (auto& allocator : frameAllocators) {
+        allocator->CleanupPools();
+    }
+}
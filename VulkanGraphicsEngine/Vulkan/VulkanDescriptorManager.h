@@ -1,27 +1,39 @@
 #ifndef VULKAN_DESCRIPTOR_MANAGER_H
 #define VULKAN_DESCRIPTOR_MANAGER_H
 #include "VulkanUtils.h"
+#include "VulkanDescriptorAllocator.h"
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
 struct Mesh;
 class VulkanContext;
 
 
-struct DescriptorBufferBinding
+// One entry of a descriptor update template: where in the packed data struct the
+// VkDescriptorBufferInfo / VkDescriptorImageInfo for a binding lives
+struct DescriptorTemplateEntry
 {
 	uint32_t binding;
-	VkBuffer buffer;
-	VkDeviceSize offset = 0;
-	VkDeviceSize range;
-
+	VkDescriptorType type;
+	size_t offset;             // offsetof the info in the data struct
+	uint32_t count = 1;        // consecutive array elements starting at arrayElement
+	uint32_t arrayElement = 0;
+	size_t stride = 0;         // distance between array elements, 0 for a tightly packed array
+
+	static DescriptorTemplateEntry UniformBuffer(uint32_t binding, size_t offset) {
+		return { binding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, offset };
+	}
+	static DescriptorTemplateEntry StorageBuffer(uint32_t binding, size_t offset) {
+		return { binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, offset };
+	}
+	static DescriptorTemplateEntry CombinedImageSampler(uint32_t binding, size_t offset) {
+		return { binding, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offset };
+	}
+	static DescriptorTemplateEntry StorageImage(uint32_t binding, size_t offset) {
+		return { binding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offset };
+	}
 };
 
-struct DescriptorImageBinding
-{
-	uint32_t binding;          
-	uint32_t arrayElement = 0; 
-	VkImageView imageView;
-	VkSampler sampler;
-	VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-};
 class VulkanDescriptorManager final
 {
 public:
@@ -31,18 +43,14 @@ public:
 
 	VulkanDescriptorManager(const VulkanDescriptorManager&) = delete;
 	VulkanDescriptorManager& operator=(const VulkanDescriptorManager&) = delete;
-	VulkanDescriptorManager(VulkanDescriptorManager&&) = default;
-	VulkanDescriptorManager& operator=(VulkanDescriptorManager&&) = default;
 
 	// --- Pool Management ---
-   // Creates the main descriptor pool. Configurable pool sizes & max sets.
-	void CreateDescriptorPool(
-		const std::vector<VkDescriptorPoolSize>& poolSizes,
-		uint32_t maxSets,
-		VkDescriptorPoolCreateFlags flags = 0 
-	);
+	// Sets up the growable allocators: one for long-lived sets and one per frame in flight
+	// for transient sets. Pools are chained on demand, there are no sizes to tune.
+	void Initialize();
 
-	VkDescriptorPool GetDescriptorPool() const { return descriptorPool; }
+	// Resets the transient pools of this frame slot. Call after its in-flight fence has signalled.
+	void BeginFrame(uint32_t frameIndex);
 
 	// --- Layout Management ---
  // Creates a layout based on provided bindings. Returns the handle.
@@ -51,25 +59,105 @@ public:
 		const std::vector<VkDescriptorSetLayoutBinding>& bindings
 	);
 
-	// --- Set Allocation & Updating ---
-	// Allocates multiple sets for a given layout and updates them using a callback.
-	// The callback provides the specific buffer/image bindings for each set index.
-	// Returns the allocated sets. Caller might need to free them if pool allows.
-	std::vector<VkDescriptorSet> AllocateAndWriteDescriptorSets(
-		VkDescriptorSetLayout layout, // The layout these sets will adhere to
-		uint32_t setCount,          // How many sets to create (e.g., MAX_FRAMES_IN_FLIGHT)
-		// Callback function: Takes set index (0 to setCount-1), returns bindings for THAT set
-		std::function<std::pair<std::vector<DescriptorBufferBinding>, std::vector<DescriptorImageBinding>>(uint32_t setIndex)> getBindingsForSet
+ // Returns a shared layout from the context's layout cache, identical binding lists yield the same handle.
+ // The cache owns the layout, do not destroy it.
+	VkDescriptorSetLayout GetOrCreateDescriptorSetLayout(
+		const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+		VkDescriptorSetLayoutCreateFlags flags = 0,
+		const std::vector<VkDescriptorBindingFlags>& bindingFlags = {}
+	);
+
+	// --- Update Templates ---
+	// Returns the update template for a layout and entries, creating it on first use. The entries
+	// describe a packed POD struct of VkDescriptorBufferInfo / VkDescriptorImageInfo members that
+	// later updates read from. The layout cache hands identical layouts out as one handle, so
+	// templates are keyed on the entries too and never shared between different data structs.
+	VkDescriptorUpdateTemplate GetOrCreateUpdateTemplate(
+		VkDescriptorSetLayout layout,
+		const std::vector<DescriptorTemplateEntry>& entries
+	);
+
+	// Same, for a layout created with VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR: the
+	// template writes straight into a command buffer (see PushDescriptorSet). pipelineLayout must
+	// be compatible with every layout it is later pushed with, at bindPoint.
+	VkDescriptorUpdateTemplate GetOrCreatePushDescriptorTemplate(
+		VkDescriptorSetLayout layout,
+		VkPipelineLayout pipelineLayout,
+		uint32_t set,
+		const std::vector<DescriptorTemplateEntry>& entries,
+		VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS
 	);
 
+	// --- Set Allocation & Updating ---
+	// Allocates long-lived sets for a layout, they live until CleanupPool
+	std::vector<VkDescriptorSet> AllocateDescriptorSets(VkDescriptorSetLayout layout, uint32_t setCount);
+
+	// Allocates a set that is only valid for the current frame; it is recycled when BeginFrame
+	// comes back to this frame slot. Nothing has to be freed.
+	VkDescriptorSet AllocateTransientDescriptorSet(VkDescriptorSetLayout layout);
+
+	// Writes every descriptor of a set from the packed data in one call, no allocations
+	void UpdateDescriptorSet(VkDescriptorSet set, VkDescriptorUpdateTemplate updateTemplate, const void* data);
+
+	template<typename T>
+	void UpdateDescriptorSet(VkDescriptorSet set, VkDescriptorUpdateTemplate updateTemplate, const T& data)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Descriptor template data must be a POD struct");
+		UpdateDescriptorSet(set, updateTemplate, static_cast<const void*>(&data));
+	}
+
+	// Records the descriptors of a push descriptor set into the command buffer (VK_KHR_push_descriptor).
+	// No set is allocated; the data is consumed at record time and may go out of scope afterwards.
+	void PushDescriptorSet(VkCommandBuffer commandBuffer, VkDescriptorUpdateTemplate updateTemplate,
+		VkPipelineLayout pipelineLayout, uint32_t set, const void* data);
+
+	template<typename T>
+	void PushDescriptorSet(VkCommandBuffer commandBuffer, VkDescriptorUpdateTemplate updateTemplate,
+		VkPipelineLayout pipelineLayout, uint32_t set, const T& data)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Descriptor template data must be a POD struct");
+		PushDescriptorSet(commandBuffer, updateTemplate, pipelineLayout, set, static_cast<const void*>(&data));
+	}
+
+	// Returns how many pools the allocators have chained so far
+	size_t GetPoolCount() const;
+
 	// --- Cleanup ---
+	// Destroys the pools (and with them every set) and the update templates
 	void CleanupPool();
 
 
 private:
 
 	VulkanContext* context;
-	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VulkanDescriptorAllocator persistentAllocator;
+	std::vector<std::unique_ptr<VulkanDescriptorAllocator>> frameAllocators;
+	uint32_t currentFrame = 0;
+
+	VkDescriptorUpdateTemplate CreateUpdateTemplate(VkDescriptorUpdateTemplateCreateInfo& templateInfo,
+		const std::vector<DescriptorTemplateEntry>& entries);
+
+	struct TemplateKey
+	{
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+		VkDescriptorUpdateTemplateType type = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+		// Push descriptor templates only, left zero for the others
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		uint32_t set = 0;
+		VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		std::vector<DescriptorTemplateEntry> entries;
+
+		bool operator==(const TemplateKey& other) const;
+	};
+
+	struct TemplateKeyHash
+	{
+		size_t operator()(const TemplateKey& key) const;
+	};
+
+	VkDescriptorUpdateTemplate GetOrCreateTemplate(const TemplateKey& key);
+
+	std::unordered_map<TemplateKey, VkDescriptorUpdateTemplate, TemplateKeyHash> updateTemplates;
 
 	};
 
@@ -0,0 +1,118 @@
+#include "VulkanDescriptorSetLayoutCache.h"
+#include "VulkanContext.h"
+#include <algorithm>
+#include <functional>
+
+bool VulkanDescriptorSetLayoutCache::LayoutKey::operator==(const LayoutKey& other) const
+{
+	if (flags != other.flags || bindings.size() != other.bindings.size() || bindingFlags != other.bindingFlags) {
+		return false;
+	}
+
+	for (size_t i = 0; i < bindings.size(); ++i)
+	{
+		const VkDescriptorSetLayoutBinding& a = bindings[i];
+		const VkDescriptorSetLayoutBinding& b = other.bindings[i];
+		if (a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount ||
+			a.stageFlags != b.stageFlags || a.pImmutableSamplers != b.pImmutableSamplers) {
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t VulkanDescriptorSetLayoutCache::LayoutKeyHash::operator()(const LayoutKey& key) const
+{
+	size_t seed = std::hash<uint32_t>{}(key.flags);
+	for (const VkDescriptorSetLayoutBinding& binding : key.bindings)
+	{
+		VulkanUtils::HashCombine(seed, std::hash<uint32_t>{}(binding.binding));
+		VulkanUtils::HashCombine(seed, std::hash<uint32_t>{}(static_cast<uint32_t>(binding.descriptorType)));
+		VulkanUtils::HashCombine(seed, std::hash<uint32_t>{}(binding.descriptorCount));
+		VulkanUtils::HashCombine(seed, std::hash<uint32_t>{}(binding.stageFlags));
+		VulkanUtils::HashCombine(seed, std::hash<const void*>{}(binding.pImmutableSamplers));
+	}
+	for (VkDescriptorBindingFlags bindingFlags : key.bindingFlags)
+	{
+		VulkanUtils::HashCombine(seed, std::hash<uint32_t>{}(bindingFlags));
+	}
+	return seed;
+}
+
+VkDescriptorSetLayout VulkanDescriptorSetLayoutCache::GetOrCreateLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+	VkDescriptorSetLayoutCreateFlags flags, const std::vector<VkDescriptorBindingFlags>& bindingFlags)
+{
+	if (!bindingFlags.empty() && bindingFlags.size() != bindings.size()) {
+		throw std::runtime_error("Descriptor binding flags must match the binding count!");
+	}
+
+	// Sort through an index list so the binding flags stay paired with their binding
+	std::vector<size_t> order(bindings.size());
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return bindings[a].binding < bindings[b].binding; });
+
+	LayoutKey key{ flags };
+	key.bindings.reserve(bindings.size());
+	for (size_t i : order)
+	{
+		key.bindings.push_back(bindings[i]);
+	}
+
+	// All-zero flags are the same layout as no flags
+	if (std::any_of(bindingFlags.begin(), bindingFlags.end(), [](VkDescriptorBindingFlags f) { return f != 0; }))
+	{
+		key.bindingFlags.reserve(bindingFlags.size());
+		for (size_t i : order)
+		{
+			key.bindingFlags.push_back(bindingFlags[i]);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it = layouts.find(key);
+	if (it != layouts.end()) {
+		return it->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.flags = flags;
+	layoutInfo.bindingCount = static_cast<uint32_t>(key.bindings.size());
+	layoutInfo.pBindings = key.bindings.empty() ? nullptr : key.bindings.data();
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	if (!key.bindingFlags.empty()) {
+		bindingFlagsInfo.bindingCount = static_cast<uint32_t>(key.bindingFlags.size());
+		bindingFlagsInfo.pBindingFlags = key.bindingFlags.data();
+		layoutInfo.pNext = &bindingFlagsInfo;
+	}
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	if (vkCreateDescriptorSetLayout(context->GetDevice(), &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor set layout!");
+	}
+
+	layouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+size_t VulkanDescriptorSetLayoutCache::GetLayoutCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return layouts.size();
+}
+
+void VulkanDescriptorSetLayoutCache::CleanupLayouts()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& [key, layout] : layouts)
+	{
+		vkDestroyDescriptorSetLayout(context->GetDevice(), layout, nullptr);
+	}
+	layouts.clear();
+}
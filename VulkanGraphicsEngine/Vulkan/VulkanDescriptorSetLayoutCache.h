@@ -0,0 +1,63 @@
+#ifndef VULKAN_DESCRIPTOR_SET_LAYOUT_CACHE_H
+#define VULKAN_DESCRIPTOR_SET_LAYOUT_CACHE_H
+
+#include "VulkanUtils.h"
+#include <mutex>
+#include <unordered_map>
+
+class VulkanContext;
+
+// Deduplicates descriptor set layouts: identical binding lists (in any order) map to one
+// VkDescriptorSetLayout that is shared between pipelines. The cache owns every layout it
+// hands out; they are destroyed together in CleanupLayouts. Safe to use from the pipeline
+// build worker threads.
+class VulkanDescriptorSetLayoutCache final
+{
+public:
+	explicit VulkanDescriptorSetLayoutCache(VulkanContext* context) : context(context) {}
+	~VulkanDescriptorSetLayoutCache() = default;
+
+	VulkanDescriptorSetLayoutCache(const VulkanDescriptorSetLayoutCache&) = delete;
+	VulkanDescriptorSetLayoutCache& operator=(const VulkanDescriptorSetLayoutCache&) = delete;
+
+	//**
+	// Returns the cached layout for these bindings, creating it on first use.
+	// An empty binding list is valid and yields an empty layout (used for gaps between sets).
+	// bindingFlags is either empty or parallel to bindings (partially bound, update after bind, ...).
+	//**
+	VkDescriptorSetLayout GetOrCreateLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+		VkDescriptorSetLayoutCreateFlags flags = 0,
+		const std::vector<VkDescriptorBindingFlags>& bindingFlags = {});
+
+	//**
+	// Returns how many unique layouts have been created
+	//**
+	size_t GetLayoutCount() const;
+
+	//**
+	// Destroys every cached layout
+	//**
+	void CleanupLayouts();
+
+private:
+	struct LayoutKey
+	{
+		VkDescriptorSetLayoutCreateFlags flags = 0;
+		std::vector<VkDescriptorSetLayoutBinding> bindings; // sorted by binding number
+		std::vector<VkDescriptorBindingFlags> bindingFlags; // parallel to bindings, empty when none are set
+
+		bool operator==(const LayoutKey& other) const;
+	};
+
+	struct LayoutKeyHash
+	{
+		size_t operator()(const LayoutKey& key) const;
+	};
+
+	VulkanContext* context;
+
+	mutable std::mutex mutex;
+	std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> layouts;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "VulkanGpuProfiler.h"
+#include "VulkanContext.h"
+#include <algorithm>
+
+void VulkanGpuProfiler::Initialize(uint32_t maxScopes)
+{
+	if (frames[0].pool != VK_NULL_HANDLE) {
+		throw std::runtime_error("GPU profiler already initialized. Call CleanupProfiler first.");
+	}
+
+	QueueFamilyIndices indices = VulkanUtils::FindQueueFamilies(context->GetPhysicalDevice(), context->GetSurface());
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(context->GetPhysicalDevice(), &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(context->GetPhysicalDevice(), &familyCount, families.data());
+
+	const uint32_t validBits = indices.graphicsFamily.has_value() ? families[indices.graphicsFamily.value()].timestampValidBits : 0;
+	supported = validBits > 0 && maxScopes > 0;
+	if (!supported) {
+		std::cout << "GPU timestamps are not supported on the graphics queue, pass timings are disabled" << std::endl;
+		return;
+	}
+
+	timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+	timestampPeriodNs = context->GetDeviceProperties().limits.timestampPeriod;
+	maxScopesPerFrame = maxScopes;
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = maxScopes * 2;
+
+	for (FrameQueries& frame : frames)
+	{
+		if (vkCreateQueryPool(context->GetDevice(), &poolInfo, nullptr, &frame.pool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create timestamp query pool!");
+		}
+		// Nothing is read from a pool before its first BeginFrame, which resets it on the GPU
+		frame.scopes.reserve(maxScopes);
+	}
+}
+
+void VulkanGpuProfiler::CollectResults(FrameQueries& frame)
+{
+	if (frame.scopes.empty()) {
+		return;
+	}
+
+	// Pairs of (value, availability); a scope whose queries are unavailable is skipped
+	const uint32_t queryCount = static_cast<uint32_t>(frame.scopes.size()) * 2;
+	std::vector<uint64_t> results(queryCount * 2);
+	vkGetQueryPoolResults(context->GetDevice(), frame.pool, 0, queryCount, results.size() * sizeof(uint64_t), results.data(),
+		2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+	for (size_t i = 0; i < frame.scopes.size(); ++i)
+	{
+		const uint64_t* begin = &results[i * 4];
+		const uint64_t* end = &results[i * 4 + 2];
+		if (begin[1] == 0 || end[1] == 0) {
+			continue;
+		}
+
+		const uint64_t ticks = ((end[0] & timestampMask) - (begin[0] & timestampMask)) & timestampMask;
+		const double ms = static_cast<double>(ticks) * timestampPeriodNs / 1.0e6;
+
+		ScopeTiming& timing = timings[frame.scopes[i]];
+		timing.lastMs = ms;
+		timing.totalMs += ms;
+		++timing.samples;
+	}
+	frame.scopes.clear();
+}
+
+void VulkanGpuProfiler::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	if (!supported) {
+		return;
+	}
+
+	// The caller waited on this slot's fence, its previous queries have completed
+	FrameQueries& frame = frames[frameIndex % MAX_FRAMES_IN_FLIGHT];
+	CollectResults(frame);
+	frame.openScope = UINT32_MAX;
+
+	vkCmdResetQueryPool(commandBuffer, frame.pool, 0, maxScopesPerFrame * 2);
+	currentFrame = &frame;
+}
+
+void VulkanGpuProfiler::BeginScope(VkCommandBuffer commandBuffer, const std::string& name)
+{
+	if (!supported || currentFrame == nullptr) {
+		return;
+	}
+	if (currentFrame->openScope != UINT32_MAX) {
+		throw std::runtime_error("GPU profiler scope '" + name + "' begins inside '" + currentFrame->scopes[currentFrame->openScope] + "'!");
+	}
+	if (currentFrame->scopes.size() >= maxScopesPerFrame) {
+		return;
+	}
+
+	currentFrame->openScope = static_cast<uint32_t>(currentFrame->scopes.size());
+	currentFrame->scopes.push_back(name);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, currentFrame->pool, currentFrame->openScope * 2);
+}
+
+void VulkanGpuProfiler::EndScope(VkCommandBuffer commandBuffer, const std::string& name)
+{
+	if (!supported || currentFrame == nullptr || currentFrame->openScope == UINT32_MAX) {
+		return;
+	}
+	if (currentFrame->scopes[currentFrame->openScope] != name) {
+		throw std::runtime_error("GPU profiler scope '" + name + "' ends while '" + currentFrame->scopes[currentFrame->openScope] + "' is open!");
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, currentFrame->pool, currentFrame->openScope * 2 + 1);
+	currentFrame->openScope = UINT32_MAX;
+}
+
+double VulkanGpuProfiler::GetLastMs(const std::string& name) const
+{
+	auto it = timings.find(name);
+	return it != timings.end() ? it->second.lastMs : -1.0;
+}
+
+double VulkanGpuProfiler::GetAverageMs(const std::string& name) const
+{
+	auto it = timings.find(name);
+	if (it == timings.end() || it->second.samples == 0) {
+		return -1.0;
+	}
+	return it->second.totalMs / it->second.samples;
+}
+
+void VulkanGpuProfiler::ResetStatistics()
+{
+	for (auto& [name, timing] : timings)
+	{
+		timing.totalMs = 0.0;
+		timing.samples = 0;
+	}
+}
+
+void VulkanGpuProfiler::CleanupProfiler()
+{
+	for (FrameQueries& frame : frames)
+	{
+		if (frame.pool != VK_NULL_HANDLE) {
+			vkDestroyQueryPool(context->GetDevice(), frame.pool, nullptr);
+			frame.pool = VK_NULL_HANDLE;
+		}
+		frame.scopes.clear();
+	}
+	currentFrame = nullptr;
+	timings.clear();
+}
@@ -0,0 +1,86 @@
+#ifndef VULKAN_GPU_PROFILER_H
+#define VULKAN_GPU_PROFILER_H
+
+#include "VulkanUtils.h"
+#include <string>
+#include <unordered_map>
+
+class VulkanContext;
+
+// GPU pass timings from timestamp queries. Every frame in flight has its own query pool; the
+// results of a frame slot are read back the next time that slot begins, after its fence was
+// waited on, so reading never stalls. Scopes are identified by name and may not nest.
+class VulkanGpuProfiler final
+{
+public:
+	explicit VulkanGpuProfiler(VulkanContext* context) : context(context) {}
+	~VulkanGpuProfiler() = default;
+
+	VulkanGpuProfiler(const VulkanGpuProfiler&) = delete;
+	VulkanGpuProfiler& operator=(const VulkanGpuProfiler&) = delete;
+
+	//**
+	// Creates one query pool per frame in flight with room for maxScopes scopes each.
+	// Does nothing when the graphics queue cannot write timestamps.
+	//**
+	void Initialize(uint32_t maxScopes = 32);
+
+	//**
+	// Collects the timings this frame slot recorded last time and resets its queries.
+	// Must be recorded before any scope of the frame and outside a rendering instance.
+	//**
+	void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	void BeginScope(VkCommandBuffer commandBuffer, const std::string& name);
+	void EndScope(VkCommandBuffer commandBuffer, const std::string& name);
+
+	//**
+	// Returns the latest GPU time of a scope in milliseconds, or a negative value if it has none yet
+	//**
+	double GetLastMs(const std::string& name) const;
+
+	//**
+	// Returns the mean GPU time of a scope since the last ResetStatistics, or a negative value
+	//**
+	double GetAverageMs(const std::string& name) const;
+
+	//**
+	// Drops the accumulated averages, e.g. when a benchmark switches to its next configuration
+	//**
+	void ResetStatistics();
+
+	bool IsSupported() const { return supported; }
+
+	void CleanupProfiler();
+
+private:
+	struct ScopeTiming
+	{
+		double lastMs = -1.0;
+		double totalMs = 0.0;
+		uint32_t samples = 0;
+	};
+
+	struct FrameQueries
+	{
+		VkQueryPool pool = VK_NULL_HANDLE;
+		std::vector<std::string> scopes;   // scope i owns queries 2i (begin) and 2i + 1 (end)
+		uint32_t openScope = UINT32_MAX;
+	};
+
+	void CollectResults(FrameQueries& frame);
+
+	VulkanContext* context;
+
+	bool supported = false;
+	uint32_t maxScopesPerFrame = 0;
+	double timestampPeriodNs = 1.0;
+	uint64_t timestampMask = ~0ull;
+
+	std::array<FrameQueries, MAX_FRAMES_IN_FLIGHT> frames;
+	FrameQueries* currentFrame = nullptr;
+
+	std::unordered_map<std::string, ScopeTiming> timings;
+};
+
+#endif
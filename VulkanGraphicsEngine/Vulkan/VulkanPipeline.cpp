@@ -2,21 +2,22 @@
 #include "VulkanContext.h"
 #include "fstream"
 #include "Scene.h"
+#include "ShaderReflection.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <thread>
 
 void VulkanPipeline::CleanupPipeline(VkPipeline pipeline, VkPipelineLayout pipelineLayout)
 {
     if (context)
     {
-        SavePipelineCache();
-
+        // The pipeline cache belongs to the context and is saved when the context is cleaned up
         if (pipelineLayout != VK_NULL_HANDLE) {
             vkDestroyPipelineLayout(context->GetDevice(), pipelineLayout, nullptr);
         }
 
-        if (pipelineCache != VK_NULL_HANDLE) {
-            vkDestroyPipelineCache(context->GetDevice(), pipelineCache, nullptr);
-        }
-
         if (pipeline != VK_NULL_HANDLE) {
             vkDestroyPipeline(context->GetDevice(), pipeline, nullptr);
         }
@@ -78,7 +79,7 @@ VulkanPipeline& VulkanPipeline::DefaultPipelineConfig(PipelineInfo& configInfo,
     configInfo.colorBlendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
     configInfo.colorBlendInfo.logicOpEnable = VK_FALSE;
     configInfo.colorBlendInfo.logicOp = VK_LOGIC_OP_COPY;
-    configInfo.colorBlendInfo.attachmentCount = colorAttachmentCount;  
+    configInfo.colorBlendInfo.attachmentCount = colorAttachmentCount;
     configInfo.colorBlendInfo.pAttachments = configInfo.colorBlendAttachments.data();  
     configInfo.colorBlendInfo.blendConstants[0] = 0.0f;
     configInfo.colorBlendInfo.blendConstants[1] = 0.0f;
@@ -114,145 +115,1390 @@ VulkanPipeline& VulkanPipeline::DefaultPipelineConfig(PipelineInfo& configInfo,
 
     // Dynamic rendering format configuration
     configInfo.colorAttachmentFormats = formats;
+    configInfo.colorAttachmentCount = colorAttachmentCount;
     configInfo.depthAttachmentFormat = VulkanUtils::FindDepthFormat(context->GetPhysicalDevice());
     configInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
 
     return *this;
 }
 
-VulkanPipeline& VulkanPipeline::CreatePipelineCache()
+VulkanPipeline& VulkanPipeline::BuildGraphicsPipelines(std::vector<GraphicsPipelineDesc>& pipelineDescs)
 {
-    // Try to load existing cache first
-    pipelineCache = LoadPipelineCache();
+    if (pipelineDescs.empty()) {
+        return *this;
+    }
 
-    if (pipelineCache == VK_NULL_HANDLE)
+    for (GraphicsPipelineDesc& desc : pipelineDescs)
     {
-        VkPipelineCacheCreateInfo cacheInfo{};
-        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-        cacheInfo.initialDataSize = 0;
-        cacheInfo.pInitialData = nullptr;
+        if (desc.config == nullptr || desc.pipeline == nullptr || desc.pipelineLayout == nullptr) {
+            throw std::runtime_error("Incomplete pipeline description: " + desc.name);
+        }
+        *desc.pipeline = VK_NULL_HANDLE;
+        *desc.pipelineLayout = VK_NULL_HANDLE;
+    }
+
+    const auto buildStart = std::chrono::steady_clock::now();
+
+    const unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t workerCount = std::min<size_t>(pipelineDescs.size(), hardwareThreads);
+
+    // Each worker compiles into its own cache seeded from the on-disk data, so the threads never
+    // contend on one cache; the results are merged back into the shared cache afterwards
+    VulkanPipelineCache& sharedCache = context->GetPipelineCache();
+    std::vector<VkPipelineCache> workerCaches(workerCount, VK_NULL_HANDLE);
+
+    std::vector<std::exception_ptr> errors(pipelineDescs.size());
+    std::vector<uint8_t> cacheHits(pipelineDescs.size(), 0); // not vector<bool>, workers write concurrently
+    std::atomic<size_t> nextDesc{ 0 };
+
+    auto worker = [&](size_t workerIndex) {
+        VkPipelineCache workerCache = VK_NULL_HANDLE;
+        try
+        {
+            workerCache = sharedCache.CreateWorkerCache();
+        }
+        catch (...)
+        {
+            // Not fatal, compile against the shared cache instead
+            workerCache = sharedCache.GetHandle();
+        }
+        if (workerCache != sharedCache.GetHandle()) {
+            workerCaches[workerIndex] = workerCache;
+        }
 
-        if (vkCreatePipelineCache(context->GetDevice(), &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+        for (size_t i = nextDesc++; i < pipelineDescs.size(); i = nextDesc++)
         {
-            throw std::runtime_error("failed to create pipeline cache!");
+            GraphicsPipelineDesc& desc = pipelineDescs[i];
+            const auto start = std::chrono::steady_clock::now();
+            try
+            {
+                bool cacheHit = false;
+                CreateGraphicsPipelineInternal(desc.vertShaderFilePath, desc.fragShaderFilePath, *desc.config, desc.descriptorSetLayoutOverride,
+                    *desc.pipeline, *desc.pipelineLayout, desc.pushConstantSize, workerCache, &cacheHit);
+                cacheHits[i] = cacheHit ? 1 : 0;
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+            desc.compileTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
         }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        workers.emplace_back(worker, i);
+    }
+    for (std::thread& thread : workers)
+    {
+        thread.join();
+    }
 
-        std::cout << "Created new pipeline cache." << std::endl;
+    sharedCache.MergeWorkerCaches(workerCaches);
+
+    const double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+    for (size_t i = 0; i < pipelineDescs.size(); ++i)
+    {
+        std::cout << "Pipeline '" << pipelineDescs[i].name << "' compiled in " << pipelineDescs[i].compileTimeMs << " ms"
+            << (cacheHits[i] ? " (cache hit)" : "") << std::endl;
     }
-    else
+    std::cout << "Built " << pipelineDescs.size() << " pipelines on " << workerCount << " threads in " << totalMs << " ms" << std::endl;
+
+    for (size_t i = 0; i < errors.size(); ++i)
     {
-        std::cout << "Loaded existing pipeline cache." << std::endl;
+        if (errors[i]) {
+            // Leave no half-built set behind: destroy whatever did succeed before rethrowing
+            for (GraphicsPipelineDesc& desc : pipelineDescs)
+            {
+                if (*desc.pipeline != VK_NULL_HANDLE) {
+                    vkDestroyPipeline(context->GetDevice(), *desc.pipeline, nullptr);
+                    *desc.pipeline = VK_NULL_HANDLE;
+                }
+                if (*desc.pipelineLayout != VK_NULL_HANDLE) {
+                    vkDestroyPipelineLayout(context->GetDevice(), *desc.pipelineLayout, nullptr);
+                    *desc.pipelineLayout = VK_NULL_HANDLE;
+                }
+            }
+            std::rethrow_exception(errors[i]);
+        }
     }
 
     return *this;
 }
 
-void VulkanPipeline::SavePipelineCache()
+VkShaderModule VulkanPipeline::CreateShaderModule(VkDevice device, const std::vector<char>& code)
+{
+    if (code.empty()) {
+        throw std::runtime_error("Shader code is empty!");
+    }
+
+    // Ensure code size is properly aligned for uint32_t
+    if (code.size() % sizeof(uint32_t) != 0) {
+        throw std::runtime_error("Shader code size is not properly aligned!");
+    }
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader module!");
+    }
+
+    return shaderModule;
+}
+
+VulkanPipeline::ShaderStages::~ShaderStages()
+{
+    for (VkShaderModule module : modules)
+    {
+        if (module != VK_NULL_HANDLE) {
+            vkDestroyShaderModule(device, module, nullptr);
+        }
+    }
+}
+
+VulkanPipeline::ReflectedShaders VulkanPipeline::ReflectShaders(
+    const std::string& vertShaderFilePath,
+    const std::string& fragShaderFilePath,
+    PipelineInfo& pipelineConfigInfo,
+    VkDescriptorSetLayout descriptorSetLayoutOverride,
+    uint32_t pushConstantSize)
+{
+    // Validate inputs
+    if (vertShaderFilePath.empty() || fragShaderFilePath.empty()) {
+        throw std::runtime_error("Shader file paths cannot be empty!");
+    }
+
+    ReflectedShaders shaders{};
+
+    // Embedded SPIR-V or, with runtime compilation, the latest compile of the GLSL source
+    shaders.vertCode = context->GetShaderCompiler().LoadSpirv(vertShaderFilePath);
+    shaders.fragCode = context->GetShaderCompiler().LoadSpirv(fragShaderFilePath);
+
+    // --- Reflection: set layouts, push constants and vertex inputs come from the shaders ---
+    ShaderReflection reflection;
+    reflection.AddStage(shaders.vertCode);
+    reflection.AddStage(shaders.fragCode);
+
+    FillReflectedLayouts(reflection, pipelineConfigInfo, descriptorSetLayoutOverride, pushConstantSize,
+        vertShaderFilePath + " / " + fragShaderFilePath);
+
+    // Only feed the attributes the vertex shader actually reads, and fail loudly if it reads one we don't provide
+    for (const ShaderVertexInput& input : reflection.GetVertexInputs())
+    {
+        auto attribute = std::find_if(pipelineConfigInfo.attributeDescriptions.begin(), pipelineConfigInfo.attributeDescriptions.end(),
+            [&](const VkVertexInputAttributeDescription& a) { return a.location == input.location; });
+
+        if (attribute == pipelineConfigInfo.attributeDescriptions.end()) {
+            throw std::runtime_error(vertShaderFilePath + " reads vertex input location " + std::to_string(input.location) +
+                " which the pipeline config does not provide!");
+        }
+        shaders.attributeDescriptions.push_back(*attribute);
+    }
+
+    if (!shaders.attributeDescriptions.empty()) {
+        shaders.bindingDescriptions = pipelineConfigInfo.bindingDescriptions;
+    }
+
+    return shaders;
+}
+
+void VulkanPipeline::FillReflectedLayouts(const ShaderReflection& reflection, PipelineInfo& pipelineConfigInfo,
+    VkDescriptorSetLayout descriptorSetLayoutOverride, uint32_t pushConstantSize, const std::string& shaderNames)
 {
-    if (pipelineCache == VK_NULL_HANDLE) {
-        std::cerr << "Pipeline cache is NULL, skipping save." << std::endl;
-        return;
+    VulkanDescriptorSetLayoutCache& layoutCache = context->GetDescriptorSetLayoutCache();
+    const auto& reflectedSets = reflection.GetDescriptorSets();
+
+    pipelineConfigInfo.descriptorSetLayouts.assign(reflection.GetSetLayoutCount(), VK_NULL_HANDLE);
+    for (uint32_t set = 0; set < reflection.GetSetLayoutCount(); ++set)
+    {
+        auto it = reflectedSets.find(set);
+        VkDescriptorSetLayoutCreateFlags layoutFlags = reflection.GetSetLayoutFlags(set);
+        if (set == 0 && pipelineConfigInfo.pushDescriptorSet) {
+            layoutFlags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+        }
+        pipelineConfigInfo.descriptorSetLayouts[set] = layoutCache.GetOrCreateLayout(
+            it != reflectedSets.end() ? it->second : std::vector<VkDescriptorSetLayoutBinding>{},
+            layoutFlags, reflection.GetBindingFlags(set));
     }
 
-    // Get cache size
-    size_t cacheSize = 0;
-    VkResult result = vkGetPipelineCacheData(context->GetDevice(), pipelineCache, &cacheSize, nullptr);
+    if (descriptorSetLayoutOverride != VK_NULL_HANDLE) {
+        if (pipelineConfigInfo.descriptorSetLayouts.empty()) {
+            pipelineConfigInfo.descriptorSetLayouts.resize(1);
+        }
+        pipelineConfigInfo.descriptorSetLayouts[0] = descriptorSetLayoutOverride;
+    }
 
-    if (result != VK_SUCCESS || cacheSize == 0) {
-        std::cerr << "Failed to get pipeline cache data or cache is empty." << std::endl;
-        return;
+    pipelineConfigInfo.pushConstantRanges = reflection.GetPushConstantRanges();
+    if (pushConstantSize != 0) {
+        const uint32_t reflectedEnd = pipelineConfigInfo.pushConstantRanges.empty() ? 0 :
+            pipelineConfigInfo.pushConstantRanges[0].offset + pipelineConfigInfo.pushConstantRanges[0].size;
+        if (pushConstantSize > reflectedEnd) {
+            throw std::runtime_error("Push constant struct (" + std::to_string(pushConstantSize) + " bytes) is larger than the block declared in " +
+                shaderNames + " (" + std::to_string(reflectedEnd) + " bytes)!");
+        }
     }
+}
 
-    // Allocate buffer and retrieve cache data
-    std::vector<uint8_t> cacheData(cacheSize);
-    result = vkGetPipelineCacheData(context->GetDevice(), pipelineCache, &cacheSize, cacheData.data());
+void VulkanPipeline::CreateShaderStages(const ReflectedShaders& shaders, const PipelineInfo& pipelineConfigInfo, ShaderStages& stages)
+{
+    stages.device = context->GetDevice();
+
+    const std::array<const std::vector<char>*, 2> code = { &shaders.vertCode, &shaders.fragCode };
+    const std::array<VkShaderStageFlagBits, 2> stageBits = { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT };
+
+    for (size_t i = 0; i < stageBits.size(); ++i)
+    {
+        stages.modules[i] = CreateShaderModule(stages.device, *code[i]);
+
+        // Specialization constants for this stage; the vectors live in `stages` until the pipeline is created
+        for (const SpecializationConstant& constant : pipelineConfigInfo.specializationConstants)
+        {
+            if (constant.stages & stageBits[i]) {
+                stages.specEntries[i].push_back({ constant.constantID, static_cast<uint32_t>(stages.specData[i].size() * sizeof(uint32_t)), sizeof(uint32_t) });
+                stages.specData[i].push_back(constant.value);
+            }
+        }
+
+        stages.specInfos[i].mapEntryCount = static_cast<uint32_t>(stages.specEntries[i].size());
+        stages.specInfos[i].pMapEntries = stages.specEntries[i].data();
+        stages.specInfos[i].dataSize = stages.specData[i].size() * sizeof(uint32_t);
+        stages.specInfos[i].pData = stages.specData[i].data();
+
+        stages.stages[i].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stages.stages[i].stage = stageBits[i];
+        stages.stages[i].module = stages.modules[i];
+        stages.stages[i].pName = "main";
+        stages.stages[i].pSpecializationInfo = stages.specEntries[i].empty() ? nullptr : &stages.specInfos[i];
+    }
+}
+
+VkPipelineLayout VulkanPipeline::CreatePipelineLayout(const PipelineInfo& pipelineConfigInfo)
+{
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(pipelineConfigInfo.descriptorSetLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = pipelineConfigInfo.descriptorSetLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pipelineConfigInfo.pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pipelineConfigInfo.pushConstantRanges.data();
+
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    if (vkCreatePipelineLayout(context->GetDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+    return pipelineLayout;
+}
+
+void VulkanPipeline::CreateGraphicsPipelineInternal(
+    const std::string& vertShaderFilePath,
+    const std::string& fragShaderFilePath,
+    PipelineInfo& pipelineConfigInfo,
+    VkDescriptorSetLayout descriptorSetLayoutOverride,
+    VkPipeline& pipeline,
+    VkPipelineLayout& pipelineLayout,
+    uint32_t pushConstantSize,
+    VkPipelineCache cache,
+    bool* cacheHit)
+{
+    const ReflectedShaders shaders = ReflectShaders(vertShaderFilePath, fragShaderFilePath, pipelineConfigInfo,
+        descriptorSetLayoutOverride, pushConstantSize);
+
+    // Shader modules are destroyed when `stages` goes out of scope
+    ShaderStages stages;
+    CreateShaderStages(shaders, pipelineConfigInfo, stages);
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(shaders.bindingDescriptions.size());
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(shaders.attributeDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = shaders.bindingDescriptions.data();
+    vertexInputInfo.pVertexAttributeDescriptions = shaders.attributeDescriptions.data();
+
+    pipelineLayout = CreatePipelineLayout(pipelineConfigInfo);
+    pipelineConfigInfo.pipelineLayout = pipelineLayout;
+
+    // Dynamic rendering setup
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = static_cast<uint32_t>(pipelineConfigInfo.colorAttachmentFormats.size());
+    renderingInfo.pColorAttachmentFormats = pipelineConfigInfo.colorAttachmentFormats.data();
+    renderingInfo.depthAttachmentFormat = pipelineConfigInfo.depthAttachmentFormat;
+    renderingInfo.stencilAttachmentFormat = pipelineConfigInfo.stencilAttachmentFormat;
+    renderingInfo.viewMask = 0;
+    renderingInfo.pNext = nullptr;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = static_cast<uint32_t>(stages.stages.size());
+    pipelineInfo.pStages = stages.stages.data();
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &pipelineConfigInfo.inputAssemblyInfo;
+    pipelineInfo.pViewportState = &pipelineConfigInfo.viewportInfo;
+    pipelineInfo.pRasterizationState = &pipelineConfigInfo.rasterizationInfo;
+    pipelineInfo.pMultisampleState = &pipelineConfigInfo.multisampleInfo;
+    pipelineInfo.pColorBlendState = &pipelineConfigInfo.colorBlendInfo;
+    pipelineInfo.pDepthStencilState = &pipelineConfigInfo.depthStencilInfo;
+    pipelineInfo.pDynamicState = &pipelineConfigInfo.dynamicStateInfo;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.renderPass = VK_NULL_HANDLE; // Using dynamic rendering
+    pipelineInfo.subpass = 0;
+    pipelineInfo.pNext = &renderingInfo;
+
+    // Creation feedback (core in 1.3) tells whether the driver found the pipeline in the cache
+    VkPipelineCreationFeedback pipelineFeedback{};
+    VkPipelineCreationFeedbackCreateInfo feedbackInfo{};
+    feedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO;
+    feedbackInfo.pPipelineCreationFeedback = &pipelineFeedback;
+    feedbackInfo.pipelineStageCreationFeedbackCount = 0;
+    feedbackInfo.pPipelineStageCreationFeedbacks = nullptr;
+    renderingInfo.pNext = &feedbackInfo;
+
+    VkResult result = VK_SUCCESS;
+    {
+        // Worker caches are never merged into while in use, the lock only matters for the shared one
+        auto cacheLock = context->GetPipelineCache().LockShared();
+        result = vkCreateGraphicsPipelines(context->GetDevice(), cache, 1, &pipelineInfo, nullptr, &pipeline);
+    }
+
+    if (cacheHit != nullptr) {
+        *cacheHit = (pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) &&
+            (pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT);
+    }
 
     if (result != VK_SUCCESS) {
-        std::cerr << "Failed to retrieve pipeline cache data." << std::endl;
-        return;
+        // Clean up pipeline layout on failure
+        vkDestroyPipelineLayout(context->GetDevice(), pipelineLayout, nullptr);
+        pipelineLayout = VK_NULL_HANDLE;
+        pipeline = VK_NULL_HANDLE;
+        throw std::runtime_error("failed to create graphics pipeline!");
     }
+}
 
-    // Save to file with error handling
-    std::ofstream cacheFile("pipeline_cache.bin", std::ios::binary);
-    if (!cacheFile.is_open()) {
-        std::cerr << "Failed to open pipeline cache file for writing." << std::endl;
-        return;
+void VulkanPipeline::CreateComputePipelineInternal(const ComputePipelineKey& key, CachedPipeline& entry)
+{
+    if (key.shaderFilePath.empty()) {
+        throw std::runtime_error("Compute shader file path cannot be empty!");
     }
 
-    cacheFile.write(reinterpret_cast<const char*>(cacheData.data()), cacheSize);
+    const std::vector<char> code = context->GetShaderCompiler().LoadSpirv(key.shaderFilePath);
 
-    if (!cacheFile.good()) {
-        std::cerr << "Error occurred while writing pipeline cache file." << std::endl;
+    ShaderReflection reflection;
+    reflection.AddStage(code);
+    if (reflection.GetStages() != VK_SHADER_STAGE_COMPUTE_BIT) {
+        throw std::runtime_error(key.shaderFilePath + " is not a compute shader!");
     }
-    else {
-        std::cout << "Pipeline cache saved successfully (" << cacheSize << " bytes)." << std::endl;
+
+    PipelineInfo configInfo{};
+    configInfo.pushDescriptorSet = key.pushDescriptorSet;
+    FillReflectedLayouts(reflection, configInfo, VK_NULL_HANDLE, key.pushConstantSize, key.shaderFilePath);
+
+    std::vector<VkSpecializationMapEntry> specEntries;
+    std::vector<uint32_t> specData;
+    for (const SpecializationConstant& constant : key.specializationConstants)
+    {
+        specEntries.push_back({ constant.constantID, static_cast<uint32_t>(specData.size() * sizeof(uint32_t)), sizeof(uint32_t) });
+        specData.push_back(constant.value);
+    }
+
+    VkSpecializationInfo specInfo{};
+    specInfo.mapEntryCount = static_cast<uint32_t>(specEntries.size());
+    specInfo.pMapEntries = specEntries.data();
+    specInfo.dataSize = specData.size() * sizeof(uint32_t);
+    specInfo.pData = specData.data();
+
+    VkShaderModule module = CreateShaderModule(context->GetDevice(), code);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = module;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo = specEntries.empty() ? nullptr : &specInfo;
+
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    try {
+        pipelineLayout = CreatePipelineLayout(configInfo);
+    }
+    catch (...) {
+        vkDestroyShaderModule(context->GetDevice(), module, nullptr);
+        throw;
+    }
+    pipelineInfo.layout = pipelineLayout;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult result = VK_SUCCESS;
+    {
+        auto cacheLock = context->GetPipelineCache().LockShared();
+        result = vkCreateComputePipelines(context->GetDevice(), context->GetPipelineCache().GetHandle(), 1, &pipelineInfo, nullptr, &pipeline);
+    }
+    vkDestroyShaderModule(context->GetDevice(), module, nullptr);
+
+    if (result != VK_SUCCESS) {
+        vkDestroyPipelineLayout(context->GetDevice(), pipelineLayout, nullptr);
+        throw std::runtime_error("failed to create compute pipeline " + key.shaderFilePath + "!");
     }
 
-    cacheFile.close();
+    entry.pipeline = pipeline;
+    entry.layout = pipelineLayout;
+    entry.setLayouts = configInfo.descriptorSetLayouts;
+    entry.pushConstantRanges = configInfo.pushConstantRanges;
 }
 
-VkPipelineCache VulkanPipeline::LoadPipelineCache()
+GraphicsPipelineKey VulkanPipeline::MakeLibraryKey(const GraphicsPipelineKey& key, PipelineLibraryPart part)
 {
-    std::ifstream cacheFile("pipeline_cache.bin", std::ios::binary | std::ios::ate);
-    if (!cacheFile.is_open()) {
-        return VK_NULL_HANDLE; // File doesn't exist, return null handle
+    // Only the fields that feed a part go into its key, so e.g. a new render target format
+    // reuses the compiled shader parts and only needs a new fragment output library
+    GraphicsPipelineKey libraryKey{};
+    auto copyConstants = [&](VkShaderStageFlags stage) {
+        for (const SpecializationConstant& constant : key.specializationConstants)
+        {
+            if (constant.stages & stage) {
+                libraryKey.specializationConstants.push_back(constant);
+            }
+        }
+        };
+
+    switch (part)
+    {
+    case PipelineLibraryPart::VertexInput:
+        // The attributes are filtered by what the vertex shader reads
+        libraryKey.vertShaderFilePath = key.vertShaderFilePath;
+        libraryKey.vertexLayout = key.vertexLayout;
+        libraryKey.topology = key.topology;
+        break;
+    case PipelineLibraryPart::PreRasterization:
+        // Both shaders: the layout is reflected from the pair
+        libraryKey.SetShaders(key.vertShaderFilePath, key.fragShaderFilePath);
+        libraryKey.pushConstantSize = key.pushConstantSize;
+        libraryKey.polygonMode = key.polygonMode;
+        libraryKey.cullMode = key.cullMode;
+        libraryKey.frontFace = key.frontFace;
+        libraryKey.pushDescriptorSet = key.pushDescriptorSet;
+        copyConstants(VK_SHADER_STAGE_VERTEX_BIT);
+        break;
+    case PipelineLibraryPart::FragmentShader:
+        libraryKey.SetShaders(key.vertShaderFilePath, key.fragShaderFilePath);
+        libraryKey.pushConstantSize = key.pushConstantSize;
+        libraryKey.samples = key.samples;
+        libraryKey.sampleShading = key.sampleShading;
+        libraryKey.depthTest = key.depthTest;
+        libraryKey.depthWrite = key.depthWrite;
+        libraryKey.depthCompareOp = key.depthCompareOp;
+        libraryKey.depthAttachmentFormat = key.depthAttachmentFormat;
+        libraryKey.stencilAttachmentFormat = key.stencilAttachmentFormat;
+        libraryKey.pushDescriptorSet = key.pushDescriptorSet;
+        copyConstants(VK_SHADER_STAGE_FRAGMENT_BIT);
+        break;
+    case PipelineLibraryPart::FragmentOutput:
+        libraryKey.colorAttachmentCount = key.colorAttachmentCount;
+        libraryKey.colorAttachmentFormats = key.colorAttachmentFormats;
+        libraryKey.depthAttachmentFormat = key.depthAttachmentFormat;
+        libraryKey.stencilAttachmentFormat = key.stencilAttachmentFormat;
+        libraryKey.samples = key.samples;
+        libraryKey.sampleShading = key.sampleShading;
+        libraryKey.blendMode = key.blendMode;
+        break;
+    default:
+        break;
     }
+    return libraryKey;
+}
+
+void VulkanPipeline::CreatePipelineLibrary(const GraphicsPipelineKey& key, PipelineLibraryPart part, PipelineLibrary& library)
+{
+    PipelineInfo configInfo{};
+    FillPipelineInfo(key, configInfo);
+
+    static constexpr VkGraphicsPipelineLibraryFlagsEXT PART_FLAGS[] = {
+        VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT,
+    };
+
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = static_cast<uint32_t>(configInfo.colorAttachmentFormats.size());
+    renderingInfo.pColorAttachmentFormats = configInfo.colorAttachmentFormats.data();
+    renderingInfo.depthAttachmentFormat = configInfo.depthAttachmentFormat;
+    renderingInfo.stencilAttachmentFormat = configInfo.stencilAttachmentFormat;
+
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+    libraryInfo.flags = PART_FLAGS[static_cast<size_t>(part)];
+    libraryInfo.pNext = &renderingInfo;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = &libraryInfo;
+    // Keep what the driver needs to redo the link with optimization in the background
+    pipelineInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+
+    ReflectedShaders shaders{};
+    ShaderStages stages;
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-    size_t cacheSize = static_cast<size_t>(cacheFile.tellg());
-    if (cacheSize == 0) {
-        cacheFile.close();
-        return VK_NULL_HANDLE;
+    if (part != PipelineLibraryPart::FragmentOutput) {
+        shaders = ReflectShaders(key.vertShaderFilePath, key.fragShaderFilePath, configInfo, VK_NULL_HANDLE, key.pushConstantSize);
     }
 
-    cacheFile.seekg(0, std::ios::beg);
+    switch (part)
+    {
+    case PipelineLibraryPart::VertexInput:
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(shaders.bindingDescriptions.size());
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(shaders.attributeDescriptions.size());
+        vertexInputInfo.pVertexBindingDescriptions = shaders.bindingDescriptions.data();
+        vertexInputInfo.pVertexAttributeDescriptions = shaders.attributeDescriptions.data();
+        pipelineInfo.pVertexInputState = &vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
+        break;
+    case PipelineLibraryPart::PreRasterization:
+    case PipelineLibraryPart::FragmentShader:
+    {
+        CreateShaderStages(shaders, configInfo, stages);
+        const bool preRasterization = part == PipelineLibraryPart::PreRasterization;
+        pipelineInfo.stageCount = 1;
+        pipelineInfo.pStages = preRasterization ? &stages.stages[0] : &stages.stages[1];
 
-    std::vector<uint8_t> cacheData(cacheSize);
-    cacheFile.read(reinterpret_cast<char*>(cacheData.data()), cacheSize);
+        library.layout = CreatePipelineLayout(configInfo);
+        pipelineInfo.layout = library.layout;
 
-    if (!cacheFile.good()) {
-        std::cerr << "Error reading pipeline cache file." << std::endl;
-        cacheFile.close();
-        return VK_NULL_HANDLE;
+        if (preRasterization) {
+            pipelineInfo.pViewportState = &configInfo.viewportInfo;
+            pipelineInfo.pRasterizationState = &configInfo.rasterizationInfo;
+            pipelineInfo.pDynamicState = &configInfo.dynamicStateInfo; // viewport and scissor
+        }
+        else {
+            pipelineInfo.pMultisampleState = &configInfo.multisampleInfo;
+            pipelineInfo.pDepthStencilState = &configInfo.depthStencilInfo;
+        }
+        break;
+    }
+    case PipelineLibraryPart::FragmentOutput:
+        pipelineInfo.pMultisampleState = &configInfo.multisampleInfo;
+        pipelineInfo.pColorBlendState = &configInfo.colorBlendInfo;
+        break;
+    default:
+        break;
     }
 
-    cacheFile.close();
+    VkResult result = VK_SUCCESS;
+    {
+        auto cacheLock = context->GetPipelineCache().LockShared();
+        result = vkCreateGraphicsPipelines(context->GetDevice(), context->GetPipelineCache().GetHandle(), 1, &pipelineInfo, nullptr, &library.pipeline);
+    }
+    if (result != VK_SUCCESS) {
+        if (library.layout != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(context->GetDevice(), library.layout, nullptr);
+            library.layout = VK_NULL_HANDLE;
+        }
+        library.pipeline = VK_NULL_HANDLE;
+        throw std::runtime_error("failed to create graphics pipeline library!");
+    }
+}
 
-    VkPipelineCacheCreateInfo cacheInfo{};
-    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-    cacheInfo.initialDataSize = cacheSize;
-    cacheInfo.pInitialData = cacheData.data();
+std::array<VkPipeline, VulkanPipeline::PIPELINE_LIBRARY_PART_COUNT> VulkanPipeline::GetOrCreateLibraries(const GraphicsPipelineKey& key)
+{
+    std::lock_guard<std::mutex> lock(libraryMutex);
 
-    VkPipelineCache loadedCache;
-    VkResult result = vkCreatePipelineCache(context->GetDevice(), &cacheInfo, nullptr, &loadedCache);
+    std::array<VkPipeline, PIPELINE_LIBRARY_PART_COUNT> libraries{};
+    for (size_t i = 0; i < PIPELINE_LIBRARY_PART_COUNT; ++i)
+    {
+        const PipelineLibraryPart part = static_cast<PipelineLibraryPart>(i);
+        GraphicsPipelineKey libraryKey = MakeLibraryKey(key, part);
 
+        auto it = libraryCache[i].find(libraryKey);
+        if (it == libraryCache[i].end()) {
+            PipelineLibrary library{};
+            CreatePipelineLibrary(key, part, library);
+            it = libraryCache[i].emplace(std::move(libraryKey), library).first;
+        }
+        libraries[i] = it->second.pipeline;
+    }
+    return libraries;
+}
+
+VkPipeline VulkanPipeline::LinkPipelineLibraries(const std::array<VkPipeline, PIPELINE_LIBRARY_PART_COUNT>& libraries,
+    VkPipelineLayout pipelineLayout, bool optimize)
+{
+    VkPipelineLibraryCreateInfoKHR linkInfo{};
+    linkInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    linkInfo.libraryCount = static_cast<uint32_t>(libraries.size());
+    linkInfo.pLibraries = libraries.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = &linkInfo;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult result = VK_SUCCESS;
+    {
+        auto cacheLock = context->GetPipelineCache().LockShared();
+        result = vkCreateGraphicsPipelines(context->GetDevice(), context->GetPipelineCache().GetHandle(), 1, &pipelineInfo, nullptr, &pipeline);
+    }
     if (result != VK_SUCCESS) {
-        std::cerr << "Failed to create pipeline cache from loaded data. Creating new cache." << std::endl;
-        return VK_NULL_HANDLE;
+        throw std::runtime_error("failed to link graphics pipeline libraries!");
     }
+    return pipeline;
+}
 
-    return loadedCache;
+GraphicsPipelineKey& GraphicsPipelineKey::SetShaders(const std::string& vertPath, const std::string& fragPath)
+{
+    vertShaderFilePath = vertPath;
+    fragShaderFilePath = fragPath;
+    return *this;
 }
 
-VkShaderModule VulkanPipeline::CreateShaderModule(VkDevice device, const std::vector<char>& code)
+GraphicsPipelineKey& GraphicsPipelineKey::SetColorFormats(const std::vector<VkFormat>& formats)
 {
-    if (code.empty()) {
-        throw std::runtime_error("Shader code is empty!");
+    if (formats.size() > MAX_COLOR_ATTACHMENTS) {
+        throw std::runtime_error("Too many color attachments for a pipeline key!");
     }
 
-    // Ensure code size is properly aligned for uint32_t
-    if (code.size() % sizeof(uint32_t) != 0) {
-        throw std::runtime_error("Shader code size is not properly aligned!");
+    colorAttachmentFormats.fill(VK_FORMAT_UNDEFINED);
+    std::copy(formats.begin(), formats.end(), colorAttachmentFormats.begin());
+    colorAttachmentCount = static_cast<uint32_t>(formats.size());
+    return *this;
+}
+
+GraphicsPipelineKey& GraphicsPipelineKey::SetSpecialization(VkShaderStageFlags stages, uint32_t constantID, uint32_t value)
+{
+    // Kept sorted so keys that set the same constants in a different order still compare equal
+    auto it = std::lower_bound(specializationConstants.begin(), specializationConstants.end(), std::make_pair(constantID, stages),
+        [](const SpecializationConstant& c, const std::pair<uint32_t, VkShaderStageFlags>& id) {
+            return std::make_pair(c.constantID, c.stages) < id;
+        });
+
+    if (it != specializationConstants.end() && it->constantID == constantID && it->stages == stages) {
+        it->value = value;
+    }
+    else {
+        specializationConstants.insert(it, { stages, constantID, value });
     }
+    return *this;
+}
 
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+bool GraphicsPipelineKey::operator==(const GraphicsPipelineKey& other) const
+{
+    return vertShaderFilePath == other.vertShaderFilePath &&
+        fragShaderFilePath == other.fragShaderFilePath &&
+        vertexLayout == other.vertexLayout &&
+        colorAttachmentCount == other.colorAttachmentCount &&
+        std::equal(colorAttachmentFormats.begin(), colorAttachmentFormats.begin() + colorAttachmentCount, other.colorAttachmentFormats.begin()) &&
+        depthAttachmentFormat == other.depthAttachmentFormat &&
+        stencilAttachmentFormat == other.stencilAttachmentFormat &&
+        samples == other.samples &&
+        sampleShading == other.sampleShading &&
+        topology == other.topology &&
+        polygonMode == other.polygonMode &&
+        cullMode == other.cullMode &&
+        frontFace == other.frontFace &&
+        depthTest == other.depthTest &&
+        depthWrite == other.depthWrite &&
+        depthCompareOp == other.depthCompareOp &&
+        blendMode == other.blendMode &&
+        pushConstantSize == other.pushConstantSize &&
+        pushDescriptorSet == other.pushDescriptorSet &&
+        specializationConstants == other.specializationConstants;
+}
 
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create shader module!");
+size_t GraphicsPipelineKey::Hash() const
+{
+    size_t seed = 0;
+    VulkanUtils::HashCombine(seed, std::hash<std::string>{}(vertShaderFilePath));
+    VulkanUtils::HashCombine(seed, std::hash<std::string>{}(fragShaderFilePath));
+    VulkanUtils::HashCombine(seed, static_cast<size_t>(vertexLayout));
+    VulkanUtils::HashCombine(seed, colorAttachmentCount);
+    for (uint32_t i = 0; i < colorAttachmentCount; ++i)
+    {
+        VulkanUtils::HashCombine(seed, static_cast<size_t>(colorAttachmentFormats[i]));
+    }
+    VulkanUtils::HashCombine(seed, static_cast<size_t>(depthAttachmentFormat));
+    VulkanUtils::HashCombine(seed, static_cast<size_t>(stencilAttachmentFormat));
+    VulkanUtils::HashCombine(seed, static_cast<size_t>(samples));
+    VulkanUtils::HashCombine(seed, static_cast<size_t>(topology));
+    VulkanUtils::HashCombine(seed, static_cast<size_t>(polygonMode));
+    VulkanUtils::HashCombine(seed, static_cast<size_t>(cullMode));
+    VulkanUtils::HashCombine(seed, static_cast<size_t>(frontFace));
+    VulkanUtils::HashCombine(seed, static_cast<size_t>(depthCompareOp));
+    VulkanUtils::HashCombine(seed, static_cast<size_t>(blendMode));
+    VulkanUtils::HashCombine(seed, (sampleShading ? 1u : 0u) | (depthTest ? 2u : 0u) | (depthWrite ? 4u : 0u) | (pushDescriptorSet ? 8u : 0u));
+    VulkanUtils::HashCombine(seed, pushConstantSize);
+    for (const SpecializationConstant& constant : specializationConstants)
+    {
+        VulkanUtils::HashCombine(seed, constant.stages);
+        VulkanUtils::HashCombine(seed, constant.constantID);
+        VulkanUtils::HashCombine(seed, constant.value);
+    }
+    return seed;
+}
+
+ComputePipelineKey& ComputePipelineKey::SetShader(const std::string& path)
+{
+    shaderFilePath = path;
+    return *this;
+}
+
+ComputePipelineKey& ComputePipelineKey::SetSpecialization(uint32_t constantID, uint32_t value)
+{
+    auto it = std::lower_bound(specializationConstants.begin(), specializationConstants.end(), constantID,
+        [](const SpecializationConstant& c, uint32_t id) { return c.constantID < id; });
+
+    if (it != specializationConstants.end() && it->constantID == constantID) {
+        it->value = value;
+    }
+    else {
+        specializationConstants.insert(it, { VK_SHADER_STAGE_COMPUTE_BIT, constantID, value });
     }
+    return *this;
+}
 
-    return shaderModule;
-}
\ No newline at end of file
+bool ComputePipelineKey::operator==(const ComputePipelineKey& other) const
+{
+    return shaderFilePath == other.shaderFilePath &&
+        pushConstantSize == other.pushConstantSize &&
+        pushDescriptorSet == other.pushDescriptorSet &&
+        specializationConstants == other.specializationConstants;
+}
+
+size_t ComputePipelineKey::Hash() const
+{
+    size_t seed = 0;
+    VulkanUtils::HashCombine(seed, std::hash<std::string>{}(shaderFilePath));
+    VulkanUtils::HashCombine(seed, pushConstantSize);
+    VulkanUtils::HashCombine(seed, pushDescriptorSet ? 1u : 0u);
+    for (const SpecializationConstant& constant : specializationConstants)
+    {
+        VulkanUtils::HashCombine(seed, constant.constantID);
+        VulkanUtils::HashCombine(seed, constant.value);
+    }
+    return seed;
+}
+
+void VulkanPipeline::FillPipelineInfo(const GraphicsPipelineKey& key, PipelineInfo& configInfo)
+{
+    std::vector<VkFormat> colorFormats(key.colorAttachmentFormats.begin(), key.colorAttachmentFormats.begin() + key.colorAttachmentCount);
+    DefaultPipelineConfig(configInfo, colorFormats);
+
+    configInfo.inputAssemblyInfo.topology = key.topology;
+
+    configInfo.rasterizationInfo.polygonMode = key.polygonMode;
+    configInfo.rasterizationInfo.cullMode = key.cullMode;
+    configInfo.rasterizationInfo.frontFace = key.frontFace;
+
+    configInfo.multisampleInfo.rasterizationSamples = key.samples;
+    configInfo.multisampleInfo.sampleShadingEnable = (key.sampleShading && key.samples != VK_SAMPLE_COUNT_1_BIT) ? VK_TRUE : VK_FALSE;
+    configInfo.multisampleInfo.minSampleShading = configInfo.multisampleInfo.sampleShadingEnable ? 0.2f : 1.0f;
+
+    configInfo.depthStencilInfo.depthTestEnable = key.depthTest ? VK_TRUE : VK_FALSE;
+    configInfo.depthStencilInfo.depthWriteEnable = key.depthWrite ? VK_TRUE : VK_FALSE;
+    configInfo.depthStencilInfo.depthCompareOp = key.depthCompareOp;
+
+    for (VkPipelineColorBlendAttachmentState& attachment : configInfo.colorBlendAttachments)
+    {
+        switch (key.blendMode)
+        {
+        case PipelineBlendMode::Additive:
+            attachment.blendEnable = VK_TRUE;
+            attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            break;
+        case PipelineBlendMode::AlphaBlend:
+            attachment.blendEnable = VK_TRUE;
+            attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            break;
+        case PipelineBlendMode::Opaque:
+        default:
+            attachment.blendEnable = VK_FALSE;
+            break;
+        }
+    }
+
+    if (key.vertexLayout == PipelineVertexLayout::None) {
+        configInfo.bindingDescriptions.clear();
+        configInfo.attributeDescriptions.clear();
+    }
+
+    configInfo.depthAttachmentFormat = key.depthAttachmentFormat;
+    configInfo.stencilAttachmentFormat = key.stencilAttachmentFormat;
+    configInfo.specializationConstants = key.specializationConstants;
+    configInfo.pushDescriptorSet = key.pushDescriptorSet;
+}
+
+const CachedPipeline& VulkanPipeline::InsertCachedPipeline(const GraphicsPipelineKey& key, std::unique_ptr<CachedPipeline> entry)
+{
+    std::lock_guard<std::mutex> lock(psoMutex);
+
+    auto [it, inserted] = psoCache.try_emplace(key, std::move(entry));
+    if (!inserted) {
+        // try_emplace leaves entry untouched when the key already exists
+        vkDestroyPipeline(context->GetDevice(), entry->pipeline, nullptr);
+        vkDestroyPipelineLayout(context->GetDevice(), entry->layout, nullptr);
+    }
+    return *it->second;
+}
+
+const CachedPipeline& VulkanPipeline::GetPipeline(const GraphicsPipelineKey& key)
+{
+    {
+        std::lock_guard<std::mutex> lock(psoMutex);
+        auto it = psoCache.find(key);
+        if (it != psoCache.end()) {
+            return *it->second;
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::string name = key.name.empty() ? key.fragShaderFilePath : key.name;
+
+    if (context->GetOptionalFeatures().graphicsPipelineLibrary)
+    {
+        if (std::unique_ptr<CachedPipeline> linked = LinkCachedPipeline(key))
+        {
+            const double linkMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Pipeline '" << name << "' fast-linked in " << linkMs << " ms" << std::endl;
+
+            std::array<VkPipeline, PIPELINE_LIBRARY_PART_COUNT> libraries = GetOrCreateLibraries(key);
+            const CachedPipeline& entry = InsertCachedPipeline(key, std::move(linked));
+            QueueOptimizedLink({ key, libraries, entry.layout });
+            return entry;
+        }
+    }
+
+    PipelineInfo configInfo{};
+    FillPipelineInfo(key, configInfo);
+
+    auto entry = std::make_unique<CachedPipeline>();
+    CreateGraphicsPipelineInternal(key.vertShaderFilePath, key.fragShaderFilePath, configInfo, VK_NULL_HANDLE,
+        entry->pipeline, entry->layout, key.pushConstantSize, context->GetPipelineCache().GetHandle());
+    entry->setLayouts = configInfo.descriptorSetLayouts;
+    entry->pushConstantRanges = configInfo.pushConstantRanges;
+
+    const double compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Pipeline '" << name << "' compiled on demand in " << compileMs << " ms" << std::endl;
+
+    return InsertCachedPipeline(key, std::move(entry));
+}
+
+const CachedPipeline& VulkanPipeline::GetComputePipeline(const ComputePipelineKey& key)
+{
+    {
+        std::lock_guard<std::mutex> lock(psoMutex);
+        auto it = computeCache.find(key);
+        if (it != computeCache.end()) {
+            return *it->second;
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    auto entry = std::make_unique<CachedPipeline>();
+    CreateComputePipelineInternal(key, *entry);
+
+    const double compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Compute pipeline '" << (key.name.empty() ? key.shaderFilePath : key.name) << "' compiled in " << compileMs << " ms" << std::endl;
+
+    std::lock_guard<std::mutex> lock(psoMutex);
+    auto [it, inserted] = computeCache.try_emplace(key, std::move(entry));
+    if (!inserted) {
+        vkDestroyPipeline(context->GetDevice(), entry->pipeline, nullptr);
+        vkDestroyPipelineLayout(context->GetDevice(), entry->layout, nullptr);
+    }
+    return *it->second;
+}
+
+PipelineHandle VulkanPipeline::RequestPipelineAsync(const GraphicsPipelineKey& key, const GraphicsPipelineKey& fallbackKey)
+{
+    // Resolve the fallback first, it may need a synchronous compile and must never be pending itself
+    const CachedPipeline& fallback = GetPipeline(fallbackKey);
+
+    const CachedPipeline* cached = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(psoMutex);
+        auto it = psoCache.find(key);
+        if (it != psoCache.end()) {
+            cached = it->second.get();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(asyncMutex);
+
+    auto existing = asyncRequestIds.find(key);
+    if (existing != asyncRequestIds.end()) {
+        return PipelineHandle{ existing->second };
+    }
+
+    const uint32_t id = static_cast<uint32_t>(asyncRequests.size());
+    AsyncRequest& request = asyncRequests.emplace_back();
+    request.key = key;
+    request.fallback = &fallback;
+    request.pipeline = cached;
+    asyncRequestIds.emplace(key, id);
+
+    if (cached == nullptr)
+    {
+        if (asyncWorkers.empty())
+        {
+            // Few workers on purpose: the render thread and the GPU driver threads keep their cores
+            const unsigned workerCount = std::clamp(std::thread::hardware_concurrency() / 4, 1u, 2u);
+            stopAsyncWorkers = false;
+            for (unsigned i = 0; i < workerCount; ++i)
+            {
+                asyncWorkers.emplace_back(&VulkanPipeline::AsyncWorkerLoop, this);
+            }
+        }
+        asyncQueue.push_back(&request);
+        asyncCondition.notify_one();
+    }
+
+    return PipelineHandle{ id };
+}
+
+VulkanPipeline::AsyncRequest& VulkanPipeline::GetAsyncRequest(PipelineHandle handle)
+{
+    std::lock_guard<std::mutex> lock(asyncMutex);
+    if (!handle.IsValid() || handle.id >= asyncRequests.size()) {
+        throw std::runtime_error("Invalid pipeline handle!");
+    }
+    return asyncRequests[handle.id];
+}
+
+const CachedPipeline& VulkanPipeline::ResolvePipeline(PipelineHandle handle)
+{
+    AsyncRequest& request = GetAsyncRequest(handle);
+    const CachedPipeline* pipeline = request.pipeline.load(std::memory_order_acquire);
+    return pipeline != nullptr ? *pipeline : *request.fallback;
+}
+
+bool VulkanPipeline::IsPipelineReady(PipelineHandle handle)
+{
+    return GetAsyncRequest(handle).pipeline.load(std::memory_order_acquire) != nullptr;
+}
+
+bool VulkanPipeline::IsPipelineFailed(PipelineHandle handle)
+{
+    return GetAsyncRequest(handle).failed.load(std::memory_order_acquire);
+}
+
+void VulkanPipeline::AsyncWorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(asyncMutex);
+    while (true)
+    {
+        asyncCondition.wait(lock, [this] { return stopAsyncWorkers || !asyncQueue.empty(); });
+        if (stopAsyncWorkers) {
+            break;
+        }
+
+        AsyncRequest* request = asyncQueue.front();
+        asyncQueue.pop_front();
+        lock.unlock();
+
+        // GetPipeline is thread-safe: it fast-links when pipeline libraries are available and
+        // compiles against the shared pipeline cache otherwise
+        try {
+            const CachedPipeline& pipeline = GetPipeline(request->key);
+            request->pipeline.store(&pipeline, std::memory_order_release);
+        }
+        catch (const std::exception& e) {
+            // The fallback stays in use for this request
+            std::cerr << "Async pipeline '" << (request->key.name.empty() ? request->key.fragShaderFilePath : request->key.name)
+                << "' failed: " << e.what() << std::endl;
+            request->failed.store(true, std::memory_order_release);
+        }
+
+        lock.lock();
+    }
+}
+
+std::unique_ptr<CachedPipeline> VulkanPipeline::LinkCachedPipeline(const GraphicsPipelineKey& key)
+{
+    auto entry = std::make_unique<CachedPipeline>();
+    try {
+        const std::array<VkPipeline, PIPELINE_LIBRARY_PART_COUNT> libraries = GetOrCreateLibraries(key);
+
+        // The linked pipeline gets its own, identically defined layout
+        PipelineInfo configInfo{};
+        FillPipelineInfo(key, configInfo);
+        ReflectShaders(key.vertShaderFilePath, key.fragShaderFilePath, configInfo, VK_NULL_HANDLE, key.pushConstantSize);
+
+        entry->layout = CreatePipelineLayout(configInfo);
+        entry->setLayouts = configInfo.descriptorSetLayouts;
+        entry->pushConstantRanges = configInfo.pushConstantRanges;
+        entry->pipeline = LinkPipelineLibraries(libraries, entry->layout, false);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Pipeline library path failed for '" << (key.name.empty() ? key.fragShaderFilePath : key.name)
+            << "', compiling the full pipeline instead: " << e.what() << std::endl;
+        if (entry->layout != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(context->GetDevice(), entry->layout, nullptr);
+        }
+        return nullptr;
+    }
+    return entry;
+}
+
+void VulkanPipeline::QueueOptimizedLink(OptimizeJob job)
+{
+    std::lock_guard<std::mutex> lock(optimizerMutex);
+    if (!optimizerThread.joinable()) {
+        stopOptimizer = false;
+        optimizerThread = std::thread(&VulkanPipeline::OptimizerLoop, this);
+    }
+    optimizeJobs.push_back(std::move(job));
+    optimizerCondition.notify_one();
+}
+
+void VulkanPipeline::OptimizerLoop()
+{
+    std::unique_lock<std::mutex> lock(optimizerMutex);
+    while (true)
+    {
+        optimizerCondition.wait(lock, [this] { return stopOptimizer || !optimizeJobs.empty(); });
+        if (stopOptimizer) {
+            break;
+        }
+
+        OptimizeJob job = std::move(optimizeJobs.front());
+        optimizeJobs.pop_front();
+        optimizerBusy = true;
+        lock.unlock();
+
+        const auto start = std::chrono::steady_clock::now();
+        VkPipeline optimized = VK_NULL_HANDLE;
+        try {
+            optimized = LinkPipelineLibraries(job.libraries, job.layout, true);
+            const double linkMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Pipeline '" << (job.key.name.empty() ? job.key.fragShaderFilePath : job.key.name)
+                << "' optimized in the background in " << linkMs << " ms" << std::endl;
+        }
+        catch (const std::exception& e) {
+            // The fast-linked pipeline simply stays in use
+            std::cerr << e.what() << std::endl;
+        }
+
+        lock.lock();
+        optimizerBusy = false;
+        if (optimized != VK_NULL_HANDLE) {
+            optimizedPipelines.emplace_back(std::move(job.key), optimized);
+        }
+        optimizerIdleCondition.notify_all();
+    }
+}
+
+void VulkanPipeline::WaitForOptimizer()
+{
+    std::unique_lock<std::mutex> lock(optimizerMutex);
+    optimizerIdleCondition.wait(lock, [this] { return !optimizerThread.joinable() || (optimizeJobs.empty() && !optimizerBusy); });
+}
+
+uint32_t VulkanPipeline::SwapInOptimizedPipelines()
+{
+    std::vector<std::pair<GraphicsPipelineKey, VkPipeline>> results;
+    {
+        std::lock_guard<std::mutex> lock(optimizerMutex);
+        results.swap(optimizedPipelines);
+    }
+
+    uint32_t swapped = 0;
+    VulkanDeletionQueue& deletionQueue = context->GetDeletionQueue();
+    std::lock_guard<std::mutex> lock(psoMutex);
+    for (auto& [key, optimized] : results)
+    {
+        auto it = psoCache.find(key);
+        if (it == psoCache.end()) {
+            vkDestroyPipeline(context->GetDevice(), optimized, nullptr);
+            continue;
+        }
+
+        // The fast-linked pipeline may still be used by frames in flight
+        deletionQueue.DestroyPipeline(it->second->pipeline);
+        it->second->pipeline = optimized;
+        ++swapped;
+    }
+    return swapped;
+}
+
+VulkanPipeline& VulkanPipeline::PrecompilePipelines(const std::vector<GraphicsPipelineKey>& keys)
+{
+    std::vector<const GraphicsPipelineKey*> missingKeys;
+    {
+        std::lock_guard<std::mutex> lock(psoMutex);
+        for (const GraphicsPipelineKey& key : keys)
+        {
+            bool alreadyQueued = std::any_of(missingKeys.begin(), missingKeys.end(),
+                [&](const GraphicsPipelineKey* queued) { return *queued == key; });
+
+            if (!alreadyQueued && psoCache.find(key) == psoCache.end()) {
+                missingKeys.push_back(&key);
+            }
+        }
+    }
+
+    if (missingKeys.empty()) {
+        return *this;
+    }
+
+    // PipelineInfo holds pointers into itself, keep every config at a stable address
+    std::vector<std::unique_ptr<PipelineInfo>> configs;
+    std::vector<std::unique_ptr<CachedPipeline>> entries;
+    std::vector<GraphicsPipelineDesc> pipelineDescs;
+
+    for (const GraphicsPipelineKey* key : missingKeys)
+    {
+        configs.push_back(std::make_unique<PipelineInfo>());
+        FillPipelineInfo(*key, *configs.back());
+        entries.push_back(std::make_unique<CachedPipeline>());
+
+        GraphicsPipelineDesc desc{};
+        desc.name = key->name.empty() ? key->fragShaderFilePath : key->name;
+        desc.vertShaderFilePath = key->vertShaderFilePath;
+        desc.fragShaderFilePath = key->fragShaderFilePath;
+        desc.config = configs.back().get();
+        desc.pipeline = &entries.back()->pipeline;
+        desc.pipelineLayout = &entries.back()->layout;
+        desc.pushConstantSize = key->pushConstantSize;
+        pipelineDescs.push_back(desc);
+    }
+
+    BuildGraphicsPipelines(pipelineDescs);
+
+    for (size_t i = 0; i < missingKeys.size(); ++i)
+    {
+        entries[i]->setLayouts = configs[i]->descriptorSetLayouts;
+        entries[i]->pushConstantRanges = configs[i]->pushConstantRanges;
+        InsertCachedPipeline(*missingKeys[i], std::move(entries[i]));
+    }
+
+    return *this;
+}
+
+uint32_t VulkanPipeline::ReloadChangedShaders()
+{
+    const std::vector<std::string> changedShaders = context->GetShaderCompiler().TakeChangedShaders();
+    if (changedShaders.empty()) {
+        return 0;
+    }
+
+    auto usesChangedShader = [&](const GraphicsPipelineKey& key) {
+        return std::find(changedShaders.begin(), changedShaders.end(), key.vertShaderFilePath) != changedShaders.end() ||
+            std::find(changedShaders.begin(), changedShaders.end(), key.fragShaderFilePath) != changedShaders.end();
+        };
+
+    VulkanDeletionQueue& deletionQueue = context->GetDeletionQueue();
+
+    // Pending optimizer work links stale libraries against layouts that are about to be replaced
+    WaitForOptimizer();
+    {
+        std::lock_guard<std::mutex> lock(optimizerMutex);
+        auto stale = std::remove_if(optimizedPipelines.begin(), optimizedPipelines.end(),
+            [&](const std::pair<GraphicsPipelineKey, VkPipeline>& result) { return usesChangedShader(result.first); });
+        for (auto it = stale; it != optimizedPipelines.end(); ++it)
+        {
+            vkDestroyPipeline(context->GetDevice(), it->second, nullptr);
+        }
+        optimizedPipelines.erase(stale, optimizedPipelines.end());
+    }
+
+    // Library parts built from the old code must not be linked into new variants
+    {
+        std::lock_guard<std::mutex> lock(libraryMutex);
+        for (auto& libraries : libraryCache)
+        {
+            for (auto it = libraries.begin(); it != libraries.end();)
+            {
+                if (!usesChangedShader(it->first)) {
+                    ++it;
+                    continue;
+                }
+                deletionQueue.DestroyPipeline(it->second.pipeline);
+                if (it->second.layout != VK_NULL_HANDLE) {
+                    deletionQueue.DestroyPipelineLayout(it->second.layout);
+                }
+                it = libraries.erase(it);
+            }
+        }
+    }
+
+    std::vector<std::pair<const GraphicsPipelineKey*, CachedPipeline*>> affected;
+    {
+        std::lock_guard<std::mutex> lock(psoMutex);
+        for (auto& [key, entry] : psoCache)
+        {
+            if (usesChangedShader(key)) {
+                affected.emplace_back(&key, entry.get());
+            }
+        }
+    }
+
+    uint32_t reloaded = 0;
+    for (auto& [key, entry] : affected)
+    {
+        const std::string name = key->name.empty() ? key->fragShaderFilePath : key->name;
+
+        PipelineInfo configInfo{};
+        FillPipelineInfo(*key, configInfo);
+
+        VkPipeline newPipeline = VK_NULL_HANDLE;
+        VkPipelineLayout newLayout = VK_NULL_HANDLE;
+        try {
+            CreateGraphicsPipelineInternal(key->vertShaderFilePath, key->fragShaderFilePath, configInfo, VK_NULL_HANDLE,
+                newPipeline, newLayout, key->pushConstantSize, context->GetPipelineCache().GetHandle());
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Hot reload of pipeline '" << name << "' failed, keeping the old one: " << e.what() << std::endl;
+            continue;
+        }
+
+        // Descriptor sets were allocated against the old layouts, a changed interface needs a restart
+        if (configInfo.descriptorSetLayouts != entry->setLayouts) {
+            std::cerr << "Hot reload of pipeline '" << name << "' changed its descriptor sets, restart to apply it" << std::endl;
+            vkDestroyPipeline(context->GetDevice(), newPipeline, nullptr);
+            vkDestroyPipelineLayout(context->GetDevice(), newLayout, nullptr);
+            continue;
+        }
+
+        // The old objects may still be used by frames in flight
+        {
+            std::lock_guard<std::mutex> lock(psoMutex);
+            deletionQueue.DestroyPipeline(entry->pipeline);
+            deletionQueue.DestroyPipelineLayout(entry->layout);
+            entry->pipeline = newPipeline;
+            entry->layout = newLayout;
+            entry->pushConstantRanges = configInfo.pushConstantRanges;
+        }
+
+        std::cout << "Hot reloaded pipeline '" << name << "'" << std::endl;
+        ++reloaded;
+    }
+
+    std::vector<std::pair<const ComputePipelineKey*, CachedPipeline*>> affectedCompute;
+    {
+        std::lock_guard<std::mutex> lock(psoMutex);
+        for (auto& [key, entry] : computeCache)
+        {
+            if (std::find(changedShaders.begin(), changedShaders.end(), key.shaderFilePath) != changedShaders.end()) {
+                affectedCompute.emplace_back(&key, entry.get());
+            }
+        }
+    }
+
+    for (auto& [key, entry] : affectedCompute)
+    {
+        const std::string name = key->name.empty() ? key->shaderFilePath : key->name;
+
+        CachedPipeline rebuilt{};
+        try {
+            CreateComputePipelineInternal(*key, rebuilt);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Hot reload of compute pipeline '" << name << "' failed, keeping the old one: " << e.what() << std::endl;
+            continue;
+        }
+
+        if (rebuilt.setLayouts != entry->setLayouts) {
+            std::cerr << "Hot reload of compute pipeline '" << name << "' changed its descriptor sets, restart to apply it" << std::endl;
+            vkDestroyPipeline(context->GetDevice(), rebuilt.pipeline, nullptr);
+            vkDestroyPipelineLayout(context->GetDevice(), rebuilt.layout, nullptr);
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(psoMutex);
+            deletionQueue.DestroyPipeline(entry->pipeline);
+            deletionQueue.DestroyPipelineLayout(entry->layout);
+            entry->pipeline = rebuilt.pipeline;
+            entry->layout = rebuilt.layout;
+            entry->pushConstantRanges = rebuilt.pushConstantRanges;
+        }
+
+        std::cout << "Hot reloaded compute pipeline '" << name << "'" << std::endl;
+        ++reloaded;
+    }
+
+    return reloaded;
+}
+
+size_t VulkanPipeline::GetCachedPipelineCount() const
+{
+    std::lock_guard<std::mutex> lock(psoMutex);
+    return psoCache.size() + computeCache.size();
+}
+
+void VulkanPipeline::CleanupPipelines()
+{
+    // Async workers first, they can still queue optimizer jobs
+    {
+        std::lock_guard<std::mutex> lock(asyncMutex);
+        stopAsyncWorkers = true;
+    }
+    asyncCondition.notify_all();
+    for (std::thread& worker : asyncWorkers)
+    {
+        worker.join();
+    }
+    asyncWorkers.clear();
+    asyncQueue.clear();
+    asyncRequestIds.clear();
+    asyncRequests.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(optimizerMutex);
+        stopOptimizer = true;
+    }
+    optimizerCondition.notify_all();
+    if (optimizerThread.joinable()) {
+        optimizerThread.join();
+    }
+    optimizeJobs.clear();
+    for (auto& [key, optimized] : optimizedPipelines)
+    {
+        vkDestroyPipeline(context->GetDevice(), optimized, nullptr);
+    }
+    optimizedPipelines.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(libraryMutex);
+        for (auto& libraries : libraryCache)
+        {
+            for (auto& [key, library] : libraries)
+            {
+                vkDestroyPipeline(context->GetDevice(), library.pipeline, nullptr);
+                if (library.layout != VK_NULL_HANDLE) {
+                    vkDestroyPipelineLayout(context->GetDevice(), library.layout, nullptr);
+                }
+            }
+            libraries.clear();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(psoMutex);
+    for (auto& [key, entry] : psoCache)
+    {
+        vkDestroyPipeline(context->GetDevice(), entry->pipeline, nullptr);
+        vkDestroyPipelineLayout(context->GetDevice(), entry->layout, nullptr);
+    }
+    psoCache.clear();
+
+    for (auto& [key, entry] : computeCache)
+    {
+        vkDestroyPipeline(context->GetDevice(), entry->pipeline, nullptr);
+        vkDestroyPipelineLayout(context->GetDevice(), entry->layout, nullptr);
+    }
+    computeCache.clear();
+}
@@ -2,7 +2,31 @@
 #define VULKAN_PIPELINE_H
 #include "VulkanUtils.h"
 #include "VulkanContext.h"
+#include <string>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 class VulkanContext;
+class ShaderReflection;
+
+//**
+// One 32-bit specialization constant (int, uint, float bits or VkBool32) for the given stages
+//**
+struct SpecializationConstant
+{
+    VkShaderStageFlags stages = 0;
+    uint32_t constantID = 0;
+    uint32_t value = 0;
+
+    bool operator==(const SpecializationConstant& other) const
+    {
+        return stages == other.stages && constantID == other.constantID && value == other.value;
+    }
+};
 
 struct PipelineInfo
 {
@@ -30,10 +54,219 @@ struct PipelineInfo
 
    
     std::vector<VkFormat> colorAttachmentFormats;
-    uint32_t colorAttachmentCount = static_cast<uint32_t>(colorAttachmentFormats.size());
+    uint32_t colorAttachmentCount = 0;
     VkFormat depthAttachmentFormat = VK_FORMAT_UNDEFINED;
     VkFormat stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
-	
+
+    // Applied to the matching shader stages when the pipeline is created
+    std::vector<SpecializationConstant> specializationConstants;
+
+    // Set 0 is created as a push descriptor layout (VK_KHR_push_descriptor)
+    bool pushDescriptorSet = false;
+
+    // Filled from shader reflection when the pipeline is built. Layouts are indexed by set
+    // number and owned by the context's layout cache; push stages are what vkCmdPushConstants must use.
+    std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+    std::vector<VkPushConstantRange> pushConstantRanges;
+};
+
+//**
+// Everything needed to build one graphics pipeline through VulkanPipeline::BuildGraphicsPipelines.
+// The config, pipeline and layout are referenced, not owned, and must outlive the build.
+// Set layouts and push-constant ranges are reflected from the shaders; the push-constant type is
+// only used to check that the C++ struct still fits the block the shaders declare.
+//**
+struct GraphicsPipelineDesc
+{
+    template<typename TPushConstant = void>
+    static GraphicsPipelineDesc Create(const std::string& name, const std::string& vertShaderFilePath, const std::string& fragShaderFilePath,
+        PipelineInfo& config, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout)
+    {
+        GraphicsPipelineDesc desc{};
+        desc.name = name;
+        desc.vertShaderFilePath = vertShaderFilePath;
+        desc.fragShaderFilePath = fragShaderFilePath;
+        desc.config = &config;
+        desc.pipeline = &pipeline;
+        desc.pipelineLayout = &pipelineLayout;
+        if constexpr (!std::is_same_v<TPushConstant, void>) {
+            desc.pushConstantSize = static_cast<uint32_t>(sizeof(TPushConstant));
+        }
+        return desc;
+    }
+
+    std::string name;
+    std::string vertShaderFilePath;
+    std::string fragShaderFilePath;
+    PipelineInfo* config = nullptr;
+    VkPipeline* pipeline = nullptr;
+    VkPipelineLayout* pipelineLayout = nullptr;
+    uint32_t pushConstantSize = 0;
+
+    // Optional: replaces the reflected layout of set 0
+    VkDescriptorSetLayout descriptorSetLayoutOverride = VK_NULL_HANDLE;
+
+    // Filled in by BuildGraphicsPipelines
+    double compileTimeMs = 0.0;
+};
+
+enum class PipelineVertexLayout : uint8_t
+{
+    None,   // no vertex buffers, e.g. full-screen passes using gl_VertexIndex
+    Mesh    // Vertex::GetBindingDescription / GetAttributeDescriptions
+};
+
+enum class PipelineBlendMode : uint8_t
+{
+    Opaque,
+    Additive,
+    AlphaBlend
+};
+
+//**
+// Compact, hashable description of a graphics pipeline. Two keys that compare equal always map
+// to the same cached VkPipeline, so variants are just different keys instead of new
+// VulkanPipeline objects. Defaults match DefaultPipelineConfig.
+//**
+struct GraphicsPipelineKey
+{
+    static constexpr uint32_t MAX_COLOR_ATTACHMENTS = 8;
+
+    // For logging only, not part of the identity
+    std::string name;
+
+    std::string vertShaderFilePath;
+    std::string fragShaderFilePath;
+    PipelineVertexLayout vertexLayout = PipelineVertexLayout::Mesh;
+
+    uint32_t colorAttachmentCount = 0;
+    std::array<VkFormat, MAX_COLOR_ATTACHMENTS> colorAttachmentFormats{};
+    VkFormat depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+    VkFormat stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    bool sampleShading = true; // only takes effect when samples > 1
+
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+    VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+    bool depthTest = true;
+    bool depthWrite = true;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+
+    PipelineBlendMode blendMode = PipelineBlendMode::Opaque;
+
+    // Size of the C++ push-constant struct, checked against the reflected block
+    uint32_t pushConstantSize = 0;
+
+    // Shader variants: each distinct set of values compiles to its own pipeline
+    std::vector<SpecializationConstant> specializationConstants;
+
+    // Set 0 is pushed with vkCmdPushDescriptorSetWithTemplateKHR instead of bound; requires
+    // OptionalDeviceFeatures::pushDescriptor
+    bool pushDescriptorSet = false;
+
+    GraphicsPipelineKey& SetShaders(const std::string& vertPath, const std::string& fragPath);
+    GraphicsPipelineKey& SetColorFormats(const std::vector<VkFormat>& formats);
+
+    //**
+    // Sets a specialization constant, replacing an earlier value for the same stages and ID
+    //**
+    GraphicsPipelineKey& SetSpecialization(VkShaderStageFlags stages, uint32_t constantID, uint32_t value);
+
+    template<typename TPushConstant>
+    GraphicsPipelineKey& SetPushConstant()
+    {
+        pushConstantSize = static_cast<uint32_t>(sizeof(TPushConstant));
+        return *this;
+    }
+
+    bool operator==(const GraphicsPipelineKey& other) const;
+    size_t Hash() const;
+};
+
+struct GraphicsPipelineKeyHash
+{
+    size_t operator()(const GraphicsPipelineKey& key) const { return key.Hash(); }
+};
+
+//**
+// Hashable description of a compute pipeline; cached next to the graphics pipelines
+//**
+struct ComputePipelineKey
+{
+    // For logging only, not part of the identity
+    std::string name;
+
+    std::string shaderFilePath;
+
+    // Size of the C++ push-constant struct, checked against the reflected block
+    uint32_t pushConstantSize = 0;
+
+    // All constants apply to VK_SHADER_STAGE_COMPUTE_BIT
+    std::vector<SpecializationConstant> specializationConstants;
+
+    // Set 0 is pushed instead of bound, see GraphicsPipelineKey::pushDescriptorSet
+    bool pushDescriptorSet = false;
+
+    ComputePipelineKey& SetShader(const std::string& path);
+
+    //**
+    // Sets a specialization constant, replacing an earlier value for the same ID
+    //**
+    ComputePipelineKey& SetSpecialization(uint32_t constantID, uint32_t value);
+
+    template<typename TPushConstant>
+    ComputePipelineKey& SetPushConstant()
+    {
+        pushConstantSize = static_cast<uint32_t>(sizeof(TPushConstant));
+        return *this;
+    }
+
+    bool operator==(const ComputePipelineKey& other) const;
+    size_t Hash() const;
+};
+
+struct ComputePipelineKeyHash
+{
+    size_t operator()(const ComputePipelineKey& key) const { return key.Hash(); }
+};
+
+//**
+// A compiled pipeline owned by the PSO cache, together with what the shaders reflected
+//**
+struct CachedPipeline
+{
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSetLayout> setLayouts;
+    std::vector<VkPushConstantRange> pushConstantRanges;
+
+    VkShaderStageFlags GetPushConstantStages() const { return pushConstantRanges.empty() ? 0 : pushConstantRanges[0].stageFlags; }
+};
+
+//**
+// Returned by VulkanPipeline::RequestPipelineAsync. Resolves to the fallback pipeline until the
+// requested one has finished compiling. Invalidated by CleanupPipelines.
+//**
+struct PipelineHandle
+{
+    uint32_t id = UINT32_MAX;
+
+    bool IsValid() const { return id != UINT32_MAX; }
+};
+
+//**
+// The four parts VK_EXT_graphics_pipeline_library splits a graphics pipeline into
+//**
+enum class PipelineLibraryPart : uint8_t
+{
+    VertexInput,
+    PreRasterization,
+    FragmentShader,
+    FragmentOutput
 };
 
 class VulkanPipeline final 
@@ -54,166 +287,255 @@ public:
         const std::string& vertShaderFilePath,
         const std::string& fragShaderFilePath,
         PipelineInfo& pipelineConfigInfo,
-        VkDescriptorSetLayout descriptorSetLayout,
+        VkDescriptorSetLayout descriptorSetLayoutOverride,
         VkPipeline& pipeline,
-        VkPipelineLayout& pipelineLayout,
-        VkShaderStageFlags pushConstantStageFlags = 0 
+        VkPipelineLayout& pipelineLayout
     )
     {
-        // IMPORTANT: The entire definition of CreateGraphicsPipeline
-        // (the code you provided in the question) goes here.
-
-        // Validate inputs
-        if (vertShaderFilePath.empty() || fragShaderFilePath.empty()) {
-            throw std::runtime_error("Shader file paths cannot be empty!");
-        }
-
-        if (descriptorSetLayout == VK_NULL_HANDLE) {
-            throw std::runtime_error("Descriptor set layout cannot be VK_NULL_HANDLE!");
-        }
-
-        auto vertShaderCode = VulkanUtils::ReadFile(vertShaderFilePath);
-        auto fragShaderCode = VulkanUtils::ReadFile(fragShaderFilePath);
-
-        VkShaderModule vertShaderModule = CreateShaderModule(context->GetDevice(), vertShaderCode);
-        VkShaderModule fragShaderModule = CreateShaderModule(context->GetDevice(), fragShaderCode);
-
-        // RAII-style cleanup for shader modules
-        auto cleanupShaders = [&]() {
-            vkDestroyShaderModule(context->GetDevice(), fragShaderModule, nullptr);
-            vkDestroyShaderModule(context->GetDevice(), vertShaderModule, nullptr);
-            };
-
-        VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-        vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        vertShaderStageInfo.module = vertShaderModule;
-        vertShaderStageInfo.pName = "main";
-
-        VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-        fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragShaderStageInfo.module = fragShaderModule;
-        fragShaderStageInfo.pName = "main";
-
-        VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
-
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-
-        auto bindingDescription = pipelineConfigInfo.bindingDescriptions;
-        auto attributeDescriptions = pipelineConfigInfo.attributeDescriptions;
-
-        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescription.size());
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexBindingDescriptions = bindingDescription.data();
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-
-        // Create pipeline layout
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 1;
-        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-
-        // --- Push Constant Handling ---
-        VkPushConstantRange pushConstantRange{};
-        if (pushConstantStageFlags != 0) {
-            pushConstantRange.offset = 0;
-            // Handle void specialization:
-            if constexpr (!std::is_same_v<TPushConstant, void>) {
-                pushConstantRange.size = sizeof(TPushConstant);
-            }
-            else {
-                pushConstantRange.size = 0; // Or throw an error if void with stageFlags is invalid
-            }
-            pushConstantRange.stageFlags = pushConstantStageFlags;
-            pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-            pipelineLayoutInfo.pushConstantRangeCount = 1;
-        }
-        else {
-            pipelineLayoutInfo.pPushConstantRanges = nullptr;
-            pipelineLayoutInfo.pushConstantRangeCount = 0;
+        uint32_t pushConstantSize = 0;
+        if constexpr (!std::is_same_v<TPushConstant, void>) {
+            pushConstantSize = sizeof(TPushConstant);
         }
-        // --- End Push Constant Handling ---
 
-        if (vkCreatePipelineLayout(context->GetDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-            cleanupShaders();
-            throw std::runtime_error("failed to create pipeline layout!");
-        }
-
-        pipelineConfigInfo.pipelineLayout = pipelineLayout;
-
-        // Dynamic rendering setup
-        VkPipelineRenderingCreateInfo renderingInfo{};
-        renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
-        renderingInfo.colorAttachmentCount = pipelineConfigInfo.colorAttachmentCount;
-
-
-        if (pipelineConfigInfo.colorAttachmentCount == 1) {
-            renderingInfo.pColorAttachmentFormats = &pipelineConfigInfo.colorAttachmentFormats[0];
-        }
-        else {
-            renderingInfo.pColorAttachmentFormats = pipelineConfigInfo.colorAttachmentFormats.data();
-        }
-
-		
-
-        renderingInfo.depthAttachmentFormat = pipelineConfigInfo.depthAttachmentFormat;
-        renderingInfo.viewMask = 0;
-        renderingInfo.pNext = nullptr;
-
-        VkGraphicsPipelineCreateInfo pipelineInfo{};
-        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2;
-        pipelineInfo.pStages = shaderStages;
-        pipelineInfo.pVertexInputState = &vertexInputInfo;
-        pipelineInfo.pInputAssemblyState = &pipelineConfigInfo.inputAssemblyInfo;
-        pipelineInfo.pViewportState = &pipelineConfigInfo.viewportInfo;
-        pipelineInfo.pRasterizationState = &pipelineConfigInfo.rasterizationInfo;
-        pipelineInfo.pMultisampleState = &pipelineConfigInfo.multisampleInfo;
-        pipelineInfo.pColorBlendState = &pipelineConfigInfo.colorBlendInfo;
-        pipelineInfo.pDepthStencilState = &pipelineConfigInfo.depthStencilInfo;
-        pipelineInfo.pDynamicState = &pipelineConfigInfo.dynamicStateInfo;
-        pipelineInfo.layout = pipelineLayout;
-        pipelineInfo.renderPass = VK_NULL_HANDLE; // Using dynamic rendering
-        pipelineInfo.subpass = 0;
-        pipelineInfo.pNext = &renderingInfo;
-
-        VkResult result = vkCreateGraphicsPipelines(context->GetDevice(), pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
-
-        // Clean up shader modules regardless of success or failure
-        cleanupShaders();
-     
-        if (result != VK_SUCCESS) {
-            // Clean up pipeline layout on failure
-            vkDestroyPipelineLayout(context->GetDevice(), pipelineLayout, nullptr);
-            pipelineLayout = VK_NULL_HANDLE;
-            throw std::runtime_error("failed to create graphics pipeline!");
-        }
-
-       
+        CreateGraphicsPipelineInternal(vertShaderFilePath, fragShaderFilePath, pipelineConfigInfo, descriptorSetLayoutOverride,
+            pipeline, pipelineLayout, pushConstantSize, context->GetPipelineCache().GetHandle());
 
         return *this;
     }
 
-
-	VulkanPipeline& CreatePipelineCache();
+    //**
+    // Compiles every description concurrently on worker threads against the context's pipeline
+    // cache. Each description gets its compile time filled in; if any pipeline fails the first
+    // error is rethrown after all workers finished.
+    //**
+    VulkanPipeline& BuildGraphicsPipelines(std::vector<GraphicsPipelineDesc>& pipelineDescs);
 
 	VulkanPipeline& DefaultPipelineConfig(PipelineInfo& configInfo,  std::vector<VkFormat> formats);
 
+    //**
+    // Returns the pipeline for this key, compiling it on the calling thread on a cache miss.
+    // With VK_EXT_graphics_pipeline_library a miss only fast-links cached pipeline parts and the
+    // link-time optimized pipeline is built in the background (see SwapInOptimizedPipelines);
+    // without it the full pipeline is compiled. The returned reference stays valid until
+    // CleanupPipelines, but its handles can change between frames.
+    //**
+    const CachedPipeline& GetPipeline(const GraphicsPipelineKey& key);
+
+    //**
+    // Returns the compute pipeline for this key, compiling it on the calling thread on a cache miss
+    //**
+    const CachedPipeline& GetComputePipeline(const ComputePipelineKey& key);
+
+    //**
+    // Queues the pipeline for compilation on a worker thread and returns immediately. Until it is
+    // ready, ResolvePipeline hands out the fallback, which must be usable in the same pass (same
+    // attachment formats and descriptor set layouts) and is compiled right away if it is not cached.
+    // Requesting a key that is already cached or already requested returns a ready/shared handle.
+    //**
+    PipelineHandle RequestPipelineAsync(const GraphicsPipelineKey& key, const GraphicsPipelineKey& fallbackKey);
+
+    //**
+    // Returns the requested pipeline once compiled, otherwise its fallback. Never blocks on a compile.
+    //**
+    const CachedPipeline& ResolvePipeline(PipelineHandle handle);
+
+    //**
+    // Returns true once the requested pipeline itself (not the fallback) is available
+    //**
+    bool IsPipelineReady(PipelineHandle handle);
+
+    //**
+    // Returns true if the worker could not compile the requested pipeline. The request is not
+    // retried, ResolvePipeline keeps handing out the fallback for it.
+    //**
+    bool IsPipelineFailed(PipelineHandle handle);
+
+    //**
+    // Replaces fast-linked pipelines whose optimized build finished; the replaced pipelines go
+    // through the deletion queue. Call between frames. Returns the number of swapped pipelines.
+    //**
+    uint32_t SwapInOptimizedPipelines();
+
+    //**
+    // Compiles every key that is not cached yet, in parallel (see BuildGraphicsPipelines)
+    //**
+    VulkanPipeline& PrecompilePipelines(const std::vector<GraphicsPipelineKey>& keys);
+
+    //**
+    // Rebuilds every cached pipeline (graphics and compute) whose shaders were recompiled by the shader compiler's
+    // watcher and swaps it in place; the replaced objects go through the deletion queue.
+    // Call between frames, after the deletion queue's BeginFrame. Returns the number of swapped pipelines.
+    //**
+    uint32_t ReloadChangedShaders();
+
+    //**
+    // Returns the number of pipelines in the PSO cache
+    //**
+    size_t GetCachedPipelineCount() const;
+
+    //**
+    // Destroys every pipeline and layout in the PSO cache, and the pipeline libraries.
+    // Stops the background optimizer first.
+    //**
+    void CleanupPipelines();
+
 private:
+    static constexpr size_t PIPELINE_LIBRARY_PART_COUNT = 4;
+
+    // Shader code and vertex inputs resolved through reflection, shared by the monolithic and library paths
+    struct ReflectedShaders
+    {
+        std::vector<char> vertCode;
+        std::vector<char> fragCode;
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+    };
+
+    // Vertex + fragment shader modules and the stage infos pointing at them. The stage infos point
+    // into this struct, so it is filled in place and never copied; the modules die with it.
+    struct ShaderStages
+    {
+        ShaderStages() = default;
+        ShaderStages(const ShaderStages&) = delete;
+        ShaderStages& operator=(const ShaderStages&) = delete;
+        ~ShaderStages();
+
+        VkDevice device = VK_NULL_HANDLE;
+        std::array<VkShaderModule, 2> modules{};
+        std::array<std::vector<VkSpecializationMapEntry>, 2> specEntries;
+        std::array<std::vector<uint32_t>, 2> specData;
+        std::array<VkSpecializationInfo, 2> specInfos{};
+        std::array<VkPipelineShaderStageCreateInfo, 2> stages{};
+    };
+
+    struct PipelineLibrary
+    {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout layout = VK_NULL_HANDLE; // only for the shader parts
+    };
 
-	void SavePipelineCache();
-	VkPipelineCache LoadPipelineCache();
+    struct AsyncRequest
+    {
+        GraphicsPipelineKey key;
+        const CachedPipeline* fallback = nullptr;
+        std::atomic<const CachedPipeline*> pipeline{ nullptr }; // set by the worker once compiled
+        std::atomic<bool> failed{ false };                      // set by the worker if the compile threw
+    };
+
+    struct OptimizeJob
+    {
+        GraphicsPipelineKey key;
+        std::array<VkPipeline, PIPELINE_LIBRARY_PART_COUNT> libraries{};
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+    };
 
 	VkShaderModule CreateShaderModule(VkDevice device, const std::vector<char>& code);
 
+    //**
+    // Translates a key into the create-info structs used by CreateGraphicsPipelineInternal
+    //**
+    void FillPipelineInfo(const GraphicsPipelineKey& key, PipelineInfo& configInfo);
+
+    //**
+    // Inserts a compiled pipeline; if another thread got there first the duplicate is destroyed
+    //**
+    const CachedPipeline& InsertCachedPipeline(const GraphicsPipelineKey& key, std::unique_ptr<CachedPipeline> entry);
+
+    //**
+    // Loads and reflects both stages; fills the set layouts and push ranges of the config and
+    // resolves the vertex inputs the shader reads
+    //**
+    ReflectedShaders ReflectShaders(
+        const std::string& vertShaderFilePath,
+        const std::string& fragShaderFilePath,
+        PipelineInfo& pipelineConfigInfo,
+        VkDescriptorSetLayout descriptorSetLayoutOverride,
+        uint32_t pushConstantSize);
+
+    //**
+    // Turns reflected bindings into cached set layouts and push ranges on the config; shaderNames
+    // is only used in the error thrown when the push-constant struct outgrew the shader block
+    //**
+    void FillReflectedLayouts(const ShaderReflection& reflection, PipelineInfo& pipelineConfigInfo,
+        VkDescriptorSetLayout descriptorSetLayoutOverride, uint32_t pushConstantSize, const std::string& shaderNames);
+
+    void CreateShaderStages(const ReflectedShaders& shaders, const PipelineInfo& pipelineConfigInfo, ShaderStages& stages);
+    VkPipelineLayout CreatePipelineLayout(const PipelineInfo& pipelineConfigInfo);
+
+    // --- VK_EXT_graphics_pipeline_library ---
+
+    //**
+    // Reduces a key to the fields that affect one library part, used as that part's cache key
+    //**
+    static GraphicsPipelineKey MakeLibraryKey(const GraphicsPipelineKey& key, PipelineLibraryPart part);
+    void CreatePipelineLibrary(const GraphicsPipelineKey& key, PipelineLibraryPart part, PipelineLibrary& library);
+    std::array<VkPipeline, PIPELINE_LIBRARY_PART_COUNT> GetOrCreateLibraries(const GraphicsPipelineKey& key);
+    VkPipeline LinkPipelineLibraries(const std::array<VkPipeline, PIPELINE_LIBRARY_PART_COUNT>& libraries,
+        VkPipelineLayout pipelineLayout, bool optimize);
+
+    //**
+    // Fast-links the pipeline for a key from its cached parts; returns nullptr if linking failed
+    //**
+    std::unique_ptr<CachedPipeline> LinkCachedPipeline(const GraphicsPipelineKey& key);
+
+    void AsyncWorkerLoop();
+    AsyncRequest& GetAsyncRequest(PipelineHandle handle);
+
+    void QueueOptimizedLink(OptimizeJob job);
+    void OptimizerLoop();
+
+    //**
+    // Blocks until the optimizer has no queued or running job
+    //**
+    void WaitForOptimizer();
+
+    //**
+    // Reflects and compiles one compute pipeline; entry receives the handles and reflected layouts
+    //**
+    void CreateComputePipelineInternal(const ComputePipelineKey& key, CachedPipeline& entry);
+
+    void CreateGraphicsPipelineInternal(
+        const std::string& vertShaderFilePath,
+        const std::string& fragShaderFilePath,
+        PipelineInfo& pipelineConfigInfo,
+        VkDescriptorSetLayout descriptorSetLayoutOverride,
+        VkPipeline& pipeline,
+        VkPipelineLayout& pipelineLayout,
+        uint32_t pushConstantSize,
+        VkPipelineCache cache,
+        bool* cacheHit = nullptr);
+
 	VulkanContext* context;
 
 
 	VkRenderPass renderPass;
 
-	VkPipelineCache pipelineCache;
+	mutable std::mutex psoMutex;
+	std::unordered_map<GraphicsPipelineKey, std::unique_ptr<CachedPipeline>, GraphicsPipelineKeyHash> psoCache;
+    std::unordered_map<ComputePipelineKey, std::unique_ptr<CachedPipeline>, ComputePipelineKeyHash> computeCache;
+
+    // Library parts, one cache per PipelineLibraryPart, keyed by MakeLibraryKey
+    std::mutex libraryMutex;
+    std::array<std::unordered_map<GraphicsPipelineKey, PipelineLibrary, GraphicsPipelineKeyHash>, PIPELINE_LIBRARY_PART_COUNT> libraryCache;
+
+    // Async pipeline requests; a deque keeps request addresses stable, the handle id is the index
+    std::mutex asyncMutex;
+    std::condition_variable asyncCondition;
+    std::deque<AsyncRequest> asyncRequests;
+    std::unordered_map<GraphicsPipelineKey, uint32_t, GraphicsPipelineKeyHash> asyncRequestIds;
+    std::deque<AsyncRequest*> asyncQueue;
+    std::vector<std::thread> asyncWorkers;
+    bool stopAsyncWorkers = false;
+
+    // Background link-time optimization of fast-linked pipelines
+    std::thread optimizerThread;
+    std::mutex optimizerMutex;
+    std::condition_variable optimizerCondition;
+    std::condition_variable optimizerIdleCondition;
+    std::deque<OptimizeJob> optimizeJobs;
+    std::vector<std::pair<GraphicsPipelineKey, VkPipeline>> optimizedPipelines;
+    bool optimizerBusy = false;
+    bool stopOptimizer = false;
 
 };
 #endif
\ No newline at end of file
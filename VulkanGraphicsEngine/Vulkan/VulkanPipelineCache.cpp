@@ -0,0 +1,253 @@
+#include "VulkanPipelineCache.h"
+#include "VulkanContext.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+static constexpr uint32_t PIPELINE_CACHE_FILE_MAGIC = 0x43504B56; // "VKPC"
+static constexpr uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+// FNV-1a, only used to detect corrupted or truncated cache files
+static uint64_t HashCacheData(const uint8_t* data, size_t size)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+void VulkanPipelineCache::Initialize()
+{
+	deviceProperties = context->GetDeviceProperties();
+
+	std::ostringstream name;
+	name << "pipeline_cache_" << std::hex << std::setfill('0')
+		<< std::setw(4) << deviceProperties.vendorID << "_"
+		<< std::setw(4) << deviceProperties.deviceID << "_"
+		<< std::setw(8) << deviceProperties.driverVersion << "_";
+	for (uint32_t i = 0; i < VK_UUID_SIZE; ++i)
+	{
+		name << std::setw(2) << static_cast<uint32_t>(deviceProperties.pipelineCacheUUID[i]);
+	}
+	name << ".bin";
+	filePath = name.str();
+
+	initialData = LoadCacheData();
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = initialData.size();
+	cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+	if (vkCreatePipelineCache(context->GetDevice(), &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+	{
+		// The driver may still reject data that passed our checks, fall back to an empty cache
+		initialData.clear();
+		cacheInfo.initialDataSize = 0;
+		cacheInfo.pInitialData = nullptr;
+
+		if (vkCreatePipelineCache(context->GetDevice(), &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create pipeline cache!");
+		}
+	}
+
+	if (initialData.empty())
+	{
+		std::cout << "Created new pipeline cache (" << filePath << ")." << std::endl;
+	}
+	else
+	{
+		std::cout << "Loaded pipeline cache " << filePath << " (" << initialData.size() << " bytes)." << std::endl;
+	}
+}
+
+VkPipelineCache VulkanPipelineCache::CreateWorkerCache()
+{
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = initialData.size();
+	cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+	VkPipelineCache workerCache = VK_NULL_HANDLE;
+	if (vkCreatePipelineCache(context->GetDevice(), &cacheInfo, nullptr, &workerCache) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create worker pipeline cache!");
+	}
+
+	return workerCache;
+}
+
+void VulkanPipelineCache::MergeWorkerCaches(const std::vector<VkPipelineCache>& workerCaches)
+{
+	std::vector<VkPipelineCache> sources;
+	sources.reserve(workerCaches.size());
+	for (VkPipelineCache cache : workerCaches)
+	{
+		if (cache != VK_NULL_HANDLE) sources.push_back(cache);
+	}
+
+	if (!sources.empty())
+	{
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		if (vkMergePipelineCaches(context->GetDevice(), pipelineCache, static_cast<uint32_t>(sources.size()), sources.data()) != VK_SUCCESS)
+		{
+			std::cerr << "Failed to merge worker pipeline caches." << std::endl;
+		}
+	}
+
+	for (VkPipelineCache cache : sources)
+	{
+		vkDestroyPipelineCache(context->GetDevice(), cache, nullptr);
+	}
+}
+
+bool VulkanPipelineCache::Save()
+{
+	if (pipelineCache == VK_NULL_HANDLE) {
+		return false;
+	}
+
+	std::vector<uint8_t> cacheData;
+	{
+		// Reading the data does not need external synchronization, only a merge must not run meanwhile
+		std::shared_lock<std::shared_mutex> lock(mutex);
+
+		size_t cacheSize = 0;
+		if (vkGetPipelineCacheData(context->GetDevice(), pipelineCache, &cacheSize, nullptr) != VK_SUCCESS || cacheSize == 0) {
+			std::cerr << "Failed to get pipeline cache data or cache is empty." << std::endl;
+			return false;
+		}
+
+		cacheData.resize(cacheSize);
+		if (vkGetPipelineCacheData(context->GetDevice(), pipelineCache, &cacheSize, cacheData.data()) != VK_SUCCESS) {
+			std::cerr << "Failed to retrieve pipeline cache data." << std::endl;
+			return false;
+		}
+		cacheData.resize(cacheSize);
+	}
+
+	FileHeader header{};
+	header.magic = PIPELINE_CACHE_FILE_MAGIC;
+	header.version = PIPELINE_CACHE_FILE_VERSION;
+	header.vendorID = deviceProperties.vendorID;
+	header.deviceID = deviceProperties.deviceID;
+	header.driverVersion = deviceProperties.driverVersion;
+	std::memcpy(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = cacheData.size();
+	header.dataHash = HashCacheData(cacheData.data(), cacheData.size());
+
+	const std::string tempPath = filePath + ".tmp";
+	{
+		std::ofstream cacheFile(tempPath, std::ios::binary | std::ios::trunc);
+		if (!cacheFile.is_open()) {
+			std::cerr << "Failed to open pipeline cache file for writing." << std::endl;
+			return false;
+		}
+
+		cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		cacheFile.write(reinterpret_cast<const char*>(cacheData.data()), static_cast<std::streamsize>(cacheData.size()));
+		cacheFile.flush();
+
+		if (!cacheFile.good()) {
+			std::cerr << "Error occurred while writing pipeline cache file." << std::endl;
+			cacheFile.close();
+			std::error_code ignored;
+			std::filesystem::remove(tempPath, ignored);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, filePath, error);
+	if (error) {
+		std::cerr << "Failed to replace pipeline cache file: " << error.message() << std::endl;
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	std::cout << "Pipeline cache saved successfully (" << cacheData.size() << " bytes)." << std::endl;
+	return true;
+}
+
+void VulkanPipelineCache::CleanupPipelineCache()
+{
+	if (pipelineCache == VK_NULL_HANDLE) {
+		return;
+	}
+
+	Save();
+	vkDestroyPipelineCache(context->GetDevice(), pipelineCache, nullptr);
+	pipelineCache = VK_NULL_HANDLE;
+	initialData.clear();
+}
+
+std::vector<uint8_t> VulkanPipelineCache::LoadCacheData() const
+{
+	std::ifstream cacheFile(filePath, std::ios::binary | std::ios::ate);
+	if (!cacheFile.is_open()) {
+		return {}; // No cache for this device yet
+	}
+
+	const size_t fileSize = static_cast<size_t>(cacheFile.tellg());
+	if (fileSize < sizeof(FileHeader)) {
+		std::cerr << "Pipeline cache file is truncated, ignoring it." << std::endl;
+		return {};
+	}
+
+	cacheFile.seekg(0, std::ios::beg);
+
+	FileHeader header{};
+	cacheFile.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	const bool headerMatches =
+		header.magic == PIPELINE_CACHE_FILE_MAGIC &&
+		header.version == PIPELINE_CACHE_FILE_VERSION &&
+		header.vendorID == deviceProperties.vendorID &&
+		header.deviceID == deviceProperties.deviceID &&
+		header.driverVersion == deviceProperties.driverVersion &&
+		std::memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+		header.dataSize == fileSize - sizeof(FileHeader);
+
+	if (!cacheFile.good() || !headerMatches) {
+		std::cerr << "Pipeline cache file does not match this device or driver, ignoring it." << std::endl;
+		return {};
+	}
+
+	std::vector<uint8_t> cacheData(static_cast<size_t>(header.dataSize));
+	cacheFile.read(reinterpret_cast<char*>(cacheData.data()), static_cast<std::streamsize>(cacheData.size()));
+
+	if (!cacheFile.good() || HashCacheData(cacheData.data(), cacheData.size()) != header.dataHash) {
+		std::cerr << "Pipeline cache file is corrupted, ignoring it." << std::endl;
+		return {};
+	}
+
+	if (!IsCompatibleCacheData(cacheData)) {
+		std::cerr << "Pipeline cache data header does not match this device, ignoring it." << std::endl;
+		return {};
+	}
+
+	return cacheData;
+}
+
+bool VulkanPipelineCache::IsCompatibleCacheData(const std::vector<uint8_t>& data) const
+{
+	if (data.size() < sizeof(VkPipelineCacheHeaderVersionOne)) {
+		return false;
+	}
+
+	VkPipelineCacheHeaderVersionOne cacheHeader{};
+	std::memcpy(&cacheHeader, data.data(), sizeof(cacheHeader));
+
+	return cacheHeader.headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) &&
+		cacheHeader.headerSize <= data.size() &&
+		cacheHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		cacheHeader.vendorID == deviceProperties.vendorID &&
+		cacheHeader.deviceID == deviceProperties.deviceID &&
+		std::memcmp(cacheHeader.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
@@ -0,0 +1,105 @@
+#ifndef VULKAN_PIPELINE_CACHE_H
+#define VULKAN_PIPELINE_CACHE_H
+
+#include "VulkanUtils.h"
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+class VulkanContext;
+
+// Engine-wide VkPipelineCache persisted to disk.
+// The file name is derived from the vendor/device ID, driver version and pipelineCacheUUID of the
+// physical device, so switching GPUs or drivers never feeds a foreign blob to the driver. The blob
+// is prefixed with a small header that is validated (together with the Vulkan cache header) on load.
+// Worker threads compile into their own caches which are merged back with vkMergePipelineCaches.
+// The merge needs the shared cache externally synchronized, so every pipeline creation against
+// GetHandle() holds LockShared() and the merge takes the same lock exclusively.
+class VulkanPipelineCache final
+{
+public:
+	explicit VulkanPipelineCache(VulkanContext* context) : context(context) {}
+	~VulkanPipelineCache() = default;
+
+	VulkanPipelineCache(const VulkanPipelineCache&) = delete;
+	VulkanPipelineCache& operator=(const VulkanPipelineCache&) = delete;
+
+	//**
+	// Loads the cache file for the current device, or creates an empty cache if there is no valid one
+	//**
+	void Initialize();
+
+	//**
+	// Returns the shared cache handle
+	//**
+	VkPipelineCache GetHandle() const { return pipelineCache; }
+
+	//**
+	// Held around every vkCreate*Pipelines call that passes GetHandle(). Creations still run
+	// concurrently, only MergeWorkerCaches waits for them.
+	//**
+	std::shared_lock<std::shared_mutex> LockShared() { return std::shared_lock<std::shared_mutex>(mutex); }
+
+	//**
+	// Returns the path of the cache file for the current device
+	//**
+	const std::string& GetFilePath() const { return filePath; }
+
+	//**
+	// Creates a cache for a single worker thread, seeded with the data loaded from disk
+	//**
+	VkPipelineCache CreateWorkerCache();
+
+	//**
+	// Merges the worker caches into the shared cache and destroys them. Waits until no thread
+	// holds LockShared().
+	//**
+	void MergeWorkerCaches(const std::vector<VkPipelineCache>& workerCaches);
+
+	//**
+	// Writes the cache to disk. The data goes to a temporary file first and is then renamed
+	// over the old one, so a crash mid-write never leaves a truncated cache behind.
+	//**
+	bool Save();
+
+	//**
+	// Saves and destroys the cache
+	//**
+	void CleanupPipelineCache();
+
+private:
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+		uint64_t dataHash;
+	};
+
+	//**
+	// Reads and validates the cache file, returns the driver blob or an empty vector
+	//**
+	std::vector<uint8_t> LoadCacheData() const;
+
+	//**
+	// Checks the VkPipelineCacheHeaderVersionOne at the start of the driver blob against the current device
+	//**
+	bool IsCompatibleCacheData(const std::vector<uint8_t>& data) const;
+
+	VulkanContext* context;
+
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties deviceProperties{};
+	std::string filePath;
+
+	// Blob the shared cache was created from, used to seed worker caches
+	std::vector<uint8_t> initialData;
+
+	std::shared_mutex mutex;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include "VulkanRenderer.h"
 
 #include <syncstream>
+#include <algorithm>
 
 #include "VulkanSwapChain.h"
 #include "VulkanPipeline.h"
@@ -8,6 +9,7 @@
 #include "VulkanTexture.h"
 #include "VulkanUniformBuffer.h"
 #include "VulkanDescriptorManager.h"
+#include "VulkanBindlessTextures.h"
 #include "VulkanSyncObjects.h"
 #include "WindowManager.h"
 #include "VulkanContext.h"
@@ -16,6 +18,14 @@
 #include "Image.h"
 #include "HDRManager.h"
 #include "GBufferManager.h"
+#include "VulkanGpuProfiler.h"
+#include "LightManager.h"
+#include "IndirectDrawManager.h"
+#include "HiZManager.h"
+#include "MathHelpers.h"
+
+#include <iomanip>
+#include <random>
 
 #define IMGUI_DEFINE_MATH_OPERATORS
 #include <imgui.h>
@@ -29,6 +39,35 @@ const uint32_t HEIGHT = 600;
 
 static float FPS = 0;
 
+// Deterministic cloud of small point lights around the model, for the lighting benchmark
+static std::vector<PointLight> GenerateBenchmarkLights(uint32_t count)
+{
+	std::mt19937 generator(1337);
+	std::uniform_real_distribution<float> position(-2.0f, 2.0f);
+	std::uniform_real_distribution<float> channel(0.2f, 1.0f);
+	std::uniform_real_distribution<float> radius(0.2f, 0.8f);
+
+	std::vector<PointLight> benchmarkLights(count);
+	for (PointLight& light : benchmarkLights)
+	{
+		light.position = { position(generator), position(generator), position(generator) };
+		light.color = { channel(generator), channel(generator), channel(generator) };
+		light.radius = radius(generator);
+		light.lumen = 2.0f;
+	}
+	return benchmarkLights;
+}
+
+static const char* LightingPathName(LightingPath path)
+{
+	switch (path)
+	{
+	case LightingPath::TiledCompute: return "tiled";
+	case LightingPath::LightVolumes: return "volumes";
+	case LightingPath::Fullscreen:
+	default: return "fullscreen";
+	}
+}
 
 
 
@@ -48,7 +87,12 @@ VulkanRenderer::~VulkanRenderer()
 	delete uniformBuffer;
 	delete syncObjects;
 	delete descriptorManager;
+	delete bindlessTextures;
 	delete depthBuffer;
+	delete gpuProfiler;
+	delete lightManager;
+	delete indirectDrawManager;
+	delete hiZManager;
 	delete context;
 }
 
@@ -67,7 +111,6 @@ void VulkanRenderer::CreateVulkanManagers()
 	context = new VulkanContext(window->GetWindow());
 	swapchain = new VulkanSwapchain(context);
 	pipeline = new VulkanPipeline(context);
-	hdrPipeline = new VulkanPipeline(context);
 	texture = new VulkanTexture(context);
 
 	meshes.push_back(new Mesh(context));
@@ -75,17 +118,16 @@ void VulkanRenderer::CreateVulkanManagers()
 	uniformBuffer = new VulkanUniformBuffer(context);
 	depthBuffer = new VulkanDepthBuffer(context);
 	descriptorManager = new VulkanDescriptorManager(context);
+	bindlessTextures = new VulkanBindlessTextures(context);
 	commandBuffer = new VulkanCommandBuffer(context);
 	syncObjects = new VulkanSyncObjects(context);
 	hdrManager = new HDRManager(context, swapchain, pipeline, descriptorManager);
-	pipelineConfig = new PipelineInfo();
-	hdrPipelineConfig = new PipelineInfo();
-	hdrPipeline = new VulkanPipeline(context);
-	lightingPipeline = new VulkanPipeline(context);
-	lightingPipelineConfig = new PipelineInfo();
 
 	gBufferManager = new GBufferManager(context);
-	gBufferPipeline = new VulkanPipeline(context);
+	gpuProfiler = new VulkanGpuProfiler(context);
+	lightManager = new LightManager(context);
+	indirectDrawManager = new IndirectDrawManager(context);
+	hiZManager = new HiZManager(context);
 }
 
 void VulkanRenderer::InitVulkan()
@@ -97,124 +139,198 @@ void VulkanRenderer::InitVulkan()
 
 	hdrManager->Initialize();
 
-	gBufferManager->Initialize(swapchain->GetSwapChainExtent(),1);
+	gBufferManager->Initialize(swapchain->GetSwapChainExtent());
 	gBufferManager->CreateGBufferResources(swapchain->GetSwapChainExtent());
 
 	float aspectRatio = (float)swapchain->GetSwapChainExtent().width / swapchain->GetSwapChainExtent().height;
 	camera->InitCamera(aspectRatio, 45.0f, { 0.0f, 0.0f, 3.0f });
 
-	lights.push_back({ { 20.0f, 10.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } , 100,10 });
-	lights.push_back({ { 10.0f, 5.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } ,100,20});
-	lights.push_back({ { -10.0f, 5.0f, 0.0f }, { 0.0f, 0.0f, 1.0f },100,3 });
-	lights.push_back({ { 0.0f, 5.0f, 10.0f }, { 1.0f, 1.0f, 1.0f },100,8000 });
+	lightManager->Initialize();
+	lightManager->AddLight({ { 20.0f, 10.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } , 100,10 });
+	lightManager->AddLight({ { 10.0f, 5.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } ,100,20});
+	lightManager->AddLight({ { -10.0f, 5.0f, 0.0f }, { 0.0f, 0.0f, 1.0f },100,3 });
+	lightManager->AddLight({ { 0.0f, 5.0f, 10.0f }, { 1.0f, 1.0f, 1.0f },100,8000 });
 
 	dirLight.direction = { -0.5f, -1, -0.3};
 	dirLight.color = { 1.0f, 1.0f, 1.0f };
 	dirLight.lux = 50000.f; 
 
-	std::vector<VkDescriptorPoolSize> poolSize = {
-		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, MAX_FRAMES_IN_FLIGHT * 3}, // 3 -> amount of uniform buffers
-		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_FRAMES_IN_FLIGHT * (7 + 1 + 5)}, // 7 -> amount of samplers + 2 for imgui
-	};
-
-	uint32_t maxTotalSets = MAX_FRAMES_IN_FLIGHT * 3; 
+	// Pools are chained by the descriptor manager as sets are allocated, nothing to size here
+	descriptorManager->Initialize();
 
-	descriptorManager->CreateDescriptorPool(poolSize, maxTotalSets,VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
-
-	std::vector<VkDescriptorSetLayoutBinding> globalBinding{
-		{0,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,1,VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,nullptr},
-		{1,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,1,VK_SHADER_STAGE_VERTEX_BIT,nullptr},
-		{2,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1,VK_SHADER_STAGE_FRAGMENT_BIT,nullptr},
-		{3,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1,VK_SHADER_STAGE_FRAGMENT_BIT,nullptr},
-		{4,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1,VK_SHADER_STAGE_FRAGMENT_BIT,nullptr},
-		{5,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1,VK_SHADER_STAGE_FRAGMENT_BIT,nullptr},
-		{6,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1,VK_SHADER_STAGE_FRAGMENT_BIT,nullptr},
-		{7,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1,VK_SHADER_STAGE_FRAGMENT_BIT,nullptr},
-		{8,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,1,VK_SHADER_STAGE_FRAGMENT_BIT,nullptr}
+	std::vector<VkFormat> gBufferFormats = {
+		gBufferManager->GetAlbedoImageFormat(),
+		gBufferManager->GetNormalImageFormat(),
+		gBufferManager->GetMetallicRoughnessImageFormat(),
 	};
-	 globalLayout = descriptorManager->CreateDescriptorSetLayout(globalBinding);
-
-	 std::vector<VkDescriptorSetLayoutBinding> HDRDescriptorSetBinding{
 
-		{0,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1,VK_SHADER_STAGE_FRAGMENT_BIT,nullptr}
-	 };
+	// Pipelines are described by keys; the PSO cache in `pipeline` owns the compiled handles.
+	// Descriptor set layouts and push-constant ranges are reflected from the shaders.
+	usePushDescriptors = context->GetOptionalFeatures().pushDescriptor;
+
+	gBufferPipelineKey.name = "gbuffer";
+	gBufferPipelineKey.SetShaders("Shaders/shader.vert.spv", "Shaders/shader.frag.spv")
+		.SetColorFormats(gBufferFormats)
+		.SetPushConstant<PushConstantData>();
+	gBufferPipelineKey.vertexLayout = PipelineVertexLayout::Mesh;
+	gBufferPipelineKey.depthAttachmentFormat = VulkanUtils::FindDepthFormat(context->GetPhysicalDevice());
+	gBufferPipelineKey.samples = context->GetMsaaSamples();
+	gBufferPipelineKey.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+	// After a depth pre-pass every visible sample already holds its final depth, the G-buffer only
+	// shades the samples that match it. No sample shading in the pre-pass, it has no fragment work.
+	depthPrepassPipelineKey.name = "depth_prepass";
+	depthPrepassPipelineKey.SetShaders("Shaders/depth_prepass.vert.spv", "Shaders/depth_prepass.frag.spv")
+		.SetPushConstant<PushConstantData>();
+	depthPrepassPipelineKey.vertexLayout = PipelineVertexLayout::Mesh;
+	depthPrepassPipelineKey.depthAttachmentFormat = gBufferPipelineKey.depthAttachmentFormat;
+	depthPrepassPipelineKey.samples = context->GetMsaaSamples();
+	depthPrepassPipelineKey.sampleShading = false;
+	depthPrepassPipelineKey.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+	gBufferDepthEqualPipelineKey = gBufferPipelineKey;
+	gBufferDepthEqualPipelineKey.name = "gbuffer_depth_equal";
+	gBufferDepthEqualPipelineKey.depthWrite = false;
+	gBufferDepthEqualPipelineKey.depthCompareOp = VK_COMPARE_OP_EQUAL;
+
+	lightingPipelineKey.name = "lighting";
+	lightingPipelineKey.SetShaders("Shaders/fullscreen_quad.vert.spv", "Shaders/lighting.frag.spv")
+		.SetColorFormats({ VK_FORMAT_R32G32B32A32_SFLOAT })
+		.SetPushConstant<ScreenSizePush>();
+	lightingPipelineKey.vertexLayout = PipelineVertexLayout::None;
+	lightingPipelineKey.samples = context->GetMsaaSamples();
+	lightingPipelineKey.depthTest = false;
+	lightingPipelineKey.depthWrite = false;
+	lightingPipelineKey.pushDescriptorSet = usePushDescriptors;
+	lightingPipelineKey.SetSpecialization(VK_SHADER_STAGE_FRAGMENT_BIT, LIGHTING_SPEC_DIRECTIONAL_LIGHT, VK_TRUE)
+		.SetSpecialization(VK_SHADER_STAGE_FRAGMENT_BIT, LIGHTING_SPEC_AMBIENT_OCCLUSION, VK_TRUE);
+
+	// Light volumes share one rendering instance with the multisampled G-buffer depth bound, so the
+	// full-screen ambient pass has to declare the depth format as well
+	lightingAmbientPipelineKey = lightingPipelineKey;
+	lightingAmbientPipelineKey.name = "lighting_ambient";
+	lightingAmbientPipelineKey.depthAttachmentFormat = VulkanUtils::FindDepthFormat(context->GetPhysicalDevice());
+	lightingAmbientPipelineKey.SetSpecialization(VK_SHADER_STAGE_FRAGMENT_BIT, LIGHTING_SPEC_POINT_LIGHTS, VK_FALSE);
+
+	// Back faces that lie behind the stored surface depth: the surface is in front of the volume's
+	// far side, which rejects everything behind the light and still works with the camera inside.
+	// The G-buffer is already resolved, so shading once per pixel is enough.
+	lightVolumePipelineKey.name = "light_volume";
+	lightVolumePipelineKey.SetShaders("Shaders/light_volume.vert.spv", "Shaders/light_volume.frag.spv")
+		.SetColorFormats({ VK_FORMAT_R32G32B32A32_SFLOAT })
+		.SetPushConstant<ScreenSizePush>();
+	lightVolumePipelineKey.vertexLayout = PipelineVertexLayout::None;
+	lightVolumePipelineKey.samples = context->GetMsaaSamples();
+	lightVolumePipelineKey.sampleShading = false;
+	lightVolumePipelineKey.cullMode = VK_CULL_MODE_FRONT_BIT;
+	lightVolumePipelineKey.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	lightVolumePipelineKey.depthAttachmentFormat = VulkanUtils::FindDepthFormat(context->GetPhysicalDevice());
+	lightVolumePipelineKey.depthWrite = false;
+	lightVolumePipelineKey.depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;
+	lightVolumePipelineKey.blendMode = PipelineBlendMode::Additive;
+	lightVolumePipelineKey.pushDescriptorSet = usePushDescriptors;
+
+	// Writes the single-sample HDR resolve image directly, so it skips the multisampled HDR target
+	tiledLightingPipelineKey.name = "tiled_lighting";
+	tiledLightingPipelineKey.SetShader("Shaders/tiled_lighting.comp.spv")
+		.SetPushConstant<TiledLightingPush>()
+		.SetSpecialization(LIGHTING_SPEC_DIRECTIONAL_LIGHT, VK_TRUE)
+		.SetSpecialization(LIGHTING_SPEC_AMBIENT_OCCLUSION, VK_TRUE);
+	tiledLightingPipelineKey.pushDescriptorSet = usePushDescriptors;
+	tiledLightingSupported = TILED_LIGHTING_SHARED_MEMORY_SIZE <= context->GetDeviceProperties().limits.maxComputeSharedMemorySize;
+	if (!tiledLightingSupported) {
+		std::cout << "Tiled lighting disabled, it needs " << TILED_LIGHTING_SHARED_MEMORY_SIZE
+			<< " bytes of compute shared memory" << std::endl;
+		lightingPath = LightingPath::Fullscreen;
+	}
 
-	 hdrDescriptorSetLayout = descriptorManager->CreateDescriptorSetLayout(HDRDescriptorSetBinding);
+	// Clustered forward+: lights are binned into froxels, then every mesh is shaded in one MSAA pass
+	// straight into the HDR target. Set 1 is the same bindless set the G-buffer pass binds.
+	clusterLightsPipelineKey.name = "cluster_lights";
+	clusterLightsPipelineKey.SetShader("Shaders/cluster_lights.comp.spv");
+	clusterLightsPipelineKey.pushDescriptorSet = usePushDescriptors;
+
+	cullPipelineKey.name = "cull_objects";
+	cullPipelineKey.SetShader("Shaders/cull_objects.comp.spv")
+		.SetPushConstant<CullPush>();
+	cullPipelineKey.pushDescriptorSet = usePushDescriptors;
+
+	// Two-phase occlusion culling: the early phase draws last frame's visible set, hiz_build.comp
+	// reduces that depth into the Hi-Z pyramid, the late phase tests everything against it
+	occlusionCullPipelineKey.name = "cull_occlusion";
+	occlusionCullPipelineKey.SetShader("Shaders/cull_occlusion.comp.spv")
+		.SetPushConstant<OcclusionCullPush>();
+	occlusionCullPipelineKey.pushDescriptorSet = usePushDescriptors;
+
+	hiZBuildPipelineKey.name = "hiz_build";
+	hiZBuildPipelineKey.SetShader("Shaders/hiz_build.comp.spv")
+		.SetPushConstant<HiZBuildPush>();
+	hiZBuildPipelineKey.pushDescriptorSet = usePushDescriptors;
+
+	forwardPipelineKey.name = "forward";
+	forwardPipelineKey.SetShaders("Shaders/shader.vert.spv", "Shaders/forward.frag.spv")
+		.SetColorFormats({ VK_FORMAT_R32G32B32A32_SFLOAT })
+		.SetPushConstant<PushConstantData>()
+		.SetSpecialization(VK_SHADER_STAGE_FRAGMENT_BIT, LIGHTING_SPEC_DIRECTIONAL_LIGHT, VK_TRUE)
+		.SetSpecialization(VK_SHADER_STAGE_FRAGMENT_BIT, LIGHTING_SPEC_AMBIENT_OCCLUSION, VK_TRUE);
+	forwardPipelineKey.vertexLayout = PipelineVertexLayout::Mesh;
+	forwardPipelineKey.depthAttachmentFormat = VulkanUtils::FindDepthFormat(context->GetPhysicalDevice());
+	forwardPipelineKey.samples = context->GetMsaaSamples();
+	forwardPipelineKey.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	forwardPipelineKey.pushDescriptorSet = usePushDescriptors;
+
+	std::vector<GraphicsPipelineKey> startupKeys = { gBufferPipelineKey, depthPrepassPipelineKey, gBufferDepthEqualPipelineKey,
+		lightingPipelineKey, lightingAmbientPipelineKey, lightVolumePipelineKey, forwardPipelineKey };
+	for (uint32_t op = 0; op < tonemapPipelineKeys.size(); ++op)
+	{
+		GraphicsPipelineKey& key = tonemapPipelineKeys[op];
+		key.name = "tonemap_" + std::to_string(op);
+		key.SetShaders("Shaders/tonemap.vert.spv", "Shaders/tonemap.frag.spv")
+			.SetColorFormats({ swapchain->GetSwapChainImageFormat() })
+			.SetPushConstant<ToneMapPush>()
+			.SetSpecialization(VK_SHADER_STAGE_FRAGMENT_BIT, TONEMAP_SPEC_OPERATOR, op);
+		key.vertexLayout = PipelineVertexLayout::None;
+		key.samples = VK_SAMPLE_COUNT_1_BIT;
+		key.depthTest = false;
+		key.depthWrite = false;
+		key.pushDescriptorSet = usePushDescriptors;
+	}
 
-	 std::vector<VkDescriptorSetLayoutBinding> lightingDescriptorSetBinding{
-		{0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}, 
-		{1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
-		{2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}, 
-		{3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}, 
-		{4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}, 
-		{8, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}, 
-		{9, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}  
-	 };
-	 lightingDescriptorSetLayout = descriptorManager->CreateDescriptorSetLayout(lightingDescriptorSetBinding);
+	currentTonemapOperator = std::clamp(currentTonemapOperator, 0, static_cast<int>(tonemapPipelineKeys.size()) - 1);
+	const GraphicsPipelineKey& defaultTonemapKey = tonemapPipelineKeys[currentTonemapOperator];
+	startupKeys.push_back(defaultTonemapKey);
 
+	// Compile everything the first frame needs up front, in parallel
+	pipeline->PrecompilePipelines(startupKeys);
 
-	 std::vector<VkFormat> gBufferFormats = {
-	  gBufferManager->GetAlbedoImageFormat(),       
-	  gBufferManager->GetAOImageFormat(),           
-	  gBufferManager->GetNormalImageFormat(),       
-	  gBufferManager->GetMetallicRoughnessImageFormat(), 
-	  VK_FORMAT_R32G32B32A32_SFLOAT
-	 };
+	// The other operators are not needed yet, compile them without holding up startup or a frame
+	for (size_t op = 0; op < tonemapPipelineKeys.size(); ++op)
+	{
+		tonemapPipelineHandles[op] = pipeline->RequestPipelineAsync(tonemapPipelineKeys[op], defaultTonemapKey);
+	}
 
-	
-	 pipelineConfig->colorAttachmentFormats = gBufferFormats;
-	 pipeline->DefaultPipelineConfig(*pipelineConfig,pipelineConfig->colorAttachmentFormats); 
-
-
-	 pipelineConfig->depthStencilInfo.depthTestEnable = VK_TRUE; 
-	 pipelineConfig->depthStencilInfo.depthWriteEnable = VK_TRUE;
-	 pipelineConfig->depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL; 
-	 pipelineConfig->depthAttachmentFormat = VulkanUtils::FindDepthFormat(context->GetPhysicalDevice()); 
-	 pipelineConfig->stencilAttachmentFormat = VK_FORMAT_UNDEFINED; 
-
-	 pipelineConfig->colorBlendAttachments.resize(gBufferFormats.size());
-	 for (auto& attachment : pipelineConfig->colorBlendAttachments) {
-		 attachment.blendEnable = VK_FALSE;
-		 attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-			 VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	 }
-
-	 pipelineConfig->colorBlendInfo.attachmentCount = static_cast<uint32_t>(pipelineConfig->colorBlendAttachments.size());
-	 pipelineConfig->colorBlendInfo.pAttachments = pipelineConfig->colorBlendAttachments.data();
-	 pipeline->CreatePipelineCache()
-		 .CreateGraphicsPipeline<PushConstantData>("Shaders/shader.vert.spv", "Shaders/shader.frag.spv", *pipelineConfig, globalLayout, graphicsPipeline, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
-
-
-
-		std::vector<VkFormat> lightingformat = { VK_FORMAT_R32G32B32A32_SFLOAT };
-		lightingPipeline->DefaultPipelineConfig(*lightingPipelineConfig, lightingPipelineConfig->colorAttachmentFormats);
-		lightingPipelineConfig->inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-		lightingPipelineConfig->rasterizationInfo.cullMode = VK_CULL_MODE_NONE; 
-		lightingPipelineConfig->depthStencilInfo.depthTestEnable = VK_FALSE;
-		lightingPipelineConfig->depthStencilInfo.depthWriteEnable = VK_FALSE; 
-		lightingPipelineConfig->multisampleInfo.rasterizationSamples = context->GetMsaaSamples(); 
-		lightingPipelineConfig->bindingDescriptions = {}; 
-		lightingPipelineConfig->attributeDescriptions = {}; 
-		lightingPipelineConfig->colorAttachmentFormats = lightingformat; 
-		lightingPipelineConfig->depthAttachmentFormat = VK_FORMAT_UNDEFINED; 
-		lightingPipelineConfig->stencilAttachmentFormat = VK_FORMAT_UNDEFINED; 
-		lightingPipeline->CreatePipelineCache()
-			.CreateGraphicsPipeline<ScreenSizePush>("Shaders/fullscreen_quad.vert.spv", "Shaders/lighting.frag.spv", *lightingPipelineConfig, lightingDescriptorSetLayout, lightingGraphicsPipeline, lightingPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT);
-
-		std::vector<VkFormat> hdrColorFormats = { swapchain->GetSwapChainImageFormat() };
-		hdrPipeline->DefaultPipelineConfig(*hdrPipelineConfig, hdrPipelineConfig->colorAttachmentFormats);
-		hdrPipelineConfig->multisampleInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT; 
-		hdrPipelineConfig->bindingDescriptions = {};
-		hdrPipelineConfig->attributeDescriptions = {};
-		hdrPipelineConfig->colorAttachmentFormats = hdrColorFormats;
-		hdrPipelineConfig->depthAttachmentFormat = VK_FORMAT_UNDEFINED;
-		hdrPipelineConfig->stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
-		hdrPipeline->CreatePipelineCache()
-			.CreateGraphicsPipeline<ToneMapPush>("Shaders/tonemap.vert.spv", "Shaders/tonemap.frag.spv", *hdrPipelineConfig, hdrDescriptorSetLayout, HdrGraphicsPipeline, hdrPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT);
+	globalLayout = pipeline->GetPipeline(gBufferPipelineKey).setLayouts[0];
+	bindlessTextures->Initialize(pipeline->GetPipeline(gBufferPipelineKey).setLayouts[BINDLESS_SET]);
+	lightingDescriptorSetLayout = pipeline->GetPipeline(lightingPipelineKey).setLayouts[0];
+	if (tiledLightingSupported) {
+		tiledLightingDescriptorSetLayout = pipeline->GetComputePipeline(tiledLightingPipelineKey).setLayouts[0];
+	}
+	lightingAmbientDescriptorSetLayout = pipeline->GetPipeline(lightingAmbientPipelineKey).setLayouts[0];
+	lightVolumeDescriptorSetLayout = pipeline->GetPipeline(lightVolumePipelineKey).setLayouts[0];
+	clusterLightsDescriptorSetLayout = pipeline->GetComputePipeline(clusterLightsPipelineKey).setLayouts[0];
+	cullDescriptorSetLayout = pipeline->GetComputePipeline(cullPipelineKey).setLayouts[0];
+	// hiz_build.comp stores rg32f, which needs shaderStorageImageExtendedFormats
+	if (context->GetOptionalFeatures().occlusionCulling) {
+		occlusionCullDescriptorSetLayout = pipeline->GetComputePipeline(occlusionCullPipelineKey).setLayouts[0];
+		hiZBuildDescriptorSetLayout = pipeline->GetComputePipeline(hiZBuildPipelineKey).setLayouts[0];
+	}
+	forwardDescriptorSetLayout = pipeline->GetPipeline(forwardPipelineKey).setLayouts[0];
+	hdrDescriptorSetLayout = pipeline->GetPipeline(defaultTonemapKey).setLayouts[0];
 
 
 	swapchain->CreateColorResources();
 	depthBuffer->CreateDepthResources(swapchain->GetSwapChainExtent());
+	hiZManager->Initialize(swapchain->GetSwapChainExtent());
 
 	//modelLoader->LoadModel("Models/gltf/sponza/Sponza.gltf", meshes, context);
 	modelLoader->LoadModel("Models/gltf/flightHelmet/FlightHelmet.gltf", meshes,context);
@@ -222,7 +338,14 @@ void VulkanRenderer::InitVulkan()
 	for (Mesh* mesh : meshes)
 	{
 		mesh->CreateBuffers();
+		mesh->materialIndex = bindlessTextures->AddMaterial(mesh->GetMaterialTextures());
+	}
+
+	// Without draw indirect count every frame keeps drawing the meshes' own buffers from the CPU
+	if (context->GetOptionalFeatures().drawIndirectCount) {
+		indirectDrawManager->BuildScene(meshes);
 	}
+	RebuildMeshBounds();
 
 	uniformBuffer->InitBuffers();
 
@@ -235,69 +358,156 @@ void VulkanRenderer::InitVulkan()
 	std::vector<SceneLightingUBO> lightUboData;
 	lightUboData.resize(MAX_FRAMES_IN_FLIGHT);
 
-		globalDescriptorSet = descriptorManager->AllocateAndWriteDescriptorSets(globalLayout, MAX_FRAMES_IN_FLIGHT,
-		[&](uint32_t setIndex) {
-			std::vector<DescriptorBufferBinding> bufferBindings = {
-				{0, uniformBuffer->GetCameraUBOs()[setIndex].buffer, 0, sizeof(CameraUBO)},
-				{1, uniformBuffer->GetModelUBOs()[setIndex].buffer, 0, sizeof(ModelUBO)},
-				{8, uniformBuffer->GetSceneLightsUBOs()[setIndex].buffer, 0, sizeof(SceneLightingUBO)}
-			};
-			std::vector<DescriptorImageBinding> imageBindings = {
-			
-				{2, 0, meshes[0]->GetTexture(TextureType::ALBEDO).GetTextureImageView(),
-				meshes[0]->GetTexture(TextureType::ALBEDO).GetTextureSampler(),
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
-				{3, 0, meshes[0]->GetTexture(TextureType::NORMAL).GetTextureImageView(),
-				meshes[0]->GetTexture(TextureType::NORMAL).GetTextureSampler(),
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
-				{4, 0, meshes[0]->GetTexture(TextureType::METALLIC).GetTextureImageView(),
-				 meshes[0]->GetTexture(TextureType::METALLIC).GetTextureSampler(),
-				 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
-				{5, 0, meshes[0]->GetTexture(TextureType::ROUGHNESS).GetTextureImageView(),
-				 meshes[0]->GetTexture(TextureType::ROUGHNESS).GetTextureSampler(),
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
-				 {6, 0, meshes[0]->GetTexture(TextureType::AO).GetTextureImageView(),
-					meshes[0]->GetTexture(TextureType::AO).GetTextureSampler(),
-					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}
-			};
-			return std::make_pair(bufferBindings, imageBindings);
-		});
-
-		hdrDescriptorSet = descriptorManager->AllocateAndWriteDescriptorSets(hdrDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT,
-		[&](uint32_t setIndex) {
-			std::vector<DescriptorBufferBinding> bufferBindings = {};
-			std::vector<DescriptorImageBinding> imageBindings = {
-				{0, 0, hdrManager->GetHDRResolveView(),
-				hdrManager->GetHDRSampler(),
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}
-			};
-			return std::make_pair(bufferBindings, imageBindings);
-		});
-
-	lightingDescriptorSet = descriptorManager->AllocateAndWriteDescriptorSets(lightingDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT,
-		[&](uint32_t setIndex) {
-			std::vector<DescriptorBufferBinding> bufferBindings = {
-				{8, uniformBuffer->GetSceneLightsUBOs()[setIndex].buffer, 0, sizeof(SceneLightingUBO)},
-				{9, uniformBuffer->GetCameraUBOs()[setIndex].buffer, 0, sizeof(CameraUBO)}
-			};
-			std::vector<DescriptorImageBinding> imageBindings = {
-				{0, 0, gBufferManager->GetAlbedoImageResolveView(), gBufferManager->GetGBufferSampler(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
-				{1, 0, gBufferManager->GetAOImageResolveView(), gBufferManager->GetGBufferSampler(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
-				{2, 0, gBufferManager->GetNormalImageResolveView(), gBufferManager->GetGBufferSampler(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
-				{3, 0, gBufferManager->GetMetallicRoughnessImageResolveView(), gBufferManager->GetGBufferSampler(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
-				{4, 0, depthBuffer->GetDepthResolveImageView(), gBufferManager->GetGBufferSampler(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL}
-			};
-			return std::make_pair(bufferBindings, imageBindings);
-		});
-
+	CreateDescriptorSets();
 
 	commandBuffer->CreateCommandBuffers();
+	gpuProfiler->Initialize();
 
 	syncObjects->CreateSyncObjects();
 
 
 	glfwSetInputMode(window->GetWindow(), GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 	glfwSetMouseButtonCallback(window->GetWindow(), mouseButtonCallback);
+	glfwSetKeyCallback(window->GetWindow(), keyCallback);
+}
+
+void VulkanRenderer::CreateDescriptorSets()
+{
+	globalDescriptorTemplate = descriptorManager->GetOrCreateUpdateTemplate(globalLayout, {
+		DescriptorTemplateEntry::UniformBuffer(0, offsetof(GlobalDescriptorData, camera)),
+		DescriptorTemplateEntry::UniformBuffer(1, offsetof(GlobalDescriptorData, model)),
+	});
+
+	const std::vector<DescriptorTemplateEntry> lightingEntries = {
+		DescriptorTemplateEntry::CombinedImageSampler(0, offsetof(LightingDescriptorData, albedo)),
+		DescriptorTemplateEntry::CombinedImageSampler(1, offsetof(LightingDescriptorData, normal)),
+		DescriptorTemplateEntry::CombinedImageSampler(2, offsetof(LightingDescriptorData, metallicRoughness)),
+		DescriptorTemplateEntry::CombinedImageSampler(3, offsetof(LightingDescriptorData, depth)),
+		DescriptorTemplateEntry::UniformBuffer(8, offsetof(LightingDescriptorData, lights)),
+		DescriptorTemplateEntry::UniformBuffer(9, offsetof(LightingDescriptorData, camera)),
+		DescriptorTemplateEntry::StorageBuffer(10, offsetof(LightingDescriptorData, pointLights)),
+	};
+	// Same data, plus the HDR image the compute shader stores to
+	std::vector<DescriptorTemplateEntry> tiledLightingEntries = lightingEntries;
+	tiledLightingEntries.push_back(DescriptorTemplateEntry::StorageImage(4, offsetof(LightingDescriptorData, hdrOutput)));
+	// The directional light is left to the ambient pass, so the volumes do not read the lights UBO
+	const std::vector<DescriptorTemplateEntry> lightVolumeEntries = {
+		DescriptorTemplateEntry::CombinedImageSampler(0, offsetof(LightingDescriptorData, albedo)),
+		DescriptorTemplateEntry::CombinedImageSampler(1, offsetof(LightingDescriptorData, normal)),
+		DescriptorTemplateEntry::CombinedImageSampler(2, offsetof(LightingDescriptorData, metallicRoughness)),
+		DescriptorTemplateEntry::CombinedImageSampler(3, offsetof(LightingDescriptorData, depth)),
+		DescriptorTemplateEntry::UniformBuffer(9, offsetof(LightingDescriptorData, camera)),
+		DescriptorTemplateEntry::StorageBuffer(10, offsetof(LightingDescriptorData, pointLights)),
+	};
+	const std::vector<DescriptorTemplateEntry> clusterLightsEntries = {
+		DescriptorTemplateEntry::UniformBuffer(0, offsetof(ForwardDescriptorData, camera)),
+		DescriptorTemplateEntry::UniformBuffer(2, offsetof(ForwardDescriptorData, lights)),
+		DescriptorTemplateEntry::StorageBuffer(3, offsetof(ForwardDescriptorData, pointLights)),
+		DescriptorTemplateEntry::StorageBuffer(4, offsetof(ForwardDescriptorData, clusters)),
+		DescriptorTemplateEntry::UniformBuffer(5, offsetof(ForwardDescriptorData, clusterParams)),
+	};
+	const std::vector<DescriptorTemplateEntry> cullEntries = {
+		DescriptorTemplateEntry::StorageBuffer(0, offsetof(CullDescriptorData, objects)),
+		DescriptorTemplateEntry::StorageBuffer(1, offsetof(CullDescriptorData, drawCommands)),
+		DescriptorTemplateEntry::StorageBuffer(2, offsetof(CullDescriptorData, drawCount)),
+	};
+	// Frustum culling's bindings plus the visibility flags, the Hi-Z pyramid and the camera
+	std::vector<DescriptorTemplateEntry> occlusionCullEntries = cullEntries;
+	occlusionCullEntries.push_back(DescriptorTemplateEntry::StorageBuffer(3, offsetof(CullDescriptorData, visibility)));
+	occlusionCullEntries.push_back(DescriptorTemplateEntry::CombinedImageSampler(4, offsetof(CullDescriptorData, hiZ)));
+	occlusionCullEntries.push_back(DescriptorTemplateEntry::UniformBuffer(5, offsetof(CullDescriptorData, camera)));
+	const std::vector<DescriptorTemplateEntry> hiZBuildEntries = {
+		DescriptorTemplateEntry::CombinedImageSampler(0, offsetof(HiZBuildDescriptorData, source)),
+		DescriptorTemplateEntry::StorageImage(1, offsetof(HiZBuildDescriptorData, destination)),
+	};
+	// The forward pass also reads the model UBO in its vertex shader
+	std::vector<DescriptorTemplateEntry> forwardEntries = clusterLightsEntries;
+	forwardEntries.push_back(DescriptorTemplateEntry::UniformBuffer(1, offsetof(ForwardDescriptorData, model)));
+	const std::vector<DescriptorTemplateEntry> tonemapEntries = {
+		DescriptorTemplateEntry::CombinedImageSampler(0, offsetof(TonemapDescriptorData, hdr)),
+	};
+
+	// Tonemap variants share the set layout, so their pipeline layouts are compatible with the default one
+	if (usePushDescriptors) {
+		lightingDescriptorTemplate = descriptorManager->GetOrCreatePushDescriptorTemplate(lightingDescriptorSetLayout,
+			pipeline->GetPipeline(lightingPipelineKey).layout, 0, lightingEntries);
+		if (tiledLightingSupported) {
+			tiledLightingDescriptorTemplate = descriptorManager->GetOrCreatePushDescriptorTemplate(tiledLightingDescriptorSetLayout,
+				pipeline->GetComputePipeline(tiledLightingPipelineKey).layout, 0, tiledLightingEntries, VK_PIPELINE_BIND_POINT_COMPUTE);
+		}
+		lightingAmbientDescriptorTemplate = descriptorManager->GetOrCreatePushDescriptorTemplate(lightingAmbientDescriptorSetLayout,
+			pipeline->GetPipeline(lightingAmbientPipelineKey).layout, 0, lightingEntries);
+		lightVolumeDescriptorTemplate = descriptorManager->GetOrCreatePushDescriptorTemplate(lightVolumeDescriptorSetLayout,
+			pipeline->GetPipeline(lightVolumePipelineKey).layout, 0, lightVolumeEntries);
+		clusterLightsDescriptorTemplate = descriptorManager->GetOrCreatePushDescriptorTemplate(clusterLightsDescriptorSetLayout,
+			pipeline->GetComputePipeline(clusterLightsPipelineKey).layout, 0, clusterLightsEntries, VK_PIPELINE_BIND_POINT_COMPUTE);
+		cullDescriptorTemplate = descriptorManager->GetOrCreatePushDescriptorTemplate(cullDescriptorSetLayout,
+			pipeline->GetComputePipeline(cullPipelineKey).layout, 0, cullEntries, VK_PIPELINE_BIND_POINT_COMPUTE);
+		forwardDescriptorTemplate = descriptorManager->GetOrCreatePushDescriptorTemplate(forwardDescriptorSetLayout,
+			pipeline->GetPipeline(forwardPipelineKey).layout, 0, forwardEntries);
+		hdrDescriptorTemplate = descriptorManager->GetOrCreatePushDescriptorTemplate(hdrDescriptorSetLayout,
+			pipeline->GetPipeline(tonemapPipelineKeys[currentTonemapOperator]).layout, 0, tonemapEntries);
+	}
+	else {
+		lightingDescriptorTemplate = descriptorManager->GetOrCreateUpdateTemplate(lightingDescriptorSetLayout, lightingEntries);
+		if (tiledLightingSupported) {
+			tiledLightingDescriptorTemplate = descriptorManager->GetOrCreateUpdateTemplate(tiledLightingDescriptorSetLayout, tiledLightingEntries);
+		}
+		lightingAmbientDescriptorTemplate = descriptorManager->GetOrCreateUpdateTemplate(lightingAmbientDescriptorSetLayout, lightingEntries);
+		lightVolumeDescriptorTemplate = descriptorManager->GetOrCreateUpdateTemplate(lightVolumeDescriptorSetLayout, lightVolumeEntries);
+		clusterLightsDescriptorTemplate = descriptorManager->GetOrCreateUpdateTemplate(clusterLightsDescriptorSetLayout, clusterLightsEntries);
+		cullDescriptorTemplate = descriptorManager->GetOrCreateUpdateTemplate(cullDescriptorSetLayout, cullEntries);
+		forwardDescriptorTemplate = descriptorManager->GetOrCreateUpdateTemplate(forwardDescriptorSetLayout, forwardEntries);
+		hdrDescriptorTemplate = descriptorManager->GetOrCreateUpdateTemplate(hdrDescriptorSetLayout, tonemapEntries);
+	}
+
+	if (context->GetOptionalFeatures().occlusionCulling) {
+		if (usePushDescriptors) {
+			occlusionCullDescriptorTemplate = descriptorManager->GetOrCreatePushDescriptorTemplate(occlusionCullDescriptorSetLayout,
+				pipeline->GetComputePipeline(occlusionCullPipelineKey).layout, 0, occlusionCullEntries, VK_PIPELINE_BIND_POINT_COMPUTE);
+			hiZBuildDescriptorTemplate = descriptorManager->GetOrCreatePushDescriptorTemplate(hiZBuildDescriptorSetLayout,
+				pipeline->GetComputePipeline(hiZBuildPipelineKey).layout, 0, hiZBuildEntries, VK_PIPELINE_BIND_POINT_COMPUTE);
+		}
+		else {
+			occlusionCullDescriptorTemplate = descriptorManager->GetOrCreateUpdateTemplate(occlusionCullDescriptorSetLayout, occlusionCullEntries);
+			hiZBuildDescriptorTemplate = descriptorManager->GetOrCreateUpdateTemplate(hiZBuildDescriptorSetLayout, hiZBuildEntries);
+		}
+	}
+
+	globalDescriptorSet = descriptorManager->AllocateDescriptorSets(globalLayout, MAX_FRAMES_IN_FLIGHT);
+
+	// Material textures are not part of the global set, they are indexed from the bindless set
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		GlobalDescriptorData globalData{};
+		globalData.camera = { uniformBuffer->GetCameraUBOs()[i].buffer, 0, sizeof(CameraUBO) };
+		globalData.model = { uniformBuffer->GetModelUBOs()[i].buffer, 0, sizeof(ModelUBO) };
+		descriptorManager->UpdateDescriptorSet(globalDescriptorSet[i], globalDescriptorTemplate, globalData);
+	}
+}
+
+void VulkanRenderer::BindPassDescriptorSet(VkCommandBuffer commandBuffer, const CachedPipeline& pso, VkDescriptorSetLayout setLayout,
+	VkDescriptorUpdateTemplate updateTemplate, const void* data, VkPipelineBindPoint bindPoint)
+{
+	if (usePushDescriptors) {
+		descriptorManager->PushDescriptorSet(commandBuffer, updateTemplate, pso.layout, 0, data);
+		return;
+	}
+
+	VkDescriptorSet set = descriptorManager->AllocateTransientDescriptorSet(setLayout);
+	descriptorManager->UpdateDescriptorSet(set, updateTemplate, data);
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, pso.layout, 0, 1, &set, 0, nullptr);
+}
+
+void VulkanRenderer::RecreateRenderTargets()
+{
+	swapchain->ReCreateSwapchain(VK_NULL_HANDLE, depthBuffer);
+
+	// The old targets may still be in use by frames in flight, they go through the deletion queue
+	gBufferManager->ReleaseGBufferResources();
+	gBufferManager->CreateGBufferResources(swapchain->GetSwapChainExtent());
+	hdrManager->RecreateHDRResources();
+	hiZManager->RecreateHiZResources(swapchain->GetSwapChainExtent());
 }
 
 void VulkanRenderer::InitImGui( )
@@ -349,25 +559,29 @@ void VulkanRenderer::CleanupVulkan()
 	//ImGui_ImplGlfw_Shutdown();
 	//ImGui::DestroyContext();
 
+	// Device is idle at this point, so anything still deferred can go
+	context->GetDeletionQueue().FlushAll();
+
 	swapchain->CleanupSwapchain();
 	depthBuffer->CleanupDepthBuffer();
 	uniformBuffer->CleanupUniformBuffer();
+	gpuProfiler->CleanupProfiler();
+	lightManager->CleanupLights();
+	indirectDrawManager->CleanupScene();
+	hiZManager->CleanupHiZ();
 
 	
 	// -- clean up descriptor sets -- //
-	vkDestroyDescriptorSetLayout(context->GetDevice(), globalLayout, nullptr);
-	vkDestroyDescriptorSetLayout(context->GetDevice(), hdrDescriptorSetLayout, nullptr);
-	vkDestroyDescriptorSetLayout(context->GetDevice(), lightingDescriptorSetLayout, nullptr); 
+	// Set layouts belong to the context's layout cache and are destroyed with the context
 	descriptorManager->CleanupPool();
+	bindlessTextures->CleanupBindlessTextures();
 
 
 	for (Mesh * mesh : meshes)
 	{
 		mesh->CleanUpMesh();
 	}
-	pipeline->CleanupPipeline(graphicsPipeline, pipelineLayout); 
-	lightingPipeline->CleanupPipeline(lightingGraphicsPipeline, lightingPipelineLayout);
-	hdrPipeline->CleanupPipeline(HdrGraphicsPipeline, hdrPipelineLayout); 
+	pipeline->CleanupPipelines();
 	hdrManager->Cleanup();
 	gBufferManager->CleanupGBuffer(); 
 	syncObjects->CleanupSyncObjects();
@@ -383,6 +597,13 @@ void VulkanRenderer::CleanupVulkan()
 void VulkanRenderer::MainLoop()
 {
 
+	if (runLightBenchmark) {
+		RunLightBenchmark();
+	}
+	if (runDepthPrepassBenchmark && !glfwWindowShouldClose(window->GetWindow())) {
+		RunDepthPrepassBenchmark();
+	}
+
 	double lastTime = glfwGetTime();
 	int frameCount = 0;
 
@@ -421,16 +642,65 @@ void VulkanRenderer::MainLoop()
 }
 
 
+void VulkanRenderer::UnloadMesh(Mesh* mesh)
+{
+	auto it = std::find(meshes.begin(), meshes.end(), mesh);
+	if (it == meshes.end())
+	{
+		return;
+	}
+
+	meshes.erase(it);
+	bindlessTextures->RemoveMaterial(mesh->materialIndex);
+	mesh->ReleaseMesh();
+	delete mesh;
+
+	// The merged scene still holds the mesh's geometry and its now freed material slot; rebuild it
+	// without the mesh. The old buffers go through the deletion queue like the mesh's own.
+	if (context->GetOptionalFeatures().drawIndirectCount) {
+		indirectDrawManager->ReleaseScene();
+		indirectDrawManager->BuildScene(meshes);
+	}
+
+	RebuildMeshBounds();
+}
+
+void VulkanRenderer::RebuildMeshBounds()
+{
+	meshCuller.Clear();
+	meshCuller.Reserve(meshes.size());
+	for (const Mesh* mesh : meshes)
+	{
+		meshCuller.AddBox(mesh->boundsMin, mesh->boundsMax);
+	}
+}
+
 void VulkanRenderer::DrawFrame()
 {
 	VkFence inFlightFence = syncObjects->GetInFlightFence(currentFrame);
 	vkWaitForFences(context->GetDevice(), 1, &inFlightFence, VK_TRUE, UINT64_MAX);
 
+	// The fence above guarantees every frame up to frameNumber - MAX_FRAMES_IN_FLIGHT has retired
+	VulkanDeletionQueue& deletionQueue = context->GetDeletionQueue();
+	deletionQueue.Flush(frameNumber + 1 >= MAX_FRAMES_IN_FLIGHT ? frameNumber + 1 - MAX_FRAMES_IN_FLIGHT : 0);
+	deletionQueue.BeginFrame(frameNumber);
+
+	// Transient descriptor sets of this frame slot are no longer in use either
+	descriptorManager->BeginFrame(currentFrame);
+
+	// Swap in pipelines whose shaders were edited on disk (no-op unless hot reload is enabled)
+	if constexpr (ShaderCompiler::IsHotReloadEnabled()) {
+		pipeline->ReloadChangedShaders();
+	}
+
+	// Replace fast-linked pipelines whose optimized version finished in the background
+	pipeline->SwapInOptimizedPipelines();
+
 	uint32_t imageIndex;
 	VkResult result = vkAcquireNextImageKHR(context->GetDevice(), swapchain->GetSwapChain(), UINT64_MAX, syncObjects->GetImageAvailableSemaphore(currentFrame), VK_NULL_HANDLE, &imageIndex);
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-		swapchain->ReCreateSwapchain(VK_NULL_HANDLE, depthBuffer);
+		RecreateRenderTargets();
 		return;
 	}
 	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
@@ -445,20 +715,40 @@ void VulkanRenderer::DrawFrame()
 	cameraUbo.view = camera->getView();
 	cameraUbo.proj = camera->getProjection();
 
+	// The point lights stay in the light manager's buffer, only changed slots are uploaded
+	// (see RecordCommandBuffer); the per-frame UBO just carries how many slots to walk
 	SceneLightingUBO sceneLightingUbo{};
-	sceneLightingUbo.lights[0] = lights[0];
-	sceneLightingUbo.lights[1] = lights[1];
-	sceneLightingUbo.lights[2] = lights[2];
-	sceneLightingUbo.lights[3] = lights[3];
-	sceneLightingUbo.numberOfLights = 4;
-
+	sceneLightingUbo.pointLightCount = lightManager->GetLightCount();
 	sceneLightingUbo.directionalLight = dirLight;
 
 
 	uniformBuffer->UpdateUBO<CameraUBO>(currentFrame,uniformBuffer->GetCameraUBOs(), cameraUbo);
 	uniformBuffer->UpdateUBO<SceneLightingUBO>(currentFrame, uniformBuffer->GetSceneLightsUBOs(), sceneLightingUbo);
 
-	RecordCommandBuffer(imageIndex);
+	// Latched once, the key callback may flip renderPath while the frame records
+	const RenderPath framePath = renderPath;
+	if (framePath == RenderPath::ClusteredForward) {
+		ClusterUBO clusterUbo{};
+		clusterUbo.inverseProjection = glm::inverse(cameraUbo.proj);
+		clusterUbo.screenSize = glm::vec2(swapchain->GetSwapChainExtent().width, swapchain->GetSwapChainExtent().height);
+		clusterUbo.zNear = camera->nearplane;
+		clusterUbo.zFar = camera->farplane;
+		uniformBuffer->UpdateUBO<ClusterUBO>(currentFrame, uniformBuffer->GetClusterUBOs(), clusterUbo);
+	}
+
+	// Latched once as well, 'G' may flip gpuDrivenDraws while the frame records. Without indirect
+	// draws the CPU culls here and RecordMeshDraws draws the meshes that survived in render queue order.
+	frameUsesIndirectDraws = gpuDrivenDraws && context->GetOptionalFeatures().drawIndirectCount &&
+		indirectDrawManager->GetObjectCount() > 0;
+	frameUsesOcclusionCulling = frameUsesIndirectDraws && occlusionCulling && framePath == RenderPath::Deferred &&
+		context->GetOptionalFeatures().occlusionCulling;
+	frameUsesDepthPrepass = depthPrepass && framePath == RenderPath::Deferred;
+	if (!frameUsesIndirectDraws) {
+		meshCuller.Cull(camera->GetFrustumPlanes(), visibleMeshIndices);
+		BuildRenderQueue(framePath);
+	}
+
+	RecordCommandBuffer(imageIndex, framePath);
 
 
 	vkResetFences(context->GetDevice(), 1, &inFlightFence);
@@ -485,6 +775,7 @@ void VulkanRenderer::DrawFrame()
 	if (vkQueueSubmit(context->GetGraphicsQueue(), 1, &submitInfo, syncObjects->GetInFlightFence(currentFrame)) != VK_SUCCESS) {
 		throw std::runtime_error("failed to submit draw command buffer!");
 	}
+	frameNumber++;
 
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -500,9 +791,9 @@ void VulkanRenderer::DrawFrame()
 
 	result = vkQueuePresentKHR(context->GetPresentQueue(), &presentInfo);
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-		;
-		swapchain->ReCreateSwapchain(VK_NULL_HANDLE,depthBuffer);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
+		framebufferResized = false;
+		RecreateRenderTargets();
 	}
 	else if (result != VK_SUCCESS) {
 		throw std::runtime_error("failed to present swap chain image!");
@@ -513,7 +804,7 @@ void VulkanRenderer::DrawFrame()
 
 
 
-void VulkanRenderer::RecordCommandBuffer(uint32_t imageIndex)
+void VulkanRenderer::RecordCommandBuffer(uint32_t imageIndex, RenderPath path)
 {
 	VkCommandBuffer commandBufferCurrentFrame = commandBuffer->GetCommandBuffers()[currentFrame];
 	VkExtent2D SwapchainExtent = swapchain->GetSwapChainExtent();
@@ -525,89 +816,210 @@ void VulkanRenderer::RecordCommandBuffer(uint32_t imageIndex)
 		throw std::runtime_error("failed to begin recording command buffer!");
 	}
 
+	gpuProfiler->BeginFrame(commandBufferCurrentFrame, currentFrame);
+	lightManager->RecordUpload(commandBufferCurrentFrame, currentFrame);
+
+	RecordObjectCulling(commandBufferCurrentFrame);
+
+	if (path == RenderPath::ClusteredForward) {
+		RecordClusteredForwardPasses(commandBufferCurrentFrame);
+	}
+	else {
+		RecordDeferredPasses(commandBufferCurrentFrame);
+	}
+
+	VkViewport viewport{ 0.0f, 0.0f, (float)SwapchainExtent.width, (float)SwapchainExtent.height, 0.0f, 1.0f };
+	VkRect2D scissor{ { 0, 0 }, SwapchainExtent };
+
+	Image::RecordImageTransition(commandBufferCurrentFrame,swapchain->GetSwapchainImages()[imageIndex], swapchain->GetSwapChainImageFormat(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
+
+
+	VkRenderingAttachmentInfo toneMappingAttachmentInfo{};
+	toneMappingAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	toneMappingAttachmentInfo.imageView = swapchain->GetSwapchainImageViews()[imageIndex];
+	toneMappingAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	toneMappingAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	toneMappingAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	toneMappingAttachmentInfo.clearValue = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	VkRenderingInfo toneMappingRenderingInfo{};
+	toneMappingRenderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	toneMappingRenderingInfo.renderArea = VkRect2D{ VkOffset2D {0, 0}, SwapchainExtent.width, SwapchainExtent.height };
+	toneMappingRenderingInfo.layerCount = 1;
+	toneMappingRenderingInfo.colorAttachmentCount = 1;
+	toneMappingRenderingInfo.pColorAttachments = &toneMappingAttachmentInfo;
+	toneMappingRenderingInfo.pDepthAttachment = nullptr;
+	toneMappingRenderingInfo.pStencilAttachment = nullptr;
+
+	vkCmdBeginRendering(commandBufferCurrentFrame, &toneMappingRenderingInfo);
+
+	const size_t tonemapVariant = static_cast<size_t>(std::clamp(currentTonemapOperator, 0, static_cast<int>(tonemapPipelineKeys.size()) - 1));
+	const CachedPipeline& tonemapPso = pipeline->ResolvePipeline(tonemapPipelineHandles[tonemapVariant]);
+	vkCmdBindPipeline(commandBufferCurrentFrame, VK_PIPELINE_BIND_POINT_GRAPHICS, tonemapPso.pipeline);
+	vkCmdSetViewport(commandBufferCurrentFrame, 0, 1, &viewport);
+	vkCmdSetScissor(commandBufferCurrentFrame, 0, 1, &scissor);
+
+	TonemapDescriptorData tonemapData{};
+	tonemapData.hdr = { hdrManager->GetHDRSampler(), hdrManager->GetHDRResolveView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	BindPassDescriptorSet(commandBufferCurrentFrame, tonemapPso, hdrDescriptorSetLayout, hdrDescriptorTemplate, &tonemapData);
+
+	ToneMapPush tonemapPushData;
+	tonemapPushData.exposure = currentExposure;
+
+	vkCmdPushConstants(
+		commandBufferCurrentFrame,
+		tonemapPso.layout,
+		tonemapPso.GetPushConstantStages(),
+		0,
+		sizeof(ToneMapPush),
+		&tonemapPushData
+	);
+
+	vkCmdDraw(commandBufferCurrentFrame, 3, 1, 0, 0); 
+	vkCmdEndRendering(commandBufferCurrentFrame);
+
+	Image::RecordImageTransition(commandBufferCurrentFrame,swapchain->GetSwapchainImages()[imageIndex], swapchain->GetSwapChainImageFormat(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 1);
+
+	if (vkEndCommandBuffer(commandBufferCurrentFrame) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record command buffer!");
+	}
+}
+
+void VulkanRenderer::RecordDeferredPasses(VkCommandBuffer commandBufferCurrentFrame)
+{
+	VkExtent2D SwapchainExtent = swapchain->GetSwapChainExtent();
+
 	// --- memory barrier --- //
 	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetAlbedoImage(), gBufferManager->GetAlbedoImageFormat(), gBufferManager->GetAlbedoImageLayout(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
-	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetAOImage(), gBufferManager->GetAOImageFormat(), gBufferManager->GetAOImageLayout(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
 	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetNormalImage(), gBufferManager->GetNormalImageFormat(), gBufferManager->GetNormalImageLayout(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
 	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetMetallicRoughnessImage(), gBufferManager->GetMetallicRoughnessImageFormat(), gBufferManager->GetMetallicRoughnessImageLayout(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
 
-	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetGWorldPosImage(), VK_FORMAT_R32G32B32A32_SFLOAT, gBufferManager->GetGWorldPosImageLayout(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
 	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetAlbedoImageResolve(), gBufferManager->GetAlbedoImageFormat(),gBufferManager->GetAlbedoImageResolveLayout(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
-	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetAOImageResolve(), gBufferManager->GetAOImageFormat(),gBufferManager->GetAOImageResolveLayout(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
 	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetNormalImageResolve(), gBufferManager->GetNormalImageFormat(),gBufferManager->GetNormalImageResolveLayout(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
 	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetMetallicRoughnessImageResolve(), gBufferManager->GetMetallicRoughnessImageFormat(),gBufferManager->GetMetallicRoughnessImageResolveLayout(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
 	Image::RecordImageTransition(commandBufferCurrentFrame,depthBuffer->GetDepthResolveImage(), VulkanUtils::FindDepthFormat(context->GetPhysicalDevice()),VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
-	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetGWorldPosResolveImage(), VK_FORMAT_R32G32B32A32_SFLOAT, gBufferManager->GetGWorldPosResolveImageLayout(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
 
 	gBufferManager->SetAlbedoImageLayout(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-	gBufferManager->SetAOImageLayout(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 	gBufferManager->SetNormalImageLayout(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 	gBufferManager->SetMetallicRoughnessImageLayout(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-	gBufferManager->SetGWorldPosImageLayout(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 	gBufferManager->SetAlbedoImageResolveLayout(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-	gBufferManager->SetAOImageResolveLayout(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 	gBufferManager->SetNormalImageResolveLayout(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 	gBufferManager->SetMetallicRoughnessImageResolveLayout(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 
+	if (frameUsesOcclusionCulling) {
+		// Early phase: last frame's visible set, culled by RecordObjectCulling. Its depth is reduced
+		// into the Hi-Z pyramid, the late phase draws what that pyramid shows to be newly visible.
+		RecordGBufferPass(commandBufferCurrentFrame, true, false, OCCLUSION_CULL_EARLY);
+
+		Image::RecordImageTransition(commandBufferCurrentFrame, depthBuffer->GetDepthResolveImage(), VulkanUtils::FindDepthFormat(context->GetPhysicalDevice()), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, 1);
+		RecordHiZBuild(commandBufferCurrentFrame);
+		RecordOcclusionCulling(commandBufferCurrentFrame, OCCLUSION_CULL_LATE);
+		Image::RecordImageTransition(commandBufferCurrentFrame, depthBuffer->GetDepthResolveImage(), VulkanUtils::FindDepthFormat(context->GetPhysicalDevice()), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
+
+		// The late pass loads the multisampled targets the early pass stored
+		RecordGBufferAttachmentBarrier(commandBufferCurrentFrame);
+
+		RecordGBufferPass(commandBufferCurrentFrame, false, true, OCCLUSION_CULL_LATE);
+	}
+	else {
+		RecordGBufferPass(commandBufferCurrentFrame, true, true, 0);
+	}
+
+	
+	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetAlbedoImageResolve(), gBufferManager->GetAlbedoImageFormat(), gBufferManager->GetAlbedoImageResolveLayout(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetNormalImageResolve(), gBufferManager->GetNormalImageFormat(), gBufferManager->GetNormalImageResolveLayout(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetMetallicRoughnessImageResolve(), gBufferManager->GetMetallicRoughnessImageFormat(), gBufferManager->GetMetallicRoughnessImageResolveLayout(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+	Image::RecordImageTransition(commandBufferCurrentFrame,depthBuffer->GetDepthResolveImage(), VulkanUtils::FindDepthFormat(context->GetPhysicalDevice()), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, 1);
+	gBufferManager->SetAlbedoImageResolveLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	gBufferManager->SetNormalImageResolveLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	gBufferManager->SetMetallicRoughnessImageResolveLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	// --- Pass 2: Lighting Pass (Render to HDR Image) ---
+	// Built per frame from the current targets, so a resize needs no descriptor rewrite
+	VkSampler gBufferSampler = gBufferManager->GetGBufferSampler();
+	LightingDescriptorData lightingData{};
+	lightingData.albedo = { gBufferSampler, gBufferManager->GetAlbedoImageResolveView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	lightingData.normal = { gBufferSampler, gBufferManager->GetNormalImageResolveView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	lightingData.metallicRoughness = { gBufferSampler, gBufferManager->GetMetallicRoughnessImageResolveView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	lightingData.depth = { gBufferSampler, depthBuffer->GetDepthResolveImageView(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+	lightingData.lights = { uniformBuffer->GetSceneLightsUBOs()[currentFrame].buffer, 0, sizeof(SceneLightingUBO) };
+	lightingData.camera = { uniformBuffer->GetCameraUBOs()[currentFrame].buffer, 0, sizeof(CameraUBO) };
+	lightingData.pointLights = { lightManager->GetLightBuffer(), 0, VK_WHOLE_SIZE };
+	lightingData.hdrOutput = { VK_NULL_HANDLE, hdrManager->GetHDRResolveView(), VK_IMAGE_LAYOUT_GENERAL };
+
+	gpuProfiler->BeginScope(commandBufferCurrentFrame, "lighting");
+	switch (lightingPath)
+	{
+	case LightingPath::TiledCompute:
+		RecordTiledLighting(commandBufferCurrentFrame, lightingData);
+		break;
+	case LightingPath::LightVolumes:
+		RecordLightVolumeLighting(commandBufferCurrentFrame, lightingData);
+		break;
+	case LightingPath::Fullscreen:
+	default:
+		RecordFullscreenLighting(commandBufferCurrentFrame, lightingData);
+		break;
+	}
+	gpuProfiler->EndScope(commandBufferCurrentFrame, "lighting");
+}
+
+void VulkanRenderer::RecordGBufferPass(VkCommandBuffer commandBuffer, bool clearTargets, bool resolveTargets, uint32_t drawList)
+{
+	VkExtent2D SwapchainExtent = swapchain->GetSwapChainExtent();
+
+	if (frameUsesDepthPrepass) {
+		RecordDepthPrepass(commandBuffer, clearTargets, drawList);
+		RecordGBufferAttachmentBarrier(commandBuffer);
+	}
+
+	// Only the resolves are read by the lighting pass, the multisampled contents are stored only when
+	// a later pass loads them
+	const VkAttachmentLoadOp loadOp = clearTargets ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+	const VkAttachmentStoreOp colorStoreOp = resolveTargets ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+	const VkResolveModeFlagBits colorResolveMode = resolveTargets ? VK_RESOLVE_MODE_AVERAGE_BIT : VK_RESOLVE_MODE_NONE;
+
 	std::vector<VkRenderingAttachmentInfo> gBufferColorAttachments;
-	gBufferColorAttachments.resize(5); 
+	gBufferColorAttachments.resize(3); 
 	gBufferColorAttachments[0].sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
 	gBufferColorAttachments[0].imageView = gBufferManager->GetAlbedoImageView();
 	gBufferColorAttachments[0].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	gBufferColorAttachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	gBufferColorAttachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	gBufferColorAttachments[0].loadOp = loadOp;
+	gBufferColorAttachments[0].storeOp = colorStoreOp;
 	gBufferColorAttachments[0].resolveImageView = gBufferManager->GetAlbedoImageResolveView();
 	gBufferColorAttachments[0].resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	gBufferColorAttachments[0].resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT; 
+	gBufferColorAttachments[0].resolveMode = colorResolveMode;
 	gBufferColorAttachments[0].clearValue = { 0.0f, 0.0f, 0.0f, 1.0f };
 
 	gBufferColorAttachments[1].sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-	gBufferColorAttachments[1].imageView = gBufferManager->GetAOImageView();
+	gBufferColorAttachments[1].imageView = gBufferManager->GetNormalImageView();
 	gBufferColorAttachments[1].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	gBufferColorAttachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	gBufferColorAttachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	gBufferColorAttachments[1].resolveImageView = gBufferManager->GetAOImageResolveView();
+	gBufferColorAttachments[1].loadOp = loadOp;
+	gBufferColorAttachments[1].storeOp = colorStoreOp;
+	gBufferColorAttachments[1].resolveImageView = gBufferManager->GetNormalImageResolveView();
 	gBufferColorAttachments[1].resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	gBufferColorAttachments[1].resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
-	gBufferColorAttachments[1].clearValue = { 0.0f, 0.0f, 0.0f, 1.0f };
+	gBufferColorAttachments[1].resolveMode = colorResolveMode;
+	gBufferColorAttachments[1].clearValue = { 0.0f, 0.0f, 0.0f, 0.0f }; // octahedral +Z
 
 	gBufferColorAttachments[2].sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-	gBufferColorAttachments[2].imageView = gBufferManager->GetNormalImageView();
+	gBufferColorAttachments[2].imageView = gBufferManager->GetMetallicRoughnessImageView();
 	gBufferColorAttachments[2].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	gBufferColorAttachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	gBufferColorAttachments[2].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	gBufferColorAttachments[2].resolveImageView = gBufferManager->GetNormalImageResolveView();
+	gBufferColorAttachments[2].loadOp = loadOp;
+	gBufferColorAttachments[2].storeOp = colorStoreOp;
+	gBufferColorAttachments[2].resolveImageView = gBufferManager->GetMetallicRoughnessImageResolveView();
 	gBufferColorAttachments[2].resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	gBufferColorAttachments[2].resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
-	gBufferColorAttachments[2].clearValue = { 0.5f, 0.5f, 1.0f};
-
-	gBufferColorAttachments[3].sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-	gBufferColorAttachments[3].imageView = gBufferManager->GetMetallicRoughnessImageView();
-	gBufferColorAttachments[3].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	gBufferColorAttachments[3].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	gBufferColorAttachments[3].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	gBufferColorAttachments[3].resolveImageView = gBufferManager->GetMetallicRoughnessImageResolveView();
-	gBufferColorAttachments[3].resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	gBufferColorAttachments[3].resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
-	gBufferColorAttachments[3].clearValue = { 0.0f, 0.0f, 0.0f, 1.0f };
-
-	gBufferColorAttachments[4].sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-	gBufferColorAttachments[4].imageView = gBufferManager->GetGWorldPosImageView();
-	gBufferColorAttachments[4].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	gBufferColorAttachments[4].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	gBufferColorAttachments[4].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	gBufferColorAttachments[4].resolveImageView = gBufferManager->GetGWorldPosResolveImageView();
-	gBufferColorAttachments[4].resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	gBufferColorAttachments[4].resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
-	gBufferColorAttachments[4].clearValue = { 0.0f, 0.0f, 0.0f, 0.0f }; 
+	gBufferColorAttachments[2].resolveMode = colorResolveMode;
+	gBufferColorAttachments[2].clearValue = { 0.0f, 0.0f, 1.0f, 1.0f }; // unoccluded
 
 	VkRenderingAttachmentInfo depthAttachmentInfo{};
 	depthAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
 	depthAttachmentInfo.imageView = depthBuffer->GetDepthImageView();
 	depthAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-	depthAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	// The pre-pass already wrote the final depth, the resolve still happens here
+	depthAttachmentInfo.loadOp = frameUsesDepthPrepass ? VK_ATTACHMENT_LOAD_OP_LOAD : loadOp;
 	depthAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE; 
-	depthAttachmentInfo.resolveMode = VK_RESOLVE_MODE_SAMPLE_ZERO_BIT;
+	// The farthest sample keeps the Hi-Z pyramid conservative, sample zero is the only mode every device has
+	depthAttachmentInfo.resolveMode = context->GetOptionalFeatures().depthResolveMax ? VK_RESOLVE_MODE_MAX_BIT : VK_RESOLVE_MODE_SAMPLE_ZERO_BIT;
 	depthAttachmentInfo.resolveImageView = depthBuffer->GetDepthResolveImageView();
 	depthAttachmentInfo.resolveImageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL; 
 	depthAttachmentInfo.clearValue.depthStencil = { 1.0f, 0 };
@@ -621,9 +1033,12 @@ void VulkanRenderer::RecordCommandBuffer(uint32_t imageIndex)
 	gBufferRenderingInfo.pDepthAttachment = &depthAttachmentInfo;
 	gBufferRenderingInfo.pStencilAttachment = VK_NULL_HANDLE; 
 
-	vkCmdBeginRendering(commandBufferCurrentFrame, &gBufferRenderingInfo);
+	const char* scopeName = drawList == 0 ? "gbuffer" : "gbuffer_late";
+	gpuProfiler->BeginScope(commandBuffer, scopeName);
+	vkCmdBeginRendering(commandBuffer, &gBufferRenderingInfo);
 
-	vkCmdBindPipeline(commandBufferCurrentFrame, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline); 
+	const CachedPipeline& gBufferPso = pipeline->GetPipeline(frameUsesDepthPrepass ? gBufferDepthEqualPipelineKey : gBufferPipelineKey);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, gBufferPso.pipeline);
 
 
 	VkViewport viewport{};
@@ -633,42 +1048,332 @@ void VulkanRenderer::RecordCommandBuffer(uint32_t imageIndex)
 	viewport.height = (float)SwapchainExtent.height;
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
-	vkCmdSetViewport(commandBufferCurrentFrame, 0, 1, &viewport);
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
 	VkRect2D scissor{};
 	scissor.offset = { 0, 0 };
 	scissor.extent = SwapchainExtent;
-	vkCmdSetScissor(commandBufferCurrentFrame, 0, 1, &scissor);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-	VkDeviceSize offsets[] = { 0 };
+	// Bound once for every mesh: the global set per frame and the bindless set with all materials
+	VkDescriptorSet gBufferSets[] = { globalDescriptorSet[currentFrame], bindlessTextures->GetDescriptorSet() };
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, gBufferPso.layout, 0, 2, gBufferSets, 0, nullptr);
 
-	for (Mesh* mesh : meshes)
+	RecordMeshDraws(commandBuffer, gBufferPso, DRAW_PASS_GBUFFER, drawList);
+	vkCmdEndRendering(commandBuffer);
+	gpuProfiler->EndScope(commandBuffer, scopeName);
+}
+
+void VulkanRenderer::RecordDepthPrepass(VkCommandBuffer commandBuffer, bool clearDepth, uint32_t drawList)
+{
+	VkExtent2D SwapchainExtent = swapchain->GetSwapChainExtent();
+
+	// Multisampled depth only; the G-buffer pass that loads it does the resolve
+	VkRenderingAttachmentInfo depthAttachmentInfo{};
+	depthAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	depthAttachmentInfo.imageView = depthBuffer->GetDepthImageView();
+	depthAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachmentInfo.loadOp = clearDepth ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+	depthAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	depthAttachmentInfo.clearValue.depthStencil = { 1.0f, 0 };
+
+	VkRenderingInfo prepassRenderingInfo{};
+	prepassRenderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	prepassRenderingInfo.renderArea = VkRect2D{ VkOffset2D {0, 0}, SwapchainExtent.width, SwapchainExtent.height };
+	prepassRenderingInfo.layerCount = 1;
+	prepassRenderingInfo.colorAttachmentCount = 0;
+	prepassRenderingInfo.pDepthAttachment = &depthAttachmentInfo;
+
+	const char* scopeName = drawList == 0 ? "depth_prepass" : "depth_prepass_late";
+	gpuProfiler->BeginScope(commandBuffer, scopeName);
+	vkCmdBeginRendering(commandBuffer, &prepassRenderingInfo);
+
+	const CachedPipeline& prepassPso = pipeline->GetPipeline(depthPrepassPipelineKey);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, prepassPso.pipeline);
+
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)SwapchainExtent.width;
+	viewport.height = (float)SwapchainExtent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = SwapchainExtent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	// Only the camera and model UBOs of the global set, no materials
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, prepassPso.layout, 0, 1, &globalDescriptorSet[currentFrame], 0, nullptr);
+
+	RecordMeshDraws(commandBuffer, prepassPso, DRAW_PASS_DEPTH_PREPASS, drawList);
+	vkCmdEndRendering(commandBuffer);
+	gpuProfiler->EndScope(commandBuffer, scopeName);
+}
+
+void VulkanRenderer::RecordGBufferAttachmentBarrier(VkCommandBuffer commandBuffer)
+{
+	VkMemoryBarrier attachmentBarrier{};
+	attachmentBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	attachmentBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	attachmentBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	const VkPipelineStageFlags attachmentStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	vkCmdPipelineBarrier(commandBuffer, attachmentStages, attachmentStages, 0, 1, &attachmentBarrier, 0, nullptr, 0, nullptr);
+}
+
+void VulkanRenderer::RecordClusteredForwardPasses(VkCommandBuffer commandBuffer)
+{
+	VkExtent2D SwapchainExtent = swapchain->GetSwapChainExtent();
+
+	ForwardDescriptorData forwardData{};
+	forwardData.camera = { uniformBuffer->GetCameraUBOs()[currentFrame].buffer, 0, sizeof(CameraUBO) };
+	forwardData.model = { uniformBuffer->GetModelUBOs()[currentFrame].buffer, 0, sizeof(ModelUBO) };
+	forwardData.lights = { uniformBuffer->GetSceneLightsUBOs()[currentFrame].buffer, 0, sizeof(SceneLightingUBO) };
+	forwardData.pointLights = { lightManager->GetLightBuffer(), 0, VK_WHOLE_SIZE };
+	forwardData.clusters = { uniformBuffer->GetClusterGridBuffers()[currentFrame].buffer, 0, VK_WHOLE_SIZE };
+	forwardData.clusterParams = { uniformBuffer->GetClusterUBOs()[currentFrame].buffer, 0, sizeof(ClusterUBO) };
+
+	// --- Pass 1: bin the point lights into the cluster grid, one workgroup per cluster ---
+	gpuProfiler->BeginScope(commandBuffer, "cluster_lights");
+	const CachedPipeline& clusterLightsPso = pipeline->GetComputePipeline(clusterLightsPipelineKey);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, clusterLightsPso.pipeline);
+	BindPassDescriptorSet(commandBuffer, clusterLightsPso, clusterLightsDescriptorSetLayout, clusterLightsDescriptorTemplate,
+		&forwardData, VK_PIPELINE_BIND_POINT_COMPUTE);
+	vkCmdDispatch(commandBuffer, CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z);
+	gpuProfiler->EndScope(commandBuffer, "cluster_lights");
+
+	VulkanUtils::RecordBufferBarrier(commandBuffer, uniformBuffer->GetClusterGridBuffers()[currentFrame].buffer,
+		VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+	// --- Pass 2: shade every mesh into the multisampled HDR target, resolved at the end ---
+	Image::RecordImageTransition(commandBuffer,hdrManager->GetHDRResolve(), VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
+
+	VkRenderingAttachmentInfo colorAttachmentInfo{};
+	colorAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	colorAttachmentInfo.imageView = hdrManager->GetHDRMsaaView();
+	colorAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachmentInfo.resolveImageView = hdrManager->GetHDRResolveView();
+	colorAttachmentInfo.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachmentInfo.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+	colorAttachmentInfo.clearValue = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	// Nothing reads depth after this pass, so the multisampled depth is neither stored nor resolved
+	VkRenderingAttachmentInfo depthAttachmentInfo{};
+	depthAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	depthAttachmentInfo.imageView = depthBuffer->GetDepthImageView();
+	depthAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachmentInfo.clearValue.depthStencil = { 1.0f, 0 };
+
+	VkRenderingInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	renderingInfo.renderArea = VkRect2D{ VkOffset2D {0, 0}, SwapchainExtent.width, SwapchainExtent.height };
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachments = &colorAttachmentInfo;
+	renderingInfo.pDepthAttachment = &depthAttachmentInfo;
+	renderingInfo.pStencilAttachment = VK_NULL_HANDLE;
+
+	gpuProfiler->BeginScope(commandBuffer, "forward");
+	vkCmdBeginRendering(commandBuffer, &renderingInfo);
+
+	const CachedPipeline& forwardPso = pipeline->GetPipeline(forwardPipelineKey);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forwardPso.pipeline);
+
+	VkViewport viewport{ 0.0f, 0.0f, (float)SwapchainExtent.width, (float)SwapchainExtent.height, 0.0f, 1.0f };
+	VkRect2D scissor{ { 0, 0 }, SwapchainExtent };
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	BindPassDescriptorSet(commandBuffer, forwardPso, forwardDescriptorSetLayout, forwardDescriptorTemplate, &forwardData);
+	VkDescriptorSet bindlessSet = bindlessTextures->GetDescriptorSet();
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forwardPso.layout, BINDLESS_SET, 1, &bindlessSet, 0, nullptr);
+
+	RecordMeshDraws(commandBuffer, forwardPso, DRAW_PASS_FORWARD);
+	vkCmdEndRendering(commandBuffer);
+	gpuProfiler->EndScope(commandBuffer, "forward");
+
+	Image::RecordImageTransition(commandBuffer,hdrManager->GetHDRResolve(), VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+}
+
+void VulkanRenderer::RecordObjectCulling(VkCommandBuffer commandBuffer)
+{
+	if (!frameUsesIndirectDraws) {
+		return;
+	}
+
+	indirectDrawManager->RecordResetDrawCount(commandBuffer, currentFrame);
+
+	if (frameUsesOcclusionCulling) {
+		RecordOcclusionCulling(commandBuffer, OCCLUSION_CULL_EARLY);
+		return;
+	}
+
+	CullDescriptorData cullData{};
+	cullData.objects = { indirectDrawManager->GetObjectBuffer(), 0, VK_WHOLE_SIZE };
+	cullData.drawCommands = { indirectDrawManager->GetDrawCommandBuffer(currentFrame), 0, VK_WHOLE_SIZE };
+	cullData.drawCount = { indirectDrawManager->GetDrawCountBuffer(currentFrame), 0, VK_WHOLE_SIZE };
+
+	// Object bounds are world space, the model matrix is the identity (see UpdateModelUBO)
+	CullPush cullPushData{};
+	const std::array<glm::vec4, 6> frustumPlanes = camera->GetFrustumPlanes();
+	std::copy(frustumPlanes.begin(), frustumPlanes.end(), cullPushData.frustumPlanes);
+	cullPushData.objectCount = indirectDrawManager->GetObjectCount();
+
+	gpuProfiler->BeginScope(commandBuffer, "cull");
+	const CachedPipeline& cullPso = pipeline->GetComputePipeline(cullPipelineKey);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPso.pipeline);
+	BindPassDescriptorSet(commandBuffer, cullPso, cullDescriptorSetLayout, cullDescriptorTemplate, &cullData, VK_PIPELINE_BIND_POINT_COMPUTE);
+	vkCmdPushConstants(commandBuffer, cullPso.layout, cullPso.GetPushConstantStages(), 0, sizeof(CullPush), &cullPushData);
+	vkCmdDispatch(commandBuffer, (cullPushData.objectCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+	gpuProfiler->EndScope(commandBuffer, "cull");
+
+	indirectDrawManager->RecordCullingBarrier(commandBuffer, currentFrame);
+}
+
+void VulkanRenderer::RecordOcclusionCulling(VkCommandBuffer commandBuffer, OcclusionCullPhase phase)
+{
+	const char* scopeName = phase == OCCLUSION_CULL_EARLY ? "cull" : "cull_late";
+
+	// Each phase fills its own draw list; the late phase samples the pyramid RecordHiZBuild just built
+	CullDescriptorData cullData{};
+	cullData.objects = { indirectDrawManager->GetObjectBuffer(), 0, VK_WHOLE_SIZE };
+	cullData.drawCommands = { indirectDrawManager->GetDrawCommandBuffer(currentFrame, phase), 0, VK_WHOLE_SIZE };
+	cullData.drawCount = { indirectDrawManager->GetDrawCountBuffer(currentFrame, phase), 0, VK_WHOLE_SIZE };
+	cullData.visibility = { indirectDrawManager->GetVisibilityBuffer(), 0, VK_WHOLE_SIZE };
+	cullData.hiZ = { hiZManager->GetSampler(), hiZManager->GetImageView(), VK_IMAGE_LAYOUT_GENERAL };
+	cullData.camera = { uniformBuffer->GetCameraUBOs()[currentFrame].buffer, 0, sizeof(CameraUBO) };
+
+	OcclusionCullPush cullPushData{};
+	const std::array<glm::vec4, 6> frustumPlanes = camera->GetFrustumPlanes();
+	std::copy(frustumPlanes.begin(), frustumPlanes.end(), cullPushData.frustumPlanes);
+	const VkExtent2D depthExtent = hiZManager->GetDepthExtent();
+	cullPushData.depthSize = glm::uvec2(depthExtent.width, depthExtent.height);
+	cullPushData.objectCount = indirectDrawManager->GetObjectCount();
+	cullPushData.phase = phase;
+
+	// Orders this dispatch after the previous one touching the visibility flags: the late phase of
+	// the previous frame, or the early phase of this one
+	indirectDrawManager->RecordVisibilityBarrier(commandBuffer);
+
+	gpuProfiler->BeginScope(commandBuffer, scopeName);
+	const CachedPipeline& cullPso = pipeline->GetComputePipeline(occlusionCullPipelineKey);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPso.pipeline);
+	BindPassDescriptorSet(commandBuffer, cullPso, occlusionCullDescriptorSetLayout, occlusionCullDescriptorTemplate, &cullData, VK_PIPELINE_BIND_POINT_COMPUTE);
+	vkCmdPushConstants(commandBuffer, cullPso.layout, cullPso.GetPushConstantStages(), 0, sizeof(OcclusionCullPush), &cullPushData);
+	vkCmdDispatch(commandBuffer, (cullPushData.objectCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+	gpuProfiler->EndScope(commandBuffer, scopeName);
+
+	indirectDrawManager->RecordCullingBarrier(commandBuffer, currentFrame, phase);
+}
+
+void VulkanRenderer::RecordHiZBuild(VkCommandBuffer commandBuffer)
+{
+	gpuProfiler->BeginScope(commandBuffer, "hiz");
+	const CachedPipeline& hiZPso = pipeline->GetComputePipeline(hiZBuildPipelineKey);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hiZPso.pipeline);
+
+	hiZManager->RecordBeginBuild(commandBuffer);
+
+	// Level 0 reduces the depth resolve, every other level the one above it
+	const VkExtent2D depthExtent = hiZManager->GetDepthExtent();
+	for (uint32_t level = 0; level < hiZManager->GetLevelCount(); ++level)
 	{
-		PushConstantData push{};
-		push.modelMatrix = glm::mat4(1.0f); 
+		HiZBuildDescriptorData hiZData{};
+		HiZBuildPush hiZPush{};
+		if (level == 0) {
+			hiZData.source = { hiZManager->GetSampler(), depthBuffer->GetDepthResolveImageView(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+			hiZPush.sourceSize = glm::ivec2(depthExtent.width, depthExtent.height);
+			hiZPush.sourceIsDepth = 1;
+		}
+		else {
+			const VkExtent2D sourceExtent = hiZManager->GetLevelExtent(level - 1);
+			hiZData.source = { hiZManager->GetSampler(), hiZManager->GetLevelView(level - 1), VK_IMAGE_LAYOUT_GENERAL };
+			hiZPush.sourceSize = glm::ivec2(sourceExtent.width, sourceExtent.height);
+			hiZPush.sourceIsDepth = 0;
+		}
+
+		const VkExtent2D levelExtent = hiZManager->GetLevelExtent(level);
+		hiZData.destination = { VK_NULL_HANDLE, hiZManager->GetLevelView(level), VK_IMAGE_LAYOUT_GENERAL };
+		hiZPush.destinationSize = glm::ivec2(levelExtent.width, levelExtent.height);
 
-		vkCmdPushConstants(commandBufferCurrentFrame, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData), &push);
+		BindPassDescriptorSet(commandBuffer, hiZPso, hiZBuildDescriptorSetLayout, hiZBuildDescriptorTemplate, &hiZData, VK_PIPELINE_BIND_POINT_COMPUTE);
+		vkCmdPushConstants(commandBuffer, hiZPso.layout, hiZPso.GetPushConstantStages(), 0, sizeof(HiZBuildPush), &hiZPush);
+		vkCmdDispatch(commandBuffer, (levelExtent.width + HIZ_WORKGROUP_SIZE - 1) / HIZ_WORKGROUP_SIZE,
+			(levelExtent.height + HIZ_WORKGROUP_SIZE - 1) / HIZ_WORKGROUP_SIZE, 1);
 
-		mesh->Bind(commandBufferCurrentFrame, *offsets);
-		vkCmdBindDescriptorSets(commandBufferCurrentFrame, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &globalDescriptorSet[currentFrame], 0, nullptr);
-		vkCmdDrawIndexed(commandBufferCurrentFrame, static_cast<uint32_t>(mesh->indices.size()), 1, 0, 0, 0);
+		hiZManager->RecordLevelBarrier(commandBuffer, level);
 	}
-	vkCmdEndRendering(commandBufferCurrentFrame);
+	gpuProfiler->EndScope(commandBuffer, "hiz");
+}
 
-	
-	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetAlbedoImageResolve(), gBufferManager->GetAlbedoImageFormat(), gBufferManager->GetAlbedoImageResolveLayout(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
-	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetAOImageResolve(), gBufferManager->GetAOImageFormat(), gBufferManager->GetAOImageResolveLayout(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
-	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetNormalImageResolve(), gBufferManager->GetNormalImageFormat(), gBufferManager->GetNormalImageResolveLayout(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
-	Image::RecordImageTransition(commandBufferCurrentFrame,gBufferManager->GetMetallicRoughnessImageResolve(), gBufferManager->GetMetallicRoughnessImageFormat(), gBufferManager->GetMetallicRoughnessImageResolveLayout(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
-	Image::RecordImageTransition(commandBufferCurrentFrame,depthBuffer->GetDepthResolveImage(), VulkanUtils::FindDepthFormat(context->GetPhysicalDevice()), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, 1);
-	Image::RecordImageTransition(commandBufferCurrentFrame,hdrManager->GetHDRResolve(), VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
-	
-	gBufferManager->SetAlbedoImageResolveLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-	gBufferManager->SetAOImageResolveLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-	gBufferManager->SetNormalImageResolveLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-	gBufferManager->SetMetallicRoughnessImageResolveLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+void VulkanRenderer::RecordMeshDraws(VkCommandBuffer commandBuffer, const CachedPipeline& pso, DrawPass pass, uint32_t drawList)
+{
+	// The same for every mesh of the pass, pushed once
+	PushConstantData push{};
+	push.modelMatrix = glm::mat4(1.0f);
+	vkCmdPushConstants(commandBuffer, pso.layout, pso.GetPushConstantStages(), 0, sizeof(PushConstantData), &push);
+
+	if (frameUsesIndirectDraws) {
+		indirectDrawManager->BindGeometry(commandBuffer);
+		indirectDrawManager->RecordDraws(commandBuffer, currentFrame, drawList);
+		return;
+	}
+
+	const std::vector<RenderQueueItem>& items = renderQueue.GetItems();
+	const auto [first, last] = renderQueue.GetPassRange(pass);
+	VkDeviceSize offsets[] = { 0 };
+	for (size_t i = first; i < last; ++i)
+	{
+		Mesh* mesh = meshes[items[i].meshIndex];
+		mesh->Bind(commandBuffer, *offsets);
+		// firstInstance carries the material index to the shaders (gl_InstanceIndex)
+		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(mesh->indices.size()), 1, 0, 0, mesh->materialIndex);
+	}
+}
+
+void VulkanRenderer::BuildRenderQueue(RenderPath path)
+{
+	renderQueue.Clear();
+	renderQueue.Reserve(visibleMeshIndices.size() * 2);
+
+	const glm::mat4 view = camera->getView();
+	for (uint32_t meshIndex : visibleMeshIndices)
+	{
+		const Mesh* mesh = meshes[meshIndex];
+		// Distance of the box centre along the view direction, the camera looks down -Z in view space
+		const glm::vec3 center = (mesh->boundsMin + mesh->boundsMax) * 0.5f;
+		const float viewDepth = -(view * glm::vec4(center, 1.0f)).z;
+
+		// Every mesh of a pass is drawn with that pass's pipeline, so the pipeline field stays 0.
+		// Materials are bindless and nothing is bound per material, so the material field stays 0
+		// too and every pass is ordered front to back only.
+		if (path == RenderPath::ClusteredForward) {
+			renderQueue.Push(RenderQueue::MakeSortKey(DRAW_PASS_FORWARD, 0, 0, viewDepth, camera->farplane), meshIndex);
+			continue;
+		}
+		if (frameUsesDepthPrepass) {
+			renderQueue.Push(RenderQueue::MakeSortKey(DRAW_PASS_DEPTH_PREPASS, 0, 0, viewDepth, camera->farplane), meshIndex);
+		}
+		renderQueue.Push(RenderQueue::MakeSortKey(DRAW_PASS_GBUFFER, 0, 0, viewDepth, camera->farplane), meshIndex);
+	}
+
+	renderQueue.Sort();
+}
+
+void VulkanRenderer::RecordFullscreenLighting(VkCommandBuffer commandBuffer, const LightingDescriptorData& lightingData)
+{
+	VkExtent2D SwapchainExtent = swapchain->GetSwapChainExtent();
+
+	Image::RecordImageTransition(commandBuffer,hdrManager->GetHDRResolve(), VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
 
-	// --- Pass 2: Lighting Pass (Render to HDR Image) ---
 	VkRenderingAttachmentInfo lightingColorAttachmentInfo{};
 	lightingColorAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
 	lightingColorAttachmentInfo.imageView = hdrManager->GetHDRMsaaView(); 
@@ -689,84 +1394,309 @@ void VulkanRenderer::RecordCommandBuffer(uint32_t imageIndex)
 	lightingRenderingInfo.pDepthAttachment = nullptr; 
 	lightingRenderingInfo.pStencilAttachment = VK_NULL_HANDLE;
 
-	vkCmdBeginRendering(commandBufferCurrentFrame, &lightingRenderingInfo);
+	vkCmdBeginRendering(commandBuffer, &lightingRenderingInfo);
 
-	vkCmdBindPipeline(commandBufferCurrentFrame, VK_PIPELINE_BIND_POINT_GRAPHICS, lightingGraphicsPipeline); 
-	vkCmdSetViewport(commandBufferCurrentFrame, 0, 1, &viewport); 
-	vkCmdSetScissor(commandBufferCurrentFrame, 0, 1, &scissor);
+	const CachedPipeline& lightingPso = pipeline->GetPipeline(lightingPipelineKey);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, lightingPso.pipeline);
 
-	
-	vkCmdBindDescriptorSets(commandBufferCurrentFrame, VK_PIPELINE_BIND_POINT_GRAPHICS, lightingPipelineLayout, 0, 1, &lightingDescriptorSet[currentFrame], 0, nullptr);
+	VkViewport viewport{ 0.0f, 0.0f, (float)SwapchainExtent.width, (float)SwapchainExtent.height, 0.0f, 1.0f };
+	VkRect2D scissor{ { 0, 0 }, SwapchainExtent };
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport); 
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	BindPassDescriptorSet(commandBuffer, lightingPso, lightingDescriptorSetLayout, lightingDescriptorTemplate, &lightingData);
 
-	
 	ScreenSizePush screenSizePushData;
 	screenSizePushData.inverseScreenSize = glm::vec2(1.0f / SwapchainExtent.width, 1.0f / SwapchainExtent.height);
-	screenSizePushData.inverseViewProjection = camera->getProjection() * camera->getView(); 
-
 	screenSizePushData.inverseViewProjection = glm::inverse(camera->getProjection() * camera->getView());
 
-
 	vkCmdPushConstants(
-		commandBufferCurrentFrame,
-		lightingPipelineLayout,
-		VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 
+		commandBuffer,
+		lightingPso.layout,
+		lightingPso.GetPushConstantStages(),
 		0,
 		sizeof(ScreenSizePush),
 		&screenSizePushData
 	);
 
-	vkCmdDraw(commandBufferCurrentFrame, 3, 1, 0, 0); 
-	vkCmdEndRendering(commandBufferCurrentFrame);
-
-	
-	Image::RecordImageTransition(commandBufferCurrentFrame,hdrManager->GetHDRResolve(), VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
-	Image::RecordImageTransition(commandBufferCurrentFrame,swapchain->GetSwapchainImages()[imageIndex], swapchain->GetSwapChainImageFormat(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0); 
+	vkCmdEndRendering(commandBuffer);
 
+	Image::RecordImageTransition(commandBuffer,hdrManager->GetHDRResolve(), VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+}
 
-	VkRenderingAttachmentInfo toneMappingAttachmentInfo{};
-	toneMappingAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-	toneMappingAttachmentInfo.imageView = swapchain->GetSwapchainImageViews()[imageIndex];
-	toneMappingAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	toneMappingAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	toneMappingAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	toneMappingAttachmentInfo.clearValue = { 0.0f, 0.0f, 0.0f, 1.0f };
+void VulkanRenderer::RecordTiledLighting(VkCommandBuffer commandBuffer, const LightingDescriptorData& lightingData)
+{
+	VkExtent2D SwapchainExtent = swapchain->GetSwapChainExtent();
 
-	VkRenderingInfo toneMappingRenderingInfo{};
-	toneMappingRenderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
-	toneMappingRenderingInfo.renderArea = VkRect2D{ VkOffset2D {0, 0}, SwapchainExtent.width, SwapchainExtent.height };
-	toneMappingRenderingInfo.layerCount = 1;
-	toneMappingRenderingInfo.colorAttachmentCount = 1;
-	toneMappingRenderingInfo.pColorAttachments = &toneMappingAttachmentInfo;
-	toneMappingRenderingInfo.pDepthAttachment = nullptr;
-	toneMappingRenderingInfo.pStencilAttachment = nullptr;
+	// Every pixel is stored by the shader (sky included), the previous contents are never read
+	Image::RecordImageTransition(commandBuffer,hdrManager->GetHDRResolve(), VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 1);
 
-	vkCmdBeginRendering(commandBufferCurrentFrame, &toneMappingRenderingInfo);
+	const CachedPipeline& tiledLightingPso = pipeline->GetComputePipeline(tiledLightingPipelineKey);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, tiledLightingPso.pipeline);
 
-	vkCmdBindPipeline(commandBufferCurrentFrame, VK_PIPELINE_BIND_POINT_GRAPHICS, HdrGraphicsPipeline);
-	vkCmdSetViewport(commandBufferCurrentFrame, 0, 1, &viewport);
-	vkCmdSetScissor(commandBufferCurrentFrame, 0, 1, &scissor);
+	BindPassDescriptorSet(commandBuffer, tiledLightingPso, tiledLightingDescriptorSetLayout, tiledLightingDescriptorTemplate,
+		&lightingData, VK_PIPELINE_BIND_POINT_COMPUTE);
 
-	vkCmdBindDescriptorSets(commandBufferCurrentFrame, VK_PIPELINE_BIND_POINT_GRAPHICS, hdrPipelineLayout, 0, 1, &hdrDescriptorSet[currentFrame], 0, nullptr);
-	ToneMapPush tonemapPushData;
-	tonemapPushData.exposure = currentExposure;
-	tonemapPushData.tonemapOperator = currentTonemapOperator;
+	TiledLightingPush tiledLightingPushData{};
+	tiledLightingPushData.inverseProjection = glm::inverse(camera->getProjection());
+	tiledLightingPushData.inverseScreenSize = glm::vec2(1.0f / SwapchainExtent.width, 1.0f / SwapchainExtent.height);
 
 	vkCmdPushConstants(
-		commandBufferCurrentFrame,
-		hdrPipelineLayout,
-		VK_SHADER_STAGE_FRAGMENT_BIT,
+		commandBuffer,
+		tiledLightingPso.layout,
+		tiledLightingPso.GetPushConstantStages(),
 		0,
-		sizeof(ToneMapPush),
-		&tonemapPushData
+		sizeof(TiledLightingPush),
+		&tiledLightingPushData
 	);
 
-	vkCmdDraw(commandBufferCurrentFrame, 3, 1, 0, 0); 
-	vkCmdEndRendering(commandBufferCurrentFrame);
+	const uint32_t tilesX = (SwapchainExtent.width + LIGHTING_TILE_SIZE - 1) / LIGHTING_TILE_SIZE;
+	const uint32_t tilesY = (SwapchainExtent.height + LIGHTING_TILE_SIZE - 1) / LIGHTING_TILE_SIZE;
+	vkCmdDispatch(commandBuffer, tilesX, tilesY, 1);
 
-	Image::RecordImageTransition(commandBufferCurrentFrame,swapchain->GetSwapchainImages()[imageIndex], swapchain->GetSwapChainImageFormat(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 1);
+	Image::RecordImageTransition(commandBuffer,hdrManager->GetHDRResolve(), VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+}
 
-	if (vkEndCommandBuffer(commandBufferCurrentFrame) != VK_SUCCESS) {
-		throw std::runtime_error("failed to record command buffer!");
+void VulkanRenderer::RecordLightVolumeLighting(VkCommandBuffer commandBuffer, const LightingDescriptorData& lightingData)
+{
+	VkExtent2D SwapchainExtent = swapchain->GetSwapChainExtent();
+
+	Image::RecordImageTransition(commandBuffer,hdrManager->GetHDRResolve(), VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
+
+	// The volumes are depth tested against the multisampled depth the G-buffer pass stored
+	VkMemoryBarrier depthBarrier{};
+	depthBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		0, 1, &depthBarrier, 0, nullptr, 0, nullptr);
+
+	VkRenderingAttachmentInfo colorAttachmentInfo{};
+	colorAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	colorAttachmentInfo.imageView = hdrManager->GetHDRMsaaView();
+	colorAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachmentInfo.resolveImageView = hdrManager->GetHDRResolveView();
+	colorAttachmentInfo.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachmentInfo.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+	colorAttachmentInfo.clearValue = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	// Only tested against, the volumes never write depth
+	VkRenderingAttachmentInfo depthAttachmentInfo{};
+	depthAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	depthAttachmentInfo.imageView = depthBuffer->GetDepthImageView();
+	depthAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	depthAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+	VkRenderingInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	renderingInfo.renderArea = VkRect2D{ VkOffset2D {0, 0}, SwapchainExtent.width, SwapchainExtent.height };
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachments = &colorAttachmentInfo;
+	renderingInfo.pDepthAttachment = &depthAttachmentInfo;
+	renderingInfo.pStencilAttachment = VK_NULL_HANDLE;
+
+	vkCmdBeginRendering(commandBuffer, &renderingInfo);
+
+	VkViewport viewport{ 0.0f, 0.0f, (float)SwapchainExtent.width, (float)SwapchainExtent.height, 0.0f, 1.0f };
+	VkRect2D scissor{ { 0, 0 }, SwapchainExtent };
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	ScreenSizePush screenSizePushData;
+	screenSizePushData.inverseScreenSize = glm::vec2(1.0f / SwapchainExtent.width, 1.0f / SwapchainExtent.height);
+	screenSizePushData.inverseViewProjection = glm::inverse(camera->getProjection() * camera->getView());
+
+	// Ambient and directional light for every pixel
+	const CachedPipeline& ambientPso = pipeline->GetPipeline(lightingAmbientPipelineKey);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ambientPso.pipeline);
+	BindPassDescriptorSet(commandBuffer, ambientPso, lightingAmbientDescriptorSetLayout, lightingAmbientDescriptorTemplate, &lightingData);
+	vkCmdPushConstants(commandBuffer, ambientPso.layout, ambientPso.GetPushConstantStages(), 0, sizeof(ScreenSizePush), &screenSizePushData);
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+
+	// One sphere instance per light slot, added on top; cost follows the screen area the volumes cover
+	const uint32_t lightCount = lightManager->GetLightCount();
+	if (lightCount > 0) {
+		const CachedPipeline& volumePso = pipeline->GetPipeline(lightVolumePipelineKey);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, volumePso.pipeline);
+		BindPassDescriptorSet(commandBuffer, volumePso, lightVolumeDescriptorSetLayout, lightVolumeDescriptorTemplate, &lightingData);
+		vkCmdPushConstants(commandBuffer, volumePso.layout, volumePso.GetPushConstantStages(), 0, sizeof(ScreenSizePush), &screenSizePushData);
+		vkCmdDraw(commandBuffer, LIGHT_VOLUME_VERTEX_COUNT, lightCount, 0, 0);
+	}
+
+	vkCmdEndRendering(commandBuffer);
+
+	Image::RecordImageTransition(commandBuffer,hdrManager->GetHDRResolve(), VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+}
+
+void VulkanRenderer::RunLightBenchmark()
+{
+	const std::array<uint32_t, 5> lightCounts = { 128, 1024, 2500, 5000, 10000 };
+	const std::array<LightingPath, 3> paths = { LightingPath::Fullscreen, LightingPath::TiledCompute, LightingPath::LightVolumes };
+	const uint32_t warmupFrames = 8;
+	const uint32_t measuredFrames = 32;
+
+	if (!gpuProfiler->IsSupported()) {
+		std::cout << "Light benchmark skipped, the device has no timestamp queries" << std::endl;
+		return;
+	}
+
+	// The camera stays where InitVulkan put it for the whole run
+	camera->CalcViewMatrix();
+	camera->calculateProjectionMatrix();
+
+	VkExtent2D extent = swapchain->GetSwapChainExtent();
+	std::cout << "Lighting benchmark at " << extent.width << "x" << extent.height
+		<< ", " << measuredFrames << " frames per row" << std::endl;
+	std::cout << std::setw(8) << "lights" << std::setw(14) << "path" << std::setw(14) << "gpu ms" << std::setw(14) << "frame ms" << std::endl;
+
+	for (uint32_t lightCount : lightCounts)
+	{
+		lightManager->Clear();
+		for (const PointLight& light : GenerateBenchmarkLights(lightCount))
+		{
+			lightManager->AddLight(light);
+		}
+
+		for (LightingPath path : paths)
+		{
+			if (path == LightingPath::TiledCompute && !tiledLightingSupported) {
+				continue;
+			}
+			lightingPath = path;
+
+			// Timings of a frame slot are collected when it comes around again, warm-up frames
+			// also flush the previous configuration out of the averages
+			for (uint32_t i = 0; i < warmupFrames; ++i)
+			{
+				glfwPollEvents();
+				DrawFrame();
+			}
+			gpuProfiler->ResetStatistics();
+
+			const double start = glfwGetTime();
+			for (uint32_t i = 0; i < measuredFrames; ++i)
+			{
+				glfwPollEvents();
+				DrawFrame();
+			}
+			const double frameMs = (glfwGetTime() - start) * 1000.0 / measuredFrames;
+
+			std::cout << std::setw(8) << lightCount
+				<< std::setw(14) << LightingPathName(path)
+				<< std::setw(14) << std::fixed << std::setprecision(3) << gpuProfiler->GetAverageMs("lighting")
+				<< std::setw(14) << frameMs << std::defaultfloat << std::endl;
+
+			if (glfwWindowShouldClose(window->GetWindow())) {
+				return;
+			}
+		}
+	}
+
+	// The scene lights are gone, the benchmark ends the run
+	glfwSetWindowShouldClose(window->GetWindow(), GLFW_TRUE);
+}
+
+void VulkanRenderer::RunDepthPrepassBenchmark()
+{
+	const uint32_t warmupFrames = 8;
+	const uint32_t measuredFrames = 64;
+
+	if (!gpuProfiler->IsSupported()) {
+		std::cout << "Depth pre-pass benchmark skipped, the device has no timestamp queries" << std::endl;
+		return;
+	}
+
+	// The camera stays where InitVulkan put it for the whole run
+	camera->CalcViewMatrix();
+	camera->calculateProjectionMatrix();
+
+	// One G-buffer pass per frame, so both rows time the same work
+	renderPath = RenderPath::Deferred;
+	occlusionCulling = false;
+
+	VkExtent2D extent = swapchain->GetSwapChainExtent();
+	std::cout << "Depth pre-pass benchmark at " << extent.width << "x" << extent.height
+		<< ", " << measuredFrames << " frames per row" << std::endl;
+	std::cout << std::setw(10) << "pre-pass" << std::setw(14) << "pre-pass ms" << std::setw(14) << "gbuffer ms"
+		<< std::setw(14) << "total ms" << std::setw(14) << "frame ms" << std::endl;
+
+	for (bool prepass : { false, true })
+	{
+		depthPrepass = prepass;
+
+		for (uint32_t i = 0; i < warmupFrames; ++i)
+		{
+			glfwPollEvents();
+			DrawFrame();
+		}
+		gpuProfiler->ResetStatistics();
+
+		const double start = glfwGetTime();
+		for (uint32_t i = 0; i < measuredFrames; ++i)
+		{
+			glfwPollEvents();
+			DrawFrame();
+		}
+		const double frameMs = (glfwGetTime() - start) * 1000.0 / measuredFrames;
+
+		const double prepassMs = prepass ? gpuProfiler->GetAverageMs("depth_prepass") : 0.0;
+		const double gBufferMs = gpuProfiler->GetAverageMs("gbuffer");
+		std::cout << std::setw(10) << (prepass ? "on" : "off")
+			<< std::setw(14) << std::fixed << std::setprecision(3) << prepassMs
+			<< std::setw(14) << gBufferMs
+			<< std::setw(14) << prepassMs + gBufferMs
+			<< std::setw(14) << frameMs << std::defaultfloat << std::endl;
+
+		if (glfwWindowShouldClose(window->GetWindow())) {
+			return;
+		}
+	}
+
+	glfwSetWindowShouldClose(window->GetWindow(), GLFW_TRUE);
+}
+
+void VulkanRenderer::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	VulkanRenderer* renderer = static_cast<VulkanRenderer*>(glfwGetWindowUserPointer(window));
+	if (key == GLFW_KEY_L && action == GLFW_PRESS)
+	{
+		switch (renderer->lightingPath)
+		{
+		case LightingPath::Fullscreen:
+			renderer->lightingPath = renderer->tiledLightingSupported ? LightingPath::TiledCompute : LightingPath::LightVolumes;
+			break;
+		case LightingPath::TiledCompute: renderer->lightingPath = LightingPath::LightVolumes; break;
+		case LightingPath::LightVolumes:
+		default: renderer->lightingPath = LightingPath::Fullscreen; break;
+		}
+		std::cout << "Lighting path: " << LightingPathName(renderer->lightingPath) << std::endl;
+	}
+	if (key == GLFW_KEY_G && action == GLFW_PRESS)
+	{
+		renderer->gpuDrivenDraws = !renderer->gpuDrivenDraws;
+		std::cout << "Mesh draws: " << (renderer->gpuDrivenDraws ? "GPU culled, indirect" : "CPU, one draw per mesh") << std::endl;
+	}
+	if (key == GLFW_KEY_O && action == GLFW_PRESS)
+	{
+		renderer->occlusionCulling = !renderer->occlusionCulling;
+		std::cout << "Occlusion culling: " << (renderer->occlusionCulling ? "two-phase Hi-Z" : "off, frustum only") << std::endl;
+	}
+	if (key == GLFW_KEY_Z && action == GLFW_PRESS)
+	{
+		renderer->depthPrepass = !renderer->depthPrepass;
+		std::cout << "Depth pre-pass: " << (renderer->depthPrepass ? "on, G-buffer tests EQUAL" : "off") << std::endl;
+	}
+	if (key == GLFW_KEY_P && action == GLFW_PRESS)
+	{
+		renderer->renderPath = renderer->renderPath == RenderPath::Deferred ? RenderPath::ClusteredForward : RenderPath::Deferred;
+		std::cout << "Render path: " << (renderer->renderPath == RenderPath::Deferred ? "deferred" : "clustered forward") << std::endl;
 	}
 }
 
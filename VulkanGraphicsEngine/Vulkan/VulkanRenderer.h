@@ -6,6 +6,9 @@
 #include "VulkanUtils.h"
 #include <map>
 #include "Scene.h"
+#include "VulkanPipeline.h"
+#include "FrustumCulling.h"
+#include "RenderQueue.h"
 
 class WindowManager;
 class VulkanContext;
@@ -14,6 +17,7 @@ class VulkanPipeline;
 class VulkanTexture;
 class VulkanUniformBuffer;
 class VulkanDescriptorManager;
+class VulkanBindlessTextures;
 class VulkanCommandBuffer;
 class VulkanSyncObjects;
 class VulkanDepthBuffer;
@@ -23,6 +27,25 @@ struct Mesh;
 struct PipelineInfo;
 class HDRManager;
 class GBufferManager;
+class VulkanGpuProfiler;
+class LightManager;
+class IndirectDrawManager;
+class HiZManager;
+
+// How the deferred lighting pass is evaluated. Both read the same G-buffer and light buffer.
+enum class LightingPath
+{
+	Fullscreen,   // one fragment shader invocation loops over every light
+	TiledCompute, // lights are culled per 16x16 screen tile in shared memory, see tiled_lighting.comp
+	LightVolumes, // ambient and sun full screen, then one additive sphere per point light, see light_volume.vert
+};
+
+// Which pipeline renders the scene into the HDR target, picked per frame in DrawFrame
+enum class RenderPath
+{
+	Deferred,         // G-buffer pass followed by the LightingPath pass
+	ClusteredForward, // lights binned into froxels, then one forward MSAA pass (forward.frag)
+};
 
 class VulkanRenderer
 {
@@ -61,6 +84,23 @@ public:
 	//**
 	void MainLoop();
 
+	//**
+	// Removes a mesh from the scene; its GPU resources are freed once in-flight frames are done with them
+	//**
+	void UnloadMesh(Mesh* mesh);
+
+	//**
+	// When set before InitVulkan, MainLoop first times both lighting paths at increasing light counts,
+	// prints the results and closes the window
+	//**
+	void SetLightBenchmark(bool enabled) { runLightBenchmark = enabled; }
+
+	//**
+	// When set before InitVulkan, MainLoop first times the G-buffer with and without the depth
+	// pre-pass, prints the results and closes the window
+	//**
+	void SetDepthPrepassBenchmark(bool enabled) { runDepthPrepassBenchmark = enabled; }
+
 
 	bool framebufferResized{false};
 
@@ -70,8 +110,106 @@ private:
 	//**
 	// Recording of commandbuffer
 	//**
-	void RecordCommandBuffer(uint32_t imageIndex);
+	void RecordCommandBuffer(uint32_t imageIndex, RenderPath path);
+
+	//**
+	// Scene passes of each RenderPath; both leave the lit scene in the HDR resolve image, shader-read-only
+	//**
+	void RecordDeferredPasses(VkCommandBuffer commandBuffer);
+	void RecordClusteredForwardPasses(VkCommandBuffer commandBuffer);
+
+	//**
+	// Frustum culls every object on the GPU into this frame's indirect draw list, or runs the early
+	// occlusion phase when the frame uses occlusion culling; no-op when the frame draws from the CPU
+	//**
+	void RecordObjectCulling(VkCommandBuffer commandBuffer);
+
+	//**
+	// One phase of the occlusion culling in cull_occlusion.comp, filling the draw list of that phase.
+	// The late phase needs this frame's Hi-Z pyramid.
+	//**
+	void RecordOcclusionCulling(VkCommandBuffer commandBuffer, OcclusionCullPhase phase);
+
+	//**
+	// Reduces the depth resolve into the Hi-Z pyramid, one dispatch per level. The depth resolve
+	// must be in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL.
+	//**
+	void RecordHiZBuild(VkCommandBuffer commandBuffer);
+
+	//**
+	// One G-buffer rendering instance drawing a draw list. The first instance of a frame clears the
+	// targets; the last resolves the colour targets, earlier ones store the multisampled contents
+	// for the next to load. Depth is stored and resolved every time. With the depth pre-pass, the
+	// pre-pass of the same draw list runs first and owns the depth clear.
+	//**
+	void RecordGBufferPass(VkCommandBuffer commandBuffer, bool clearTargets, bool resolveTargets, uint32_t drawList);
+
+	//**
+	// Position-only pass writing the multisampled depth of a draw list, so the G-buffer pass after
+	// it shades each sample once (depth test EQUAL, no depth writes)
+	//**
+	void RecordDepthPrepass(VkCommandBuffer commandBuffer, bool clearDepth, uint32_t drawList);
+
+	//**
+	// Makes the G-buffer attachments written by one rendering instance visible to the next one loading them
+	//**
+	void RecordGBufferAttachmentBarrier(VkCommandBuffer commandBuffer);
+
+	//**
+	// Draws the scene meshes with the bound pipeline: one indirect count draw of a culled list,
+	// or one vkCmdDrawIndexed per render queue item of the pass, in sorted order
+	//**
+	void RecordMeshDraws(VkCommandBuffer commandBuffer, const CachedPipeline& pso, DrawPass pass, uint32_t drawList = 0);
+
+	//**
+	// Fills renderQueue with a draw per visible mesh and mesh pass of the frame and sorts it.
+	// Needs visibleMeshIndices and the frame's latched flags.
+	//**
+	void BuildRenderQueue(RenderPath path);
+
+	//**
+	// Refills meshCuller from the meshes' bounds; call whenever meshes is added to or removed from
+	//**
+	void RebuildMeshBounds();
+
+	//**
+	// Creates the update templates and writes the descriptor sets of the gbuffer, lighting and tonemap passes
+	//**
+	void CreateDescriptorSets();
+
+	//**
+	// Provides set 0 of a full-screen pass from data built at record time: pushed into the command
+	// buffer with VK_KHR_push_descriptor, otherwise written to a transient set of this frame
+	//**
+	void BindPassDescriptorSet(VkCommandBuffer commandBuffer, const CachedPipeline& pso, VkDescriptorSetLayout setLayout,
+		VkDescriptorUpdateTemplate updateTemplate, const void* data, VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+	//**
+	// Recreates the swapchain and every render target at the new window size. Pass descriptors
+	// are built per frame, so nothing has to be rewritten afterwards.
+	//**
+	void RecreateRenderTargets();
+
+	//**
+	// Lighting pass variants, all write the HDR resolve image and leave it shader-read-only
+	//**
+	void RecordFullscreenLighting(VkCommandBuffer commandBuffer, const LightingDescriptorData& lightingData);
+	void RecordTiledLighting(VkCommandBuffer commandBuffer, const LightingDescriptorData& lightingData);
+	void RecordLightVolumeLighting(VkCommandBuffer commandBuffer, const LightingDescriptorData& lightingData);
+
+	//**
+	// Draws a fixed number of frames per light count and lighting path and prints the GPU time of the lighting pass
+	//**
+	void RunLightBenchmark();
+
+	//**
+	// Draws a fixed number of frames with the depth pre-pass off and on and prints the GPU time of
+	// the pre-pass and the G-buffer pass
+	//**
+	void RunDepthPrepassBenchmark();
+
 	static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+	static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 	
 
 
@@ -83,16 +221,26 @@ private:
 	VulkanContext* context;
 	VulkanSwapchain* swapchain;
 
+	// Owns the PSO cache; every pass looks its pipeline up by key
 	VulkanPipeline* pipeline;
-
-	VkPipelineLayout pipelineLayout;
-	VkPipeline graphicsPipeline;
-	PipelineInfo* pipelineConfig;
-
-	VulkanPipeline* hdrPipeline;
-	VkPipelineLayout hdrPipelineLayout;
-	VkPipeline HdrGraphicsPipeline;
-	PipelineInfo* hdrPipelineConfig;
+	GraphicsPipelineKey gBufferPipelineKey;
+	// Depth pre-pass, and the G-buffer variant testing EQUAL against its depth without writing it
+	GraphicsPipelineKey depthPrepassPipelineKey;
+	GraphicsPipelineKey gBufferDepthEqualPipelineKey;
+	GraphicsPipelineKey lightingPipelineKey;
+	// LightingPath::LightVolumes: lighting.frag without point lights, then the additive volumes
+	GraphicsPipelineKey lightingAmbientPipelineKey;
+	GraphicsPipelineKey lightVolumePipelineKey;
+	ComputePipelineKey tiledLightingPipelineKey;
+	ComputePipelineKey clusterLightsPipelineKey;
+	ComputePipelineKey cullPipelineKey;
+	ComputePipelineKey occlusionCullPipelineKey;
+	ComputePipelineKey hiZBuildPipelineKey;
+	GraphicsPipelineKey forwardPipelineKey;
+	// One specialized variant per tonemap operator. Only the active one is compiled at startup, the
+	// others compile in the background and resolve to the active one until they are ready.
+	std::array<GraphicsPipelineKey, 3> tonemapPipelineKeys;
+	std::array<PipelineHandle, 3> tonemapPipelineHandles;
 
 	VulkanTexture* texture;
 	VulkanUniformBuffer* uniformBuffer;
@@ -100,40 +248,85 @@ private:
 	VulkanDescriptorManager* descriptorManager;
 	std::vector<VkDescriptorSet> globalDescriptorSet;
 	VkDescriptorSetLayout globalLayout;
-	std::vector<VkDescriptorSet> hdrDescriptorSet;
+	// Every material texture, bound once per frame at BINDLESS_SET
+	VulkanBindlessTextures* bindlessTextures;
 	VkDescriptorSetLayout hdrDescriptorSetLayout;
 
 	GBufferManager* gBufferManager;
 	std::vector<VkDescriptorSet> gBufferDescriptorSet;
 	VkDescriptorSetLayout gBufferDescriptorSetLayout;
-	VulkanPipeline* gBufferPipeline;
-	VkPipelineLayout gBufferPipelineLayout;
-	VkPipeline gBufferGraphicsPipeline;
-	PipelineInfo* gBufferPipelineConfig;
 	HDRManager* hdrManager;
 
 	
-	std::vector<VkDescriptorSet> lightingDescriptorSet;
 	VkDescriptorSetLayout lightingDescriptorSetLayout;
-	VulkanPipeline* lightingPipeline;
-	VkPipelineLayout lightingPipelineLayout;
-	VkPipeline lightingGraphicsPipeline;
-	PipelineInfo* lightingPipelineConfig;
+	VkDescriptorSetLayout tiledLightingDescriptorSetLayout;
+	VkDescriptorSetLayout lightingAmbientDescriptorSetLayout;
+	VkDescriptorSetLayout lightVolumeDescriptorSetLayout;
+	VkDescriptorSetLayout clusterLightsDescriptorSetLayout;
+	VkDescriptorSetLayout cullDescriptorSetLayout;
+	VkDescriptorSetLayout occlusionCullDescriptorSetLayout;
+	VkDescriptorSetLayout hiZBuildDescriptorSetLayout;
+	VkDescriptorSetLayout forwardDescriptorSetLayout;
+	// Created once per layout; sets are (re)written from a packed struct without building write arrays.
+	// The lighting and tonemap templates push their set when usePushDescriptors is set.
+	VkDescriptorUpdateTemplate globalDescriptorTemplate;
+	VkDescriptorUpdateTemplate lightingDescriptorTemplate;
+	VkDescriptorUpdateTemplate tiledLightingDescriptorTemplate;
+	VkDescriptorUpdateTemplate lightingAmbientDescriptorTemplate;
+	VkDescriptorUpdateTemplate lightVolumeDescriptorTemplate;
+	VkDescriptorUpdateTemplate clusterLightsDescriptorTemplate;
+	VkDescriptorUpdateTemplate cullDescriptorTemplate;
+	VkDescriptorUpdateTemplate occlusionCullDescriptorTemplate;
+	VkDescriptorUpdateTemplate hiZBuildDescriptorTemplate;
+	VkDescriptorUpdateTemplate forwardDescriptorTemplate;
+	VkDescriptorUpdateTemplate hdrDescriptorTemplate;
+	// The lighting and tonemap inputs (render targets, per-frame UBOs) are pushed at record time
+	// instead of living in persistent sets
+	bool usePushDescriptors = false;
 
 	VulkanCommandBuffer* commandBuffer;
 	VulkanSyncObjects* syncObjects;
 	VulkanDepthBuffer* depthBuffer;
 	std::vector<Mesh*> meshes;
 	ImguiManager* imguiManager;
+	// Times the lighting pass ("lighting" scope) and the G-buffer passes for the benchmarks
+	VulkanGpuProfiler* gpuProfiler;
 
 	
 
 	Scene::Camera* camera;
 
-	std::vector<PointLight> lights;
+	LightManager* lightManager;
 	DirectionalLight dirLight;
+	LightingPath lightingPath = LightingPath::TiledCompute;
+	// False when tiled_lighting.comp does not fit the device's compute shared memory
+	bool tiledLightingSupported = true;
+	RenderPath renderPath = RenderPath::Deferred;
+	// Merged scene geometry and the per-frame culled draw lists
+	IndirectDrawManager* indirectDrawManager;
+	// Toggled with 'G'; only honoured when the device supports draw indirect count
+	bool gpuDrivenDraws = true;
+	// Latched in DrawFrame before recording so culling and draws of one frame agree
+	bool frameUsesIndirectDraws = false;
+	// Min/max depth pyramid of the G-buffer depth resolve, for the late occlusion phase
+	HiZManager* hiZManager;
+	// Toggled with 'O'; deferred path with indirect draws only, and only when the device supports it
+	bool occlusionCulling = true;
+	bool frameUsesOcclusionCulling = false;
+	// Toggled with 'Z'; deferred path only
+	bool depthPrepass = false;
+	bool frameUsesDepthPrepass = false;
+	// Bounds of meshes[i] at box i, culled on the CPU when the frame does not draw indirect
+	FrustumCuller meshCuller;
+	// Indices into meshes that passed the CPU frustum test this frame
+	std::vector<uint32_t> visibleMeshIndices;
+	// Sorted draws of the visible meshes for the CPU draw path, rebuilt every frame
+	RenderQueue renderQueue;
+	bool runLightBenchmark = false;
+	bool runDepthPrepassBenchmark = false;
 
 	uint32_t currentFrame{0};
+	uint64_t frameNumber{0};
 
 	
 	float currentExposure = 1.0f; 
@@ -0,0 +1,121 @@
+#include "VulkanSamplerCache.h"
+#include "VulkanContext.h"
+#include <algorithm>
+#include <functional>
+
+SamplerDesc& SamplerDesc::SetFilter(VkFilter filter, VkSamplerMipmapMode mipmap)
+{
+	magFilter = filter;
+	minFilter = filter;
+	mipmapMode = mipmap;
+	return *this;
+}
+
+SamplerDesc& SamplerDesc::SetAddressMode(VkSamplerAddressMode mode)
+{
+	addressModeU = mode;
+	addressModeV = mode;
+	addressModeW = mode;
+	return *this;
+}
+
+bool SamplerDesc::operator==(const SamplerDesc& other) const
+{
+	return magFilter == other.magFilter &&
+		minFilter == other.minFilter &&
+		mipmapMode == other.mipmapMode &&
+		addressModeU == other.addressModeU &&
+		addressModeV == other.addressModeV &&
+		addressModeW == other.addressModeW &&
+		mipLodBias == other.mipLodBias &&
+		maxAnisotropy == other.maxAnisotropy &&
+		compareEnable == other.compareEnable &&
+		compareOp == other.compareOp &&
+		minLod == other.minLod &&
+		maxLod == other.maxLod &&
+		borderColor == other.borderColor &&
+		unnormalizedCoordinates == other.unnormalizedCoordinates;
+}
+
+size_t SamplerDesc::Hash() const
+{
+	size_t seed = 0;
+	VulkanUtils::HashCombine(seed, static_cast<size_t>(magFilter));
+	VulkanUtils::HashCombine(seed, static_cast<size_t>(minFilter));
+	VulkanUtils::HashCombine(seed, static_cast<size_t>(mipmapMode));
+	VulkanUtils::HashCombine(seed, static_cast<size_t>(addressModeU));
+	VulkanUtils::HashCombine(seed, static_cast<size_t>(addressModeV));
+	VulkanUtils::HashCombine(seed, static_cast<size_t>(addressModeW));
+	VulkanUtils::HashCombine(seed, std::hash<float>{}(mipLodBias));
+	VulkanUtils::HashCombine(seed, std::hash<float>{}(maxAnisotropy));
+	VulkanUtils::HashCombine(seed, compareEnable ? 1u : 0u);
+	VulkanUtils::HashCombine(seed, static_cast<size_t>(compareOp));
+	VulkanUtils::HashCombine(seed, std::hash<float>{}(minLod));
+	VulkanUtils::HashCombine(seed, std::hash<float>{}(maxLod));
+	VulkanUtils::HashCombine(seed, static_cast<size_t>(borderColor));
+	VulkanUtils::HashCombine(seed, unnormalizedCoordinates ? 1u : 0u);
+	return seed;
+}
+
+VkSampler VulkanSamplerCache::GetOrCreateSampler(const SamplerDesc& desc)
+{
+	const VkPhysicalDeviceLimits& limits = context->GetDeviceProperties().limits;
+
+	// Clamp before the lookup so requests above the limit share the sampler of the limit
+	SamplerDesc key = desc;
+	key.maxAnisotropy = std::clamp(desc.maxAnisotropy, 1.0f, limits.maxSamplerAnisotropy);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it = samplers.find(key);
+	if (it != samplers.end()) {
+		return it->second;
+	}
+
+	if (samplers.size() >= limits.maxSamplerAllocationCount) {
+		throw std::runtime_error("Sampler cache exceeds maxSamplerAllocationCount (" +
+			std::to_string(limits.maxSamplerAllocationCount) + ")!");
+	}
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = key.magFilter;
+	samplerInfo.minFilter = key.minFilter;
+	samplerInfo.mipmapMode = key.mipmapMode;
+	samplerInfo.addressModeU = key.addressModeU;
+	samplerInfo.addressModeV = key.addressModeV;
+	samplerInfo.addressModeW = key.addressModeW;
+	samplerInfo.mipLodBias = key.mipLodBias;
+	samplerInfo.anisotropyEnable = key.maxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+	samplerInfo.maxAnisotropy = key.maxAnisotropy;
+	samplerInfo.compareEnable = key.compareEnable ? VK_TRUE : VK_FALSE;
+	samplerInfo.compareOp = key.compareOp;
+	samplerInfo.minLod = key.minLod;
+	samplerInfo.maxLod = key.maxLod;
+	samplerInfo.borderColor = key.borderColor;
+	samplerInfo.unnormalizedCoordinates = key.unnormalizedCoordinates ? VK_TRUE : VK_FALSE;
+
+	VkSampler sampler = VK_NULL_HANDLE;
+	if (vkCreateSampler(context->GetDevice(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create sampler!");
+	}
+
+	samplers.emplace(key, sampler);
+	return sampler;
+}
+
+size_t VulkanSamplerCache::GetSamplerCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return samplers.size();
+}
+
+void VulkanSamplerCache::CleanupSamplers()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& [desc, sampler] : samplers)
+	{
+		vkDestroySampler(context->GetDevice(), sampler, nullptr);
+	}
+	samplers.clear();
+}
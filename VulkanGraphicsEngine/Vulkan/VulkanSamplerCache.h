@@ -0,0 +1,83 @@
+#ifndef VULKAN_SAMPLER_CACHE_H
+#define VULKAN_SAMPLER_CACHE_H
+
+#include "VulkanUtils.h"
+#include <mutex>
+#include <unordered_map>
+
+class VulkanContext;
+
+//**
+// Everything that makes two samplers different. Defaults are a trilinear, repeating sampler over
+// the whole mip chain; the image view limits the mips, so textures with different mip counts share it.
+//**
+struct SamplerDesc
+{
+	// Requests the highest anisotropy the device supports, see VulkanSamplerCache::GetOrCreateSampler
+	static constexpr float MAX_ANISOTROPY = 16.0f;
+
+	VkFilter magFilter = VK_FILTER_LINEAR;
+	VkFilter minFilter = VK_FILTER_LINEAR;
+	VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	VkSamplerAddressMode addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	VkSamplerAddressMode addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	VkSamplerAddressMode addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	float mipLodBias = 0.0f;
+	float maxAnisotropy = 1.0f; // 1 disables anisotropic filtering
+	bool compareEnable = false;
+	VkCompareOp compareOp = VK_COMPARE_OP_ALWAYS;
+	float minLod = 0.0f;
+	float maxLod = VK_LOD_CLAMP_NONE;
+	VkBorderColor borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	bool unnormalizedCoordinates = false;
+
+	SamplerDesc& SetFilter(VkFilter filter, VkSamplerMipmapMode mipmap);
+	SamplerDesc& SetAddressMode(VkSamplerAddressMode mode);
+
+	bool operator==(const SamplerDesc& other) const;
+	size_t Hash() const;
+};
+
+struct SamplerDescHash
+{
+	size_t operator()(const SamplerDesc& desc) const { return desc.Hash(); }
+};
+
+// Deduplicates samplers: identical descriptions map to one VkSampler shared by every texture and
+// render target that asks for it, which keeps the count far below maxSamplerAllocationCount.
+// The cache owns every sampler it hands out; they are destroyed together in CleanupSamplers.
+// Safe to use from worker threads.
+class VulkanSamplerCache final
+{
+public:
+	explicit VulkanSamplerCache(VulkanContext* context) : context(context) {}
+	~VulkanSamplerCache() = default;
+
+	VulkanSamplerCache(const VulkanSamplerCache&) = delete;
+	VulkanSamplerCache& operator=(const VulkanSamplerCache&) = delete;
+
+	//**
+	// Returns the cached sampler for this description, creating it on first use.
+	// maxAnisotropy is clamped to the device limit first, so MAX_ANISOTROPY always gets the best available.
+	// Do not destroy the returned sampler.
+	//**
+	VkSampler GetOrCreateSampler(const SamplerDesc& desc);
+
+	//**
+	// Returns how many unique samplers have been created
+	//**
+	size_t GetSamplerCount() const;
+
+	//**
+	// Destroys every cached sampler
+	//**
+	void CleanupSamplers();
+
+private:
+	VulkanContext* context;
+
+	mutable std::mutex mutex;
+	std::unordered_map<SamplerDesc, VkSampler, SamplerDescHash> samplers;
+};
+
+#endif
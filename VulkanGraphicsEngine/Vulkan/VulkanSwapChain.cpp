@@ -26,6 +26,41 @@ void VulkanSwapchain::CleanupSwapchain()
 
 		vkDestroySwapchainKHR(context->GetDevice(), swapChain, nullptr);
 	}
+
+	swapChainFramebuffers.clear();
+	swapChainImageViews.clear();
+	swapChain = VK_NULL_HANDLE;
+}
+
+void VulkanSwapchain::ReleaseSwapchain()
+{
+	VulkanDeletionQueue& deletionQueue = context->GetDeletionQueue();
+
+	deletionQueue.DestroyImageView(colorImageView);
+	deletionQueue.DestroyImage(colorImage, colorImageAllocation);
+
+	VkDevice device = context->GetDevice();
+	for (VkFramebuffer framebuffer : swapChainFramebuffers)
+	{
+		deletionQueue.Push([device, framebuffer]() { vkDestroyFramebuffer(device, framebuffer, nullptr); });
+	}
+
+	for (VkImageView imageView : swapChainImageViews)
+	{
+		deletionQueue.DestroyImageView(imageView);
+	}
+
+	// Keep the handle alive until CreateSwapchain has handed it to the driver as oldSwapchain
+	deletionQueue.DestroySwapchain(swapChain);
+	retiredSwapChain = swapChain;
+
+	colorImageView = VK_NULL_HANDLE;
+	colorImage = VK_NULL_HANDLE;
+	colorImageAllocation = nullptr;
+	swapChainFramebuffers.clear();
+	swapChainImageViews.clear();
+	swapChainImages.clear();
+	swapChain = VK_NULL_HANDLE;
 }
 
 VulkanSwapchain& VulkanSwapchain::CreateSwapchain()
@@ -73,11 +108,12 @@ VulkanSwapchain& VulkanSwapchain::CreateSwapchain()
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE;
 
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	createInfo.oldSwapchain = retiredSwapChain;
 
 	if (vkCreateSwapchainKHR(context->GetDevice(), &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create swap chain!");
 	}
+	retiredSwapChain = VK_NULL_HANDLE;
 
 	vkGetSwapchainImagesKHR(context->GetDevice(), swapChain, &imageCount, nullptr);
 	swapChainImages.resize(imageCount);
@@ -192,11 +228,11 @@ void VulkanSwapchain::ReCreateSwapchain( VkRenderPass renderPass,VulkanDepthBuff
 		glfwGetFramebufferSize(window, &width, &height);
 		glfwWaitEvents();
 	}
-	vkDeviceWaitIdle(context->GetDevice());
-
 
-	depthBuffer->CleanupDepthBuffer();
-	CleanupSwapchain();
+	// No device wait: resources still referenced by in-flight frames are destroyed
+	// by the deletion queue once those frames have retired
+	depthBuffer->ReleaseDepthBuffer();
+	ReleaseSwapchain();
 
 	CreateSwapchain();
 	CreateImageViews();
@@ -62,6 +62,12 @@ public:
 	// clean up
 	//**
 	void CleanupSwapchain();
+
+	//**
+	// Hands the swapchain, its image views and the color target to the deletion queue.
+	// The old swapchain handle is kept so it can be passed as oldSwapchain on recreation.
+	//**
+	void ReleaseSwapchain();
 	
 	//**
 	//Framebuffer creation
@@ -99,15 +105,16 @@ private:
 	//**
 	VulkanContext* context;
 
-	VkSwapchainKHR swapChain;
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+	VkSwapchainKHR retiredSwapChain = VK_NULL_HANDLE;
 	std::vector<VkImage> swapChainImages;
 	VkFormat swapChainImageFormat;
 	VkExtent2D swapChainExtent;
 	std::vector<VkImageView> swapChainImageViews;
 	std::vector<VkFramebuffer> swapChainFramebuffers;
-	VkImage colorImage;
+	VkImage colorImage = VK_NULL_HANDLE;
 	VkDeviceMemory colorImageMemory;
-	VkImageView colorImageView;
+	VkImageView colorImageView = VK_NULL_HANDLE;
 
 	VmaAllocation colorImageAllocation{};
 };
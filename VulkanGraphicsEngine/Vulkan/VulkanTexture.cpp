@@ -15,7 +15,7 @@ void VulkanTexture::CleanupTexture()
 {
 	if (context)
 	{
-		vkDestroySampler(context->GetDevice(), textureSampler, nullptr);
+		// The sampler belongs to the context's sampler cache
 		vkDestroyImageView(context->GetDevice(), textureImageView, nullptr);
 		vmaDestroyImage(context->GetVMAAllocator(), textureImage, textureImageAllocation);
 
@@ -28,35 +28,29 @@ void VulkanTexture::CleanupTexture()
 	mipLevels = 0; 
 }
 
-VulkanTexture& VulkanTexture::CreateTextureSampler()
+void VulkanTexture::ReleaseTexture()
 {
-	VkSamplerCreateInfo samplerInfo{};
-	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-	samplerInfo.magFilter = VK_FILTER_LINEAR;
-	samplerInfo.minFilter = VK_FILTER_LINEAR;
-	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.anisotropyEnable = VK_TRUE;
-
-	VkPhysicalDeviceProperties properties{};
-	vkGetPhysicalDeviceProperties(context->GetPhysicalDevice(), &properties);
-
-	samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
-	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-	samplerInfo.unnormalizedCoordinates = VK_FALSE;
-	samplerInfo.compareEnable = VK_FALSE;
-	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-	samplerInfo.mipLodBias = 0.0f;
-	samplerInfo.minLod = 0.0f;
-	samplerInfo.maxLod = static_cast<float>(mipLevels);
-
-	if (vkCreateSampler(context->GetDevice(), &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS)
+	if (context)
 	{
-		throw std::runtime_error("failed to create texture sampler!");
+		VulkanDeletionQueue& deletionQueue = context->GetDeletionQueue();
+		deletionQueue.DestroyImageView(textureImageView);
+		deletionQueue.DestroyImage(textureImage, textureImageAllocation);
 	}
 
+	textureSampler = VK_NULL_HANDLE;
+	textureImageView = VK_NULL_HANDLE;
+	textureImage = VK_NULL_HANDLE;
+	textureImageAllocation = nullptr;
+	mipLevels = 0;
+}
+
+VulkanTexture& VulkanTexture::CreateTextureSampler()
+{
+	// Shared by every texture: the LOD range is unclamped and the image view limits the mips
+	SamplerDesc samplerDesc{};
+	samplerDesc.maxAnisotropy = SamplerDesc::MAX_ANISOTROPY;
+	textureSampler = context->GetSamplerCache().GetOrCreateSampler(samplerDesc);
+
 	return *this;
 }
 
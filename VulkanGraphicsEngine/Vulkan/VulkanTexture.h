@@ -64,6 +64,10 @@ public:
 	VulkanTexture& CreateTexture(const std::string& texturePath,TextureType type);
 
 	void CleanupTexture();
+
+	// Hands the image and view to the deletion queue; they are destroyed once the
+	// frames that may still sample them have retired. The sampler is shared and stays.
+	void ReleaseTexture();
 	 
 private:
 
@@ -77,7 +81,7 @@ private:
 	VkImageView textureImageView;
 
 
-	VkSampler textureSampler;
+	VkSampler textureSampler; // owned by the context's sampler cache
 	uint32_t mipLevels;
 
 	VmaAllocation textureImageAllocation;
@@ -86,11 +86,65 @@ struct DirectionalLight
 	alignas(4) float lux;
 };
 
+// The point lights themselves live in a per-frame storage buffer (binding 10), see
+// VulkanUniformBuffer::UpdatePointLights; this only says how many of them are valid
 struct SceneLightingUBO
 {
-	PointLight lights[4];
 	DirectionalLight directionalLight; 
-	alignas(4) int numberOfLights;
+	alignas(4) uint32_t pointLightCount;
+};
+
+// Packed descriptor data for the update templates of the renderer's sets. The bindings each
+// member is written to are given by the template entries, the member order is free.
+struct GlobalDescriptorData
+{
+	VkDescriptorBufferInfo camera;   // binding 0
+	VkDescriptorBufferInfo model;    // binding 1
+};
+
+struct LightingDescriptorData
+{
+	VkDescriptorImageInfo albedo;            // binding 0
+	VkDescriptorImageInfo normal;            // binding 1
+	VkDescriptorImageInfo metallicRoughness; // binding 2, ambient occlusion in b
+	VkDescriptorImageInfo depth;             // binding 3
+	VkDescriptorBufferInfo lights;           // binding 8
+	VkDescriptorBufferInfo camera;           // binding 9
+	VkDescriptorBufferInfo pointLights;      // binding 10
+	VkDescriptorImageInfo hdrOutput;         // binding 4, storage image, tiled compute path only
+};
+
+// Set 0 of the clustered forward pass. The light binning compute pass reads the same data
+// at the same bindings, apart from the model UBO.
+struct ForwardDescriptorData
+{
+	VkDescriptorBufferInfo camera;           // binding 0
+	VkDescriptorBufferInfo model;            // binding 1
+	VkDescriptorBufferInfo lights;           // binding 2
+	VkDescriptorBufferInfo pointLights;      // binding 3
+	VkDescriptorBufferInfo clusters;         // binding 4
+	VkDescriptorBufferInfo clusterParams;    // binding 5
+};
+
+struct CullDescriptorData
+{
+	VkDescriptorBufferInfo objects;          // binding 0
+	VkDescriptorBufferInfo drawCommands;     // binding 1
+	VkDescriptorBufferInfo drawCount;        // binding 2
+	VkDescriptorBufferInfo visibility;       // binding 3, occlusion culling only
+	VkDescriptorImageInfo hiZ;               // binding 4, occlusion culling only
+	VkDescriptorBufferInfo camera;           // binding 5, occlusion culling only
+};
+
+struct HiZBuildDescriptorData
+{
+	VkDescriptorImageInfo source;            // binding 0, depth resolve or the previous pyramid level
+	VkDescriptorImageInfo destination;       // binding 1, storage image
+};
+
+struct TonemapDescriptorData
+{
+	VkDescriptorImageInfo hdr;       // binding 0
 };
 
 struct PushConstantData
@@ -100,16 +154,131 @@ struct PushConstantData
 	alignas(16)glm::mat4 modelMatrix;
 };
 
+// Bindless materials: every texture lives in one sampled-image array (set 1, binding 0) and
+// each draw looks its textures up through a material index (set 1, binding 1).
+// Runtime-sized descriptor arrays in the shaders are given this many descriptors.
+const uint32_t MAX_BINDLESS_TEXTURES = 4096;
+const uint32_t MAX_MATERIALS = 1024;
+const uint32_t BINDLESS_SET = 1;
+// Material slot without a texture of that kind; the shader falls back to a constant
+const uint32_t NO_TEXTURE = UINT32_MAX;
+
+// Mirrors `Material` in shader.frag (std430)
+struct MaterialData
+{
+	uint32_t albedo = NO_TEXTURE;
+	uint32_t normal = NO_TEXTURE;
+	uint32_t metallic = NO_TEXTURE;
+	uint32_t roughness = NO_TEXTURE;
+	uint32_t ao = NO_TEXTURE;
+};
+
+// The operator is no longer pushed, it is baked into the tonemap pipeline as a specialization constant
 struct ToneMapPush {
 	alignas(4)float exposure;
-	alignas(4)int tonemapOperator;
 };
 
+// Specialization constant IDs, must match the constant_id layouts in the shaders
+enum TonemapSpecialization : uint32_t {
+	TONEMAP_SPEC_OPERATOR = 0,        // 0=Reinhard, 1=ACES, 2=Uncharted2
+};
+
+enum LightingSpecialization : uint32_t {
+	LIGHTING_SPEC_DIRECTIONAL_LIGHT = 1,
+	LIGHTING_SPEC_AMBIENT_OCCLUSION = 2,
+	LIGHTING_SPEC_POINT_LIGHTS = 3,
+};
+
+// Light-volume lighting: one instanced low-poly sphere per point light, generated in light_volume.vert
+const uint32_t LIGHT_VOLUME_SEGMENTS = 12;
+const uint32_t LIGHT_VOLUME_RINGS = 8;
+const uint32_t LIGHT_VOLUME_VERTEX_COUNT = LIGHT_VOLUME_SEGMENTS * LIGHT_VOLUME_RINGS * 6;
+
 struct ScreenSizePush {
 	alignas(16)glm::vec2 inverseScreenSize;
 	alignas(16)glm::mat4 inverseViewProjection;
 };
 
+// Tiled compute lighting: one workgroup of LIGHTING_TILE_SIZE^2 threads per screen tile.
+// Must match local_size and MAX_LIGHTS_PER_TILE in tiled_lighting.comp.
+const uint32_t LIGHTING_TILE_SIZE = 16;
+const uint32_t MAX_LIGHTS_PER_TILE = 1024;
+// Shared memory one tiled_lighting.comp workgroup declares: the light index list, the tile planes
+// and five scalars. The tiled path is only created when this fits maxComputeSharedMemorySize.
+const uint32_t TILED_LIGHTING_SHARED_MEMORY_SIZE = MAX_LIGHTS_PER_TILE * sizeof(uint32_t) + 4 * sizeof(glm::vec4) + 5 * sizeof(uint32_t);
+
+struct TiledLightingPush {
+	alignas(16)glm::mat4 inverseProjection;
+	alignas(8)glm::vec2 inverseScreenSize;
+};
+
+// Clustered forward+: the view frustum is split into CLUSTER_GRID_X x CLUSTER_GRID_Y screen tiles
+// and CLUSTER_GRID_Z exponential depth slices. Must match cluster_lights.comp and forward.frag.
+const uint32_t CLUSTER_GRID_X = 16;
+const uint32_t CLUSTER_GRID_Y = 9;
+const uint32_t CLUSTER_GRID_Z = 24;
+const uint32_t CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+// A cluster record is its light count followed by this many indices, 1 KiB in total
+const uint32_t MAX_LIGHTS_PER_CLUSTER = 255;
+
+struct ClusterUBO
+{
+	alignas(16) glm::mat4 inverseProjection;
+	alignas(8) glm::vec2 screenSize;
+	alignas(4) float zNear;
+	alignas(4) float zFar;
+};
+
+// GPU-driven drawing: cull_objects.comp tests one object per thread and appends the survivors
+// as VkDrawIndexedIndirectCommands. Must match local_size and ObjectData in cull_objects.comp.
+const uint32_t CULL_WORKGROUP_SIZE = 64;
+
+// std430 record of one drawable: world-space bounds and where its indices live in the merged buffers
+struct GpuObjectData
+{
+	alignas(16) glm::vec4 boundsMin;
+	alignas(16) glm::vec4 boundsMax;
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t materialIndex;
+};
+
+struct CullPush
+{
+	alignas(16) glm::vec4 frustumPlanes[6]; // xyz inward normal, w distance
+	alignas(4) uint32_t objectCount;
+};
+
+// Two-phase occlusion culling (cull_occlusion.comp). The early phase draws what was visible last
+// frame, the late phase tests everything against the Hi-Z pyramid of that depth and draws what
+// the early phase missed. Each phase fills its own draw list, so the phase doubles as list index.
+enum OcclusionCullPhase : uint32_t {
+	OCCLUSION_CULL_EARLY = 0,
+	OCCLUSION_CULL_LATE = 1,
+};
+// Draw lists per frame in flight: frustum-only culling uses the first
+const uint32_t INDIRECT_DRAW_LIST_COUNT = 2;
+
+struct OcclusionCullPush
+{
+	alignas(16) glm::vec4 frustumPlanes[6]; // xyz inward normal, w distance
+	alignas(8) glm::uvec2 depthSize;        // pixels of the depth the pyramid was built from
+	alignas(4) uint32_t objectCount;
+	alignas(4) uint32_t phase;              // OcclusionCullPhase
+};
+
+// Hi-Z pyramid: level 0 is half the depth resolution, every texel holds the min (r) and max (g)
+// depth of its footprint. Must match local_size in hiz_build.comp.
+const uint32_t HIZ_WORKGROUP_SIZE = 8;
+
+struct HiZBuildPush
+{
+	alignas(8) glm::ivec2 sourceSize;
+	alignas(8) glm::ivec2 destinationSize;
+	alignas(4) uint32_t sourceIsDepth;      // 1 for the depth resolve, 0 for a pyramid level
+};
+
 enum class TextureType {
 	ALBEDO,
 	NORMAL,
@@ -136,6 +305,12 @@ public:
 	static void CopyBuffer(VkDevice device, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkQueue graphicsQueue, VkCommandPool commandPool);
 
 
+	//**
+	// Makes writes to a whole buffer from srcStage available to dstStage
+	//**
+	static void RecordBufferBarrier(VkCommandBuffer commandBuffer, VkBuffer buffer,
+		VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage);
+
 	static VkCommandBuffer BeginSingleTimeCommands(VkDevice device, VkCommandPool commandPool);
 	static void EndSingleTimeCommands(VkDevice device, VkQueue graphicsQueue, VkCommandBuffer commandBuffer, VkCommandPool commandPool);
 
@@ -159,6 +334,18 @@ public:
 	}
 
 	static bool IsDepthFormat(VkFormat format);
+
+	//**
+	// Bytes per texel of the uncompressed formats the engine renders to, 0 for anything else
+	//**
+	static uint32_t GetFormatSize(VkFormat format);
+
+	//**
+	// Mixes value into seed (boost::hash_combine), used by every cache key hash
+	//**
+	static void HashCombine(size_t& seed, size_t value) {
+		seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	}
 };
 
 
@@ -1,11 +1,15 @@
 ﻿#include <exception>
 #include <iostream>
+#include <cstring>
 #include "Vulkan/VulkanRenderer.h"
+#include "Vulkan/FrustumCulling.h"
 class VulkanApp
 {
 public:
-	void run()
+	void run(bool lightBenchmark, bool depthPrepassBenchmark)
 	{
+		vulkanRenderer.SetLightBenchmark(lightBenchmark);
+		vulkanRenderer.SetDepthPrepassBenchmark(depthPrepassBenchmark);
 		vulkanRenderer.CreateVulkanManagers();
 		vulkanRenderer.InitVulkan();
 		//vulkanRenderer.InitImGui();
@@ -16,13 +20,32 @@ private:
 	VulkanRenderer vulkanRenderer{};
 };
 
-int main()
+int main(int argc, char** argv)
 {
 	VulkanApp app;
 
+	// --light-benchmark times the lighting paths at increasing light counts and exits
+	// --prepass-benchmark times the G-buffer with and without the depth pre-pass and exits
+	// --cull-benchmark times the CPU frustum culling kernels without opening a window
+	bool lightBenchmark = false;
+	bool depthPrepassBenchmark = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--light-benchmark") == 0) {
+			lightBenchmark = true;
+		}
+		else if (std::strcmp(argv[i], "--prepass-benchmark") == 0) {
+			depthPrepassBenchmark = true;
+		}
+		else if (std::strcmp(argv[i], "--cull-benchmark") == 0) {
+			FrustumCuller::RunBenchmark();
+			return EXIT_SUCCESS;
+		}
+	}
+
 	try
 	{
-		app.run();
+		app.run(lightBenchmark, depthPrepassBenchmark);
 	}
 	catch (const std::exception& e)
 	{